@@ -7,7 +7,7 @@ using namespace Maximilian;
 Oscilation sound, bass, timer, mod, lead, lead2, leadmod;//here are the synth bits
 Env envelope, leadenvelope;//some envelopes
 Filter filter, filter2;//some filters
-DelayLine delay;//a delay
+DelayLine delay(14'000);//a delay, as long as the longest one it plays
 Convert mtof;//a method for converting midi notes to frequency
 double bassout, leadout, delayout;//some variables to hold the data and pass it around
 int trigger, trigger2, newnote;//some control variables
@@ -1,29 +1,20 @@
-
 #include "Maximilian.hpp"
-#include "libs/maxim.h"
-
-maxiOsc mySine, myPhasor; // This is the oscillator we will use to generate the test tone
-maxiFFT myFFT;
-
-
-void setup()
-{
+#include "Spectral/STFT.hpp"
 
-	myFFT.setup(1024, 512, 256);
+using namespace Maximilian;
 
-}
+Oscilation mySine, myPhasor; // This is the oscillator we will use to generate the test tone
+STFT myFFT; // fft size, window size and hop size are given in main()
 
-void play(double* output)
+void play(std::vector <double>& output)
 {
-
-
-	float myOut = mySine.sinewave(myPhasor.phasor(0.2, 100, 5000));
+	double myOut = mySine.sinewave(myPhasor.phasor(0.2, 100, 5000));
 	//output[0] is the left output. output[1] is the right output
 
 	if (myFFT.process(myOut))
 	{
 
-		//if you want you can mess with FFT frame values in here
+		//if you want you can read the new frame in here, myFFT.getMagnitudes() and myFFT.getPhases()
 
 	}
 
@@ -31,3 +22,23 @@ void play(double* output)
 	output[1] = output[0];
 
 }
+
+int main()
+{
+	// A hop of a quarter window, so myFFT.process(input, output, frames, spectral) would also resynthesise evenly
+	myFFT.setup(1024, 1024, 256);
+
+	Audio audio;
+	audio.openStream(play);
+	audio.startStream();
+
+	char input;
+	std::cout << "\nMaximilian is playing ... press <enter> to quit.\n";
+	std::cin.get(input);
+
+	// Stop the stream
+	audio.stopStream();
+
+	if (audio.isStreamOpen())
+	{ audio.closeStream(); }
+}
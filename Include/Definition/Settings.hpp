@@ -0,0 +1,17 @@
+#ifndef MAXIMILIAN_SETTINGS_HPP
+#define MAXIMILIAN_SETTINGS_HPP
+
+namespace Maximilian
+{
+	class Settings
+	{
+
+	public:
+
+		static constexpr unsigned short SAMPLE_RATE = 44'100;
+		static constexpr unsigned short CHANNELS = 2;
+		static constexpr unsigned short BUFFER_SIZE = 1'024;
+	};
+}
+
+#endif //MAXIMILIAN_SETTINGS_HPP
@@ -0,0 +1,150 @@
+#ifndef MAXIMILIAN_DELAYMEMORY_HPP
+#define MAXIMILIAN_DELAYMEMORY_HPP
+
+#include <array>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Shared arena for delay line storage.
+	 *
+	 * Memory is carved out of large slabs in power of two sized blocks and
+	 * handed back to per-size free lists when a delay line is destroyed, so
+	 * hundreds of short delays cost what they use and reuse each other's
+	 * memory. Slabs are never returned to the system while the pool lives.
+	 *
+	 * acquire() may allocate a new slab and takes a lock; call it (through
+	 * DelayMemory::reserve) from a setup or loader thread, not the audio
+	 * callback.
+	 */
+	class DelayPool
+	{
+
+	public:
+
+		static constexpr std::size_t MINIMUM_CAPACITY = 16;
+		static constexpr std::size_t SLAB_CAPACITY = 1u << 18;
+
+	private:
+
+		struct AlignedDelete
+		{
+			void operator()(double* slab) const;
+		};
+
+		std::mutex mutex;
+
+		std::vector <std::unique_ptr <double[], AlignedDelete>> slabs;
+
+		// freeBlocks[n] holds released blocks of 2^n samples.
+		std::array <std::vector <double*>, 48> freeBlocks;
+
+		double* slab = nullptr;
+		std::size_t slabUsed = 0;
+		std::size_t slabSize = 0;
+
+	public:
+
+		DelayPool() = default;
+
+		DelayPool(const DelayPool&) = delete;
+
+		DelayPool& operator=(const DelayPool&) = delete;
+
+		/**
+		 * The process wide pool. It is deliberately never destroyed, so delay
+		 * lines with static storage duration can still release into it.
+		 */
+		static DelayPool& getDefault();
+
+		/**
+		 * @return A zeroed, 64 byte aligned block of exactly 'capacity' samples,
+		 * capacity must be a power of two no smaller than MINIMUM_CAPACITY.
+		 */
+		double* acquire(std::size_t capacity);
+
+		void release(double* block, std::size_t capacity);
+
+		static std::size_t roundCapacity(std::size_t minimumCapacity);
+
+	};
+
+	/**
+	 * A power of two ring buffer owned by a delay line, backed by a DelayPool.
+	 *
+	 * Indices wrap with 'index & getMask()'. Copies get their own block from
+	 * the same pool.
+	 */
+	class DelayMemory
+	{
+
+	private:
+
+		DelayPool* pool = nullptr;
+
+		double* data = nullptr;
+
+		std::size_t capacity = 0;
+
+	public:
+
+		DelayMemory() = default;
+
+		explicit DelayMemory(std::size_t minimumCapacity, DelayPool& _pool = DelayPool::getDefault());
+
+		DelayMemory(const DelayMemory& other);
+
+		DelayMemory(DelayMemory&& other) noexcept;
+
+		DelayMemory& operator=(const DelayMemory& other);
+
+		DelayMemory& operator=(DelayMemory&& other) noexcept;
+
+		~DelayMemory();
+
+		/**
+		 * Makes room for at least 'minimumCapacity' samples. When the buffer
+		 * grows, the ring is unrolled so the sample at 'writeIndex' comes first
+		 * and 'writeIndex' is moved to where the next write belongs, so every
+		 * delay already in the line keeps its contents.
+		 */
+		void reserve(std::size_t minimumCapacity, std::size_t& writeIndex);
+
+		void clear();
+
+		inline double& operator[](std::size_t index)
+		{
+			return data[index];
+		}
+
+		inline const double& operator[](std::size_t index) const
+		{
+			return data[index];
+		}
+
+		// Getters
+
+		[[nodiscard]] inline std::size_t getCapacity() const
+		{
+			return capacity;
+		}
+
+		[[nodiscard]] inline std::size_t getMask() const
+		{
+			return capacity - 1;
+		}
+
+		[[nodiscard]] inline double* getData()
+		{
+			return data;
+		}
+
+	};
+}
+
+#endif //MAXIMILIAN_DELAYMEMORY_HPP
@@ -0,0 +1,101 @@
+#ifndef MAXIMILIAN_MODULATEDDELAY_HPP
+#define MAXIMILIAN_MODULATEDDELAY_HPP
+
+#include "Delays/DelayMemory.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * A delay line for 'Channels' channels that share one write head and one
+	 * modulated delay time, the building block of the block Flanger and Chorus.
+	 *
+	 * Samples are stored interleaved, so a fractional read fetches every
+	 * channel from adjacent memory and the interpolation is the same
+	 * arithmetic on each lane.
+	 *
+	 * The line is sized when it is built or by reserve(), read() and write()
+	 * never allocate; longer delays are clamped to the longest one reserved.
+	 */
+	template <std::size_t Channels>
+	class ModulatedDelay
+	{
+
+	public:
+
+		using Frame = std::array <double, Channels>;
+
+	private:
+
+		static_assert(Channels > 0 && (Channels & (Channels - 1)) == 0, "Channels must be a power of two");
+
+		DelayMemory memory;
+
+		std::size_t writeIndex = 0;
+
+		std::size_t mask = 0;
+
+		double maximumDelay = 0.0;
+
+	public:
+
+		explicit ModulatedDelay(std::size_t _maximumDelay)
+		{
+			reserve(_maximumDelay);
+		}
+
+		// Longest delay that will be read, in samples. Allocates, keep off the audio thread.
+		void reserve(std::size_t _maximumDelay)
+		{
+			std::size_t interleavedIndex = writeIndex * Channels;
+			memory.reserve((_maximumDelay + 2) * Channels, interleavedIndex);
+			writeIndex = interleavedIndex / Channels;
+			mask = memory.getCapacity() / Channels - 1;
+			maximumDelay = double(mask - 1);
+		}
+
+		// Linearly interpolated read 'delay' samples behind the write head, at least one sample.
+		inline Frame read(double delay)
+		{
+			if (delay < 1.0)
+			{
+				delay = 1.0;
+			}
+			else if (delay > maximumDelay)
+			{
+				delay = maximumDelay;
+			}
+			const std::size_t whole = std::size_t(delay);
+			const double fraction = delay - whole;
+			const double* newer = memory.getData() + ((writeIndex - whole) & mask) * Channels;
+			const double* older = memory.getData() + ((writeIndex - whole - 1) & mask) * Channels;
+			Frame y;
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				y[c] = newer[c] + fraction * (older[c] - newer[c]);
+			}
+			return y;
+		}
+
+		inline void write(const Frame& x)
+		{
+			double* slot = memory.getData() + writeIndex * Channels;
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				slot[c] = x[c];
+			}
+			writeIndex = (writeIndex + 1) & mask;
+		}
+
+		void clear()
+		{
+			memory.clear();
+		}
+
+	};
+}
+
+#endif //MAXIMILIAN_MODULATEDDELAY_HPP
@@ -0,0 +1,124 @@
+#ifndef MAXIMILIAN_MULTITAPDELAY_HPP
+#define MAXIMILIAN_MULTITAPDELAY_HPP
+
+#include "Delays/DelayMemory.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * A delay line with one write head and any number of read taps.
+	 *
+	 * Every sample the input plus the fed back taps is written once, and each
+	 * tap reads at its own fractional delay. Tap outputs are mixed to the
+	 * outputs through a gain matrix (gain[output][tap]) and back into the
+	 * write head through a feedback vector (feedback[tap]).
+	 *
+	 * Delays set with setDelay() are reached by a linear ramp over the next
+	 * processed block, so a delay time changed once per block (from an LFO at
+	 * control rate, say) moves smoothly instead of jumping.
+	 *
+	 * Configuration calls that size the line or change the number of taps or
+	 * outputs allocate and belong on a setup thread. setDelay() never does,
+	 * delays longer than the line was reserved for are clamped.
+	 */
+	class MultiTapDelay
+	{
+
+	public:
+
+		enum class Interpolation : unsigned char
+		{
+			Linear,     /*!< Two points, cheapest. */
+			Hermite,    /*!< Four point, third order. Best for modulated taps. */
+			AllPass     /*!< First order all-pass, flat magnitude. Best for fixed taps. */
+		};
+
+	private:
+
+		DelayMemory memory;
+
+		std::size_t writeIndex = 0;
+
+		std::size_t outputs = 1;
+
+		Interpolation interpolation = Interpolation::Linear;
+
+		// Per tap, laid out as arrays over the taps.
+		std::vector <double> delay;
+		std::vector <double> targetDelay;
+		std::vector <double> increment;
+		std::vector <double> feedback;
+		std::vector <double> allPassState;
+		std::vector <double> taps;
+
+		// gain[output * numTaps + tap]
+		std::vector <double> gain;
+
+		// One sample of every output.
+		std::vector <double> frame;
+
+		double maximumDelay = 0.0;
+
+		bool primed = false;
+
+		double readTap(std::size_t tap, double delaySamples);
+
+		void tick(double input, double* output);
+
+	public:
+
+		MultiTapDelay() : MultiTapDelay(0, 1, 1)
+		{
+		}
+
+		MultiTapDelay(std::size_t _maximumDelay, std::size_t numTaps, std::size_t numOutputs = 1);
+
+		// Longest delay any tap will use, in samples. Allocates, call outside the audio callback.
+		void reserve(std::size_t _maximumDelay);
+
+		// Mono input, output 0 returned.
+		double play(double input);
+
+		// Mono input, one sample per output written to 'output'.
+		void play(double input, double* output);
+
+		/**
+		 * Processes a block. output[o] receives 'frames' samples for output o.
+		 * Tap delays ramp from their previous values to the ones last set.
+		 */
+		void process(const double* input, double* const* output, std::size_t frames);
+
+		void clear();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumTaps() const;
+
+		[[nodiscard]] std::size_t getNumOutputs() const;
+
+		[[nodiscard]] double getDelay(std::size_t tap) const;
+
+		// Setters
+
+		void setNumTaps(std::size_t numTaps);
+
+		void setNumOutputs(std::size_t numOutputs);
+
+		void setInterpolation(Interpolation _interpolation);
+
+		// Delay of a tap in samples, fractional values allowed, up to the maximum reserved.
+		void setDelay(std::size_t tap, double samples);
+
+		void setGain(std::size_t output, std::size_t tap, double _gain);
+
+		// Amount of a tap mixed back into the write head.
+		void setFeedback(std::size_t tap, double _feedback);
+
+	};
+}
+
+#endif //MAXIMILIAN_MULTITAPDELAY_HPP
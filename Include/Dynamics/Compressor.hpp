@@ -0,0 +1,226 @@
+#ifndef MAXIMILIAN_COMPRESSOR_HPP
+#define MAXIMILIAN_COMPRESSOR_HPP
+
+#include "Definition/Settings.hpp"
+#include "Dynamics/RunningMaximum.hpp"
+#include "Dynamics/Decibels.hpp"
+#include "Filters/Oversampler.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * A compressor and limiter for whole blocks of any number of channels.
+	 *
+	 * The level is detected from the input, or a side-chain, as the peak
+	 * over the look-ahead or the RMS over a window, and linked across
+	 * channels as far as setLink() says. In Compressor mode a gain computer
+	 * works in decibels, with a soft knee, and attack and release smooth the
+	 * gain reduction. In the Limiter modes the gain is held at its lowest
+	 * over the look-ahead and averaged over it, which brings the gain down
+	 * smoothly but fully before each peak arrives, so the output never goes
+	 * over the ceiling; TruePeakLimiter does the same with the level between
+	 * samples, found at four times the rate. The audio is delayed by the
+	 * look-ahead, and in TruePeakLimiter mode by the upsampling filter and
+	 * TRUE_PEAK_GUARD as well, getLatency().
+	 *
+	 * 	Compressor bus;
+	 * 	bus.setup(2, 5.0);
+	 * 	bus.setThreshold(-18).setRatio(4).setKnee(6).setLookahead(2);
+	 * 	bus.process(channels, channels, frames);
+	 *
+	 * The decibel conversions are the polynomials of Decibels, so each stage
+	 * is a plain loop over the block that the compiler vectorises; only
+	 * attack and release run sample by sample.
+	 * Nothing allocates after setup().
+	 */
+	class Compressor
+	{
+
+	public:
+
+		enum class Mode : unsigned char
+		{
+			Compressor,
+			Limiter,            /*!< Threshold is the ceiling, no overshoot. */
+			TruePeakLimiter     /*!< As Limiter, on the level between samples too. */
+		};
+
+		enum class Detector : unsigned char
+		{
+			Peak,   /*!< Largest over the look-ahead. */
+			RMS     /*!< Over setWindow(). Compressor mode only. */
+		};
+
+		static constexpr std::size_t TRUE_PEAK_FACTOR = 4;
+
+		// Samples either side of a true peak the gain stays at its lowest, so the ones it is rebuilt from are all turned down.
+		static constexpr std::size_t TRUE_PEAK_GUARD = 12;
+
+	private:
+
+		// A sum over the last 'length' values, summed again from scratch every lap so it doesn't drift.
+		struct RunningSum
+		{
+			std::vector <double> ring;
+			double sum = 0.0;
+			double fresh = 0.0;
+			std::size_t index = 0;
+			std::size_t length = 1;
+
+			void setup(std::size_t maximumLength);
+
+			void setLength(std::size_t _length);
+
+			inline double push(const double value)
+			{
+				sum += value - ring[index];
+				fresh += value;
+				ring[index] = value;
+				if (++index == length)
+				{
+					index = 0;
+					sum = fresh;
+					fresh = 0.0;
+				}
+				return sum;
+			}
+		};
+
+		struct Channel
+		{
+			// The audio, delayed by the latency.
+			std::vector <double> delay;
+
+			RunningMaximum peak;
+			RunningSum squares;
+			RunningSum average;
+			Oversampler oversampler;
+
+			// Over one block.
+			std::vector <double> level;
+			std::vector <double> gain;
+
+			// Gain reduction in dB for the compressor, linear gain for the limiter.
+			double smoothed = 0.0;
+		};
+
+		std::vector <Channel> channels;
+
+		std::vector <double> oversampled;
+
+		// The channels' pointers moved along the block.
+		std::vector <const double*> inputPointers;
+		std::vector <const double*> sidechainPointers;
+		std::vector <double*> outputPointers;
+
+		std::size_t maximumBlock = 0;
+		std::size_t maximumLookahead = 0;
+		std::size_t delayMask = 0;
+		std::size_t writeIndex = 0;
+
+		// In samples, from the times in milliseconds.
+		std::size_t lookahead = 0;
+		std::size_t window = 1;
+		std::size_t latency = 0;
+		double lookaheadTime = 0.0;
+		double windowTime = 10.0;
+
+		Mode mode = Mode::Compressor;
+		Detector detector = Detector::Peak;
+
+		double threshold = -12.0;
+		double ratio = 4.0;
+		double knee = 6.0;
+		double makeup = 1.0;
+		double link = 1.0;
+		double attackCoefficient = 0.0;
+		double releaseCoefficient = 0.0;
+		double attackTime = 5.0;
+		double releaseTime = 100.0;
+
+		// The lowest gain of the last block, in dB.
+		double reduction = 0.0;
+
+		// Windows, latency and coefficients from the settings. Clears the detectors.
+		void configure();
+
+		void processBlock(const double* const* inputs, double* const* outputs, std::size_t frames,
+				const double* const* sidechain);
+
+	public:
+
+		Compressor() = default;
+
+		/**
+		 * Allocates for 'numChannels' channels, a look-ahead up to
+		 * 'longestLookahead' milliseconds and blocks up to 'block' samples
+		 * (longer ones are processed in pieces). Call it outside the audio
+		 * callback.
+		 */
+		void setup(std::size_t numChannels, double longestLookahead = 10.0, std::size_t block = Settings::BUFFER_SIZE);
+
+		/**
+		 * 'frames' samples of every channel, inputs[channel][frame]. Outputs
+		 * may be the inputs. 'sidechain', when given, is detected instead of
+		 * the inputs, one signal per channel.
+		 */
+		void process(const double* const* inputs, double* const* outputs, std::size_t frames,
+				const double* const* sidechain = nullptr);
+
+		// One channel in place, for a compressor set up with one channel.
+		void process(double* data, std::size_t frames);
+
+		// Clears the detectors and the delayed audio.
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		// Delay from input to output, in samples.
+		[[nodiscard]] std::size_t getLatency() const;
+
+		// The most gain taken away during the last block, in dB, 0 or less.
+		[[nodiscard]] double getGainReduction() const;
+
+		[[nodiscard]] Mode getMode() const;
+
+		// Setters
+
+		Compressor& setMode(Mode _mode);
+
+		Compressor& setDetector(Detector _detector);
+
+		// In dB. The ceiling in the limiter modes.
+		Compressor& setThreshold(double decibels);
+
+		Compressor& setRatio(double _ratio);
+
+		// Width of the soft knee around the threshold, in dB. 0 for a hard knee.
+		Compressor& setKnee(double decibels);
+
+		// In milliseconds. The limiters attack over the look-ahead instead.
+		Compressor& setAttack(double milliseconds);
+
+		Compressor& setRelease(double milliseconds);
+
+		// In milliseconds, up to the maximum given to setup(). Changes the latency and clears the detectors.
+		Compressor& setLookahead(double milliseconds);
+
+		// RMS window, in milliseconds up to a second. Clears the detectors.
+		Compressor& setWindow(double milliseconds);
+
+		// Gain after compression, in dB. Compressor mode only, so the limiters keep their ceiling.
+		Compressor& setMakeup(double decibels);
+
+		// 0 detects each channel on its own, 1 uses the loudest channel for all of them.
+		Compressor& setLink(double amount);
+
+	};
+}
+
+#endif //MAXIMILIAN_COMPRESSOR_HPP
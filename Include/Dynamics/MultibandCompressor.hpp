@@ -0,0 +1,187 @@
+#ifndef MAXIMILIAN_MULTIBANDCOMPRESSOR_HPP
+#define MAXIMILIAN_MULTIBANDCOMPRESSOR_HPP
+
+#include "Definition/Settings.hpp"
+#include "Dynamics/Decibels.hpp"
+#include "Filters/Crossover.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Compression and expansion in 2 to 5 bands, for any number of channels.
+	 *
+	 * Each channel is split by a Crossover, every band has its own detector,
+	 * gain computer and attack and release, and the bands are added back
+	 * together. Since the Crossover's bands sum to an all-pass, a band whose
+	 * gain doesn't move leaves the sum unchanged in magnitude, and nothing is
+	 * delayed: getLatency() is 0.
+	 *
+	 * 	MultibandCompressor master;
+	 * 	master.setup(2);
+	 * 	master.setNumBands(3).setFrequency(0, 150).setFrequency(1, 4000);
+	 * 	master.setThreshold(0, -20).setRatio(0, 3);
+	 * 	master.setMode(2, MultibandCompressor::Mode::Expander).setThreshold(2, -50).setRange(2, 12);
+	 * 	master.process(channels, channels, frames);
+	 *
+	 * The settings of the bands are kept as arrays over the bands, like the
+	 * Crossover's filters, so each stage handles every band of a frame in one
+	 * vectorised pass; the gain computers run over the whole block at once.
+	 * Nothing allocates after setup().
+	 */
+	class MultibandCompressor
+	{
+
+	public:
+
+		static constexpr std::size_t MAX_BANDS = Crossover::MAX_BANDS;
+
+		enum class Mode : unsigned char
+		{
+			Compressor, /*!< Turns the band down above the threshold. */
+			Expander    /*!< Turns the band down below the threshold. */
+		};
+
+		enum class Detector : unsigned char
+		{
+			Peak,   /*!< Rises at once, falls over the window. */
+			RMS     /*!< Averaged over the window. */
+		};
+
+	private:
+
+		using Frame = Crossover::Frame;
+
+		struct Channel
+		{
+			Crossover crossover;
+
+			// Frame-major over one block, MAX_BANDS values per frame.
+			std::vector <double> bands;
+			std::vector <double> level;
+			std::vector <double> gain;
+
+			Frame detected{ };
+			Frame smoothed{ };
+		};
+
+		// The crossover the channels copy, kept for setup().
+		Crossover crossover;
+
+		std::vector <Channel> channels;
+
+		// The loudest channel of each band, frame-major over one block.
+		std::vector <double> loudest;
+
+		std::vector <const double*> inputPointers;
+		std::vector <double*> outputPointers;
+
+		std::size_t maximumBlock = 0;
+
+		Detector detector = Detector::Peak;
+		double link = 1.0;
+
+		// Per band.
+		alignas(64) Frame threshold{ };
+		alignas(64) Frame slope{ };
+		alignas(64) Frame direction{ };
+		alignas(64) Frame knee{ };
+		alignas(64) Frame floor{ };
+		alignas(64) Frame makeup{ };        // In dB.
+		alignas(64) Frame windowCoefficient{ };
+		alignas(64) Frame attackCoefficient{ };
+		alignas(64) Frame releaseCoefficient{ };
+
+		Frame ratio{ };
+		Frame reduction{ };
+
+		void processBlock(const double* const* inputs, double* const* outputs, std::size_t frames);
+
+		// Slope and direction from the mode and ratio of a band.
+		void shape(std::size_t band, Mode mode);
+
+		[[nodiscard]] std::size_t clampBand(std::size_t band) const;
+
+	public:
+
+		MultibandCompressor();
+
+		/**
+		 * Allocates for 'numChannels' channels and blocks up to 'block'
+		 * samples (longer ones are processed in pieces). Call it outside the
+		 * audio callback.
+		 */
+		void setup(std::size_t numChannels, std::size_t block = Settings::BUFFER_SIZE);
+
+		// 'frames' samples of every channel, inputs[channel][frame]. Outputs may be the inputs.
+		void process(const double* const* inputs, double* const* outputs, std::size_t frames);
+
+		// One channel in place, for a compressor set up with one channel.
+		void process(double* data, std::size_t frames);
+
+		// Clears the crossovers and the detectors.
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		[[nodiscard]] std::size_t getNumBands() const;
+
+		[[nodiscard]] double getFrequency(std::size_t crossover) const;
+
+		[[nodiscard]] static constexpr std::size_t getLatency()
+		{
+			return 0;
+		}
+
+		// The most gain taken away from 'band' during the last block, in dB, 0 or less.
+		[[nodiscard]] double getGainReduction(std::size_t band) const;
+
+		[[nodiscard]] Mode getMode(std::size_t band) const;
+
+		// Setters
+
+		// 2 to MAX_BANDS. Clears the crossovers.
+		MultibandCompressor& setNumBands(std::size_t numBands);
+
+		// Frequency in Hz between band 'crossover' and the one above it, rising from one crossover to the next.
+		MultibandCompressor& setFrequency(std::size_t crossover, double frequency);
+
+		MultibandCompressor& setDetector(Detector _detector);
+
+		// 0 detects each channel on its own, 1 uses the loudest channel of each band for all of them.
+		MultibandCompressor& setLink(double amount);
+
+		MultibandCompressor& setMode(std::size_t band, Mode mode);
+
+		// In dB.
+		MultibandCompressor& setThreshold(std::size_t band, double decibels);
+
+		// Compressors take 'ratio' dB in for 1 out above the threshold, expanders 1 in for 'ratio' out below it.
+		MultibandCompressor& setRatio(std::size_t band, double _ratio);
+
+		// Width of the soft knee around the threshold, in dB. 0 for a hard knee.
+		MultibandCompressor& setKnee(std::size_t band, double decibels);
+
+		// The most gain the band may lose, in dB. Mostly for expanders.
+		MultibandCompressor& setRange(std::size_t band, double decibels);
+
+		// Gain after the band's compression, in dB.
+		MultibandCompressor& setMakeup(std::size_t band, double decibels);
+
+		// In milliseconds.
+		MultibandCompressor& setAttack(std::size_t band, double milliseconds);
+
+		MultibandCompressor& setRelease(std::size_t band, double milliseconds);
+
+		// Detector time, in milliseconds.
+		MultibandCompressor& setWindow(std::size_t band, double milliseconds);
+
+	};
+}
+
+#endif //MAXIMILIAN_MULTIBANDCOMPRESSOR_HPP
@@ -0,0 +1,80 @@
+#ifndef MAXIMILIAN_RUNNINGMAXIMUM_HPP
+#define MAXIMILIAN_RUNNINGMAXIMUM_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * The largest of the last 'window' values pushed, in constant time per
+	 * value however long the window.
+	 *
+	 * It keeps only the values that can still become the maximum, in a
+	 * deque that falls from front to back: a new value removes the smaller
+	 * ones before it, and the front leaves once it is older than the window.
+	 * For a running minimum, push negated values.
+	 */
+	class RunningMaximum
+	{
+
+	private:
+
+		std::vector <double> values;
+
+		std::vector <std::uint64_t> times;
+
+		std::size_t mask = 0;
+
+		std::size_t window = 1;
+
+		std::uint64_t head = 0;
+		std::uint64_t tail = 0;
+		std::uint64_t now = 0;
+
+	public:
+
+		RunningMaximum() = default;
+
+		explicit RunningMaximum(std::size_t maximumWindow);
+
+		// Allocates room for windows up to 'maximumWindow'; call outside the audio callback.
+		void setup(std::size_t maximumWindow);
+
+		// Adds a value and returns the largest of the last 'window'.
+		inline double push(const double value)
+		{
+			while (tail != head && values[(tail - 1) & mask] <= value)
+			{
+				--tail;
+			}
+			values[tail & mask] = value;
+			times[tail & mask] = now;
+			++tail;
+
+			// One value in, so at most one is too old.
+			if (times[head & mask] + window <= now)
+			{
+				++head;
+			}
+			++now;
+			return values[head & mask];
+		}
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getWindow() const;
+
+		// Setters
+
+		// Values, at least 1 and at most the maximum given to setup(). Resets.
+		void setWindow(std::size_t _window);
+
+	};
+}
+
+#endif //MAXIMILIAN_RUNNINGMAXIMUM_HPP
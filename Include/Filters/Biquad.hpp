@@ -0,0 +1,389 @@
+#ifndef MAXIMILIAN_BIQUAD_HPP
+#define MAXIMILIAN_BIQUAD_HPP
+
+#include "Definition/Settings.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Coefficients of one second order section, normalised so that a0 == 1.
+	 *
+	 * H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+	 */
+	struct BiquadCoefficients
+	{
+		double b0 = 1.0;
+		double b1 = 0.0;
+		double b2 = 0.0;
+		double a1 = 0.0;
+		double a2 = 0.0;
+
+		bool operator==(const BiquadCoefficients& other) const
+		{
+			return b0 == other.b0 && b1 == other.b1 && b2 == other.b2 && a1 == other.a1 && a2 == other.a2;
+		}
+
+		bool operator!=(const BiquadCoefficients& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	/**
+	 * Coefficient designer following Robert Bristow-Johnson's Audio EQ Cookbook
+	 * (http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt).
+	 *
+	 * frequency is in Hz, q is the quality factor of the section and gain is in
+	 * dB (only used by Peaking, LowShelf and HighShelf). For the shelves a q of
+	 * 0.7071 gives the steepest transition without overshoot.
+	 */
+	class BiquadDesigner
+	{
+
+	public:
+
+		enum class Type : unsigned char
+		{
+			LowPass,
+			HighPass,
+			BandPass,   /*!< Constant 0 dB peak gain. */
+			Notch,
+			Peaking,
+			LowShelf,
+			HighShelf,
+			AllPass
+		};
+
+		static constexpr double BUTTERWORTH_Q = 0.70710678118654752440;
+
+		static BiquadCoefficients design(Type type, double frequency, double q = BUTTERWORTH_Q, double gain = 0.0,
+				double sampleRate = Settings::SAMPLE_RATE);
+
+		/**
+		 * Q of section 'section' (0 based) of an even order Butterworth filter
+		 * split into order / 2 second order sections.
+		 */
+		static double butterworthQ(std::size_t order, std::size_t section);
+	};
+
+	/**
+	 * A single second order section for one channel, transposed direct form II.
+	 */
+	class Biquad
+	{
+
+	private:
+
+		BiquadCoefficients coefficients;
+
+		double s1 = 0.0;
+		double s2 = 0.0;
+
+	public:
+
+		Biquad() = default;
+
+		explicit Biquad(const BiquadCoefficients& _coefficients) : coefficients(_coefficients)
+		{
+		}
+
+		inline double play(double input)
+		{
+			const double output = coefficients.b0 * input + s1;
+			s1 = coefficients.b1 * input - coefficients.a1 * output + s2;
+			s2 = coefficients.b2 * input - coefficients.a2 * output;
+			return output;
+		}
+
+		// Filters a block; input and output may be the same buffer.
+		void process(const double* input, double* output, std::size_t frames);
+
+		// As above, moving the coefficients linearly to 'target' over the block.
+		void process(const double* input, double* output, std::size_t frames, const BiquadCoefficients& target);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] const BiquadCoefficients& getCoefficients() const;
+
+		// Setters
+
+		// Jumps straight to the new coefficients, use the ramped process to avoid clicks.
+		void setCoefficients(const BiquadCoefficients& _coefficients);
+
+	};
+
+	/**
+	 * A cascade of 'Stages' second order sections applied to 'Channels'
+	 * independent channels at once.
+	 *
+	 * Coefficients and state are stored per stage as arrays over the
+	 * channels, so the inner loop of every section is the same arithmetic
+	 * over contiguous lanes and is vectorised by the compiler. Each channel
+	 * may have its own coefficients (an EQ per strip in a mixer, say).
+	 *
+	 * New coefficients are reached by linear interpolation across the next
+	 * processed block. The (a1, a2) stability region of a second order
+	 * section is a triangle, so interpolating between two stable sections
+	 * never passes through an unstable one.
+	 */
+	template <std::size_t Channels, std::size_t Stages = 1>
+	class BiquadBank
+	{
+
+	public:
+
+		using Frame = std::array <double, Channels>;
+
+	private:
+
+		struct Lanes
+		{
+			alignas(32) Frame b0{ };
+			alignas(32) Frame b1{ };
+			alignas(32) Frame b2{ };
+			alignas(32) Frame a1{ };
+			alignas(32) Frame a2{ };
+		};
+
+		std::array <Lanes, Stages> current{ };
+		std::array <Lanes, Stages> target{ };
+		std::array <Frame, Stages> s1{ };
+		std::array <Frame, Stages> s2{ };
+
+		bool ramping = false;
+
+		inline void tick(Frame& x, std::size_t stage, const Lanes& k)
+		{
+			Frame& z1 = s1[stage];
+			Frame& z2 = s2[stage];
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				const double y = k.b0[c] * x[c] + z1[c];
+				z1[c] = k.b1[c] * x[c] - k.a1[c] * y + z2[c];
+				z2[c] = k.b2[c] * x[c] - k.a2[c] * y;
+				x[c] = y;
+			}
+		}
+
+	public:
+
+		static_assert(Channels > 0 && Stages > 0, "BiquadBank needs at least one channel and one stage");
+
+		BiquadBank()
+		{
+			for (std::size_t stage = 0; stage < Stages; ++stage)
+			{
+				current[stage].b0.fill(1.0);
+			}
+			target = current;
+		}
+
+		// Filters one frame in place, one value per channel.
+		inline void play(Frame& frame)
+		{
+			for (std::size_t stage = 0; stage < Stages; ++stage)
+			{
+				tick(frame, stage, current[stage]);
+			}
+		}
+
+		// Filters planar buffers in place, channels[c] holds 'frames' samples of channel c.
+		void process(double* const* channels, std::size_t frames)
+		{
+			if (frames == 0)
+			{ return; }
+
+			if (!ramping)
+			{
+				for (std::size_t n = 0; n < frames; ++n)
+				{
+					Frame frame;
+					for (std::size_t c = 0; c < Channels; ++c)
+					{ frame[c] = channels[c][n]; }
+					play(frame);
+					for (std::size_t c = 0; c < Channels; ++c)
+					{ channels[c][n] = frame[c]; }
+				}
+				return;
+			}
+
+			const double step = 1.0 / frames;
+			std::array <Lanes, Stages> delta;
+			for (std::size_t stage = 0; stage < Stages; ++stage)
+			{
+				for (std::size_t c = 0; c < Channels; ++c)
+				{
+					delta[stage].b0[c] = (target[stage].b0[c] - current[stage].b0[c]) * step;
+					delta[stage].b1[c] = (target[stage].b1[c] - current[stage].b1[c]) * step;
+					delta[stage].b2[c] = (target[stage].b2[c] - current[stage].b2[c]) * step;
+					delta[stage].a1[c] = (target[stage].a1[c] - current[stage].a1[c]) * step;
+					delta[stage].a2[c] = (target[stage].a2[c] - current[stage].a2[c]) * step;
+				}
+			}
+
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				Frame frame;
+				for (std::size_t c = 0; c < Channels; ++c)
+				{ frame[c] = channels[c][n]; }
+				for (std::size_t stage = 0; stage < Stages; ++stage)
+				{
+					Lanes& k = current[stage];
+					const Lanes& d = delta[stage];
+					for (std::size_t c = 0; c < Channels; ++c)
+					{
+						k.b0[c] += d.b0[c];
+						k.b1[c] += d.b1[c];
+						k.b2[c] += d.b2[c];
+						k.a1[c] += d.a1[c];
+						k.a2[c] += d.a2[c];
+					}
+					tick(frame, stage, k);
+				}
+				for (std::size_t c = 0; c < Channels; ++c)
+				{ channels[c][n] = frame[c]; }
+			}
+
+			// Land exactly on the target rather than on the accumulated increments.
+			current = target;
+			ramping = false;
+		}
+
+		void reset()
+		{
+			for (std::size_t stage = 0; stage < Stages; ++stage)
+			{
+				s1[stage].fill(0.0);
+				s2[stage].fill(0.0);
+			}
+		}
+
+		// Jumps every section straight to its target coefficients.
+		void snap()
+		{
+			current = target;
+			ramping = false;
+		}
+
+		// Setters
+
+		// Coefficients of one section of one channel, reached over the next block.
+		void setCoefficients(std::size_t stage, std::size_t channel, const BiquadCoefficients& coefficients)
+		{
+			Lanes& k = target[stage];
+			k.b0[channel] = coefficients.b0;
+			k.b1[channel] = coefficients.b1;
+			k.b2[channel] = coefficients.b2;
+			k.a1[channel] = coefficients.a1;
+			k.a2[channel] = coefficients.a2;
+			ramping = true;
+		}
+
+		// Same coefficients for one section of every channel.
+		void setCoefficients(std::size_t stage, const BiquadCoefficients& coefficients)
+		{
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				setCoefficients(stage, c, coefficients);
+			}
+		}
+
+	};
+
+	/**
+	 * A cascade of 'Stages' second order sections on a single channel,
+	 * vectorised across the stages.
+	 *
+	 * The sections of a cascade depend on each other within a sample, so
+	 * instead each stage works on the output its predecessor produced one
+	 * sample earlier and all stages advance together. The price is a latency
+	 * of Stages - 1 samples, reported by getLatency().
+	 */
+	template <std::size_t Stages>
+	class BiquadPipeline
+	{
+
+	private:
+
+		using Lane = std::array <double, Stages>;
+
+		alignas(32) Lane b0{ };
+		alignas(32) Lane b1{ };
+		alignas(32) Lane b2{ };
+		alignas(32) Lane a1{ };
+		alignas(32) Lane a2{ };
+
+		alignas(32) Lane x{ };
+		alignas(32) Lane z1{ };
+		alignas(32) Lane z2{ };
+
+	public:
+
+		static_assert(Stages > 0, "BiquadPipeline needs at least one stage");
+
+		BiquadPipeline()
+		{
+			b0.fill(1.0);
+		}
+
+		inline double play(double input)
+		{
+			x[0] = input;
+			Lane y;
+			for (std::size_t k = 0; k < Stages; ++k)
+			{
+				y[k] = b0[k] * x[k] + z1[k];
+				z1[k] = b1[k] * x[k] - a1[k] * y[k] + z2[k];
+				z2[k] = b2[k] * x[k] - a2[k] * y[k];
+			}
+			for (std::size_t k = Stages - 1; k > 0; --k)
+			{
+				x[k] = y[k - 1];
+			}
+			return y[Stages - 1];
+		}
+
+		// Filters a block; input and output may be the same buffer.
+		void process(const double* input, double* output, std::size_t frames)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				output[n] = play(input[n]);
+			}
+		}
+
+		void reset()
+		{
+			x.fill(0.0);
+			z1.fill(0.0);
+			z2.fill(0.0);
+		}
+
+		// Getters
+
+		[[nodiscard]] static constexpr std::size_t getLatency()
+		{
+			return Stages - 1;
+		}
+
+		// Setters
+
+		void setCoefficients(std::size_t stage, const BiquadCoefficients& coefficients)
+		{
+			b0[stage] = coefficients.b0;
+			b1[stage] = coefficients.b1;
+			b2[stage] = coefficients.b2;
+			a1[stage] = coefficients.a1;
+			a2[stage] = coefficients.a2;
+		}
+
+	};
+}
+
+#endif //MAXIMILIAN_BIQUAD_HPP
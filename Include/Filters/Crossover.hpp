@@ -0,0 +1,119 @@
+#ifndef MAXIMILIAN_CROSSOVER_HPP
+#define MAXIMILIAN_CROSSOVER_HPP
+
+#include "Filters/Biquad.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Splits one channel into 2 to 5 bands with fourth order Linkwitz-Riley
+	 * crossovers, so that the bands add back up to the input with a flat
+	 * magnitude.
+	 *
+	 * The low and high pass of a Linkwitz-Riley crossover sum to a second
+	 * order all-pass at its frequency. In the usual tree of crossovers the
+	 * lower bands miss the all-passes of the crossovers above them, so each
+	 * band gets those as well: band k is the high passes of the crossovers
+	 * below it, the low pass of its own and the all-passes of the ones
+	 * above. Every band is then a cascade of the same length on the input,
+	 * and the sum of the bands is the product of the all-passes, whatever is
+	 * done to the level of each band in between.
+	 *
+	 * The bands are the lanes of that cascade, stored like BiquadBank, so all
+	 * of them advance together in one vectorised pass per section.
+	 */
+	class Crossover
+	{
+
+	public:
+
+		static constexpr std::size_t MAX_BANDS = 5;
+
+		// One value per band; lanes past getNumBands() are always 0.
+		using Frame = std::array <double, MAX_BANDS>;
+
+	private:
+
+		// Two sections per crossover: the Linkwitz-Riley pair, or an all-pass and a pass-through.
+		static constexpr std::size_t STAGES = 2 * (MAX_BANDS - 1);
+
+		struct Lanes
+		{
+			alignas(64) Frame b0{ };
+			alignas(64) Frame b1{ };
+			alignas(64) Frame b2{ };
+			alignas(64) Frame a1{ };
+			alignas(64) Frame a2{ };
+		};
+
+		std::array <Lanes, STAGES> coefficients{ };
+		std::array <Frame, STAGES> s1{ };
+		std::array <Frame, STAGES> s2{ };
+
+		std::array <double, MAX_BANDS - 1> frequencies{ { 120.0, 1000.0, 4000.0, 10000.0 } };
+
+		std::size_t bands = 3;
+
+		void design();
+
+	public:
+
+		Crossover();
+
+		explicit Crossover(std::size_t numBands);
+
+		// Splits one sample, band k in output[k].
+		inline void play(const double input, Frame& output)
+		{
+			Frame x;
+			x.fill(input);
+			const std::size_t stages = 2 * (bands - 1);
+			for (std::size_t stage = 0; stage < stages; ++stage)
+			{
+				const Lanes& k = coefficients[stage];
+				Frame& z1 = s1[stage];
+				Frame& z2 = s2[stage];
+				for (std::size_t b = 0; b < MAX_BANDS; ++b)
+				{
+					const double y = k.b0[b] * x[b] + z1[b];
+					z1[b] = k.b1[b] * x[b] - k.a1[b] * y + z2[b];
+					z2[b] = k.b2[b] * x[b] - k.a2[b] * y;
+					x[b] = y;
+				}
+			}
+			output = x;
+		}
+
+		// Splits a block, band k of frame n in output[n * MAX_BANDS + k].
+		void process(const double* input, double* output, std::size_t frames);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumBands() const;
+
+		// Frequency in Hz between band 'crossover' and the one above it.
+		[[nodiscard]] double getFrequency(std::size_t crossover) const;
+
+		// Setters
+
+		// 2 to MAX_BANDS bands. Clears the filters.
+		void setNumBands(std::size_t numBands);
+
+		/**
+		 * Frequency in Hz between band 'crossover' and the one above it. The
+		 * frequencies must rise from one crossover to the next; the filters
+		 * jump to the new setting, so move them while the audio is quiet or in
+		 * small steps.
+		 */
+		void setFrequency(std::size_t crossover, double frequency);
+
+	};
+}
+
+#endif //MAXIMILIAN_CROSSOVER_HPP
@@ -0,0 +1,194 @@
+#ifndef MAXIMILIAN_OVERSAMPLER_HPP
+#define MAXIMILIAN_OVERSAMPLER_HPP
+
+#include "Definition/Settings.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace Maximilian
+{
+
+	/**
+	 * Linear phase half-band FIR in polyphase form, for changing the rate by two.
+	 *
+	 * Every other coefficient of a half-band filter is zero and the centre one
+	 * is 1/2, so one polyphase branch is a plain delay and only the other runs
+	 * as a filter: 'taps' multiplies per output pair. The kernel is a Kaiser
+	 * windowed sinc with around 100 dB of stop band attenuation.
+	 *
+	 * One instance keeps the history of one direction, use separate ones for
+	 * upsampling and downsampling.
+	 */
+	class HalfBand
+	{
+
+	private:
+
+		// Non-zero side coefficients, oldest input last.
+		std::vector <double> kernel;
+
+		// Input history stored twice, so the newest 'taps' samples are always contiguous.
+		std::vector <double> history;
+		std::vector <double> delayed;
+		std::size_t position = 0;
+
+		// Stores the newest sample at the current position, in both copies.
+		inline void push(std::vector <double>& line, double sample);
+
+		inline double convolve() const;
+
+	public:
+
+		HalfBand() = default;
+
+		// 'taps' is the number of non-zero side coefficients, even.
+		explicit HalfBand(std::size_t taps);
+
+		// Allocates; call outside the audio callback.
+		void setup(std::size_t taps);
+
+		// frames samples in, 2 * frames out.
+		void upsample(const double* input, double* output, std::size_t frames);
+
+		// 2 * frames samples in, frames out.
+		void downsample(const double* input, double* output, std::size_t frames);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getTaps() const;
+
+		// Group delay in samples at the higher of the two rates.
+		[[nodiscard]] std::size_t getLatency() const;
+
+	};
+
+	/**
+	 * Runs a non-linear processor at 2, 4 or 8 times the sample rate, so the
+	 * harmonics it creates above Nyquist are filtered away instead of
+	 * aliasing back into the audible band. Only the wrapped stage runs at the
+	 * higher rate, the rest of the graph stays at the base rate.
+	 *
+	 * 	Oversampler oversampler(4);
+	 * 	oversampler.process(input, output, frames, [&](double x)
+	 * 	{
+	 * 		return distortion.atanDist(x, 10.0);
+	 * 	});
+	 *
+	 * The rate is changed in steps of two through half-band stages, the first
+	 * one steep and the later ones (which only need to protect the bottom of
+	 * a band that is already band limited) progressively shorter. Blocks up
+	 * to the maximum given to setup() are processed in one pass, longer ones
+	 * in pieces, and nothing allocates after setup().
+	 */
+	class Oversampler
+	{
+
+	private:
+
+		struct Stage
+		{
+			HalfBand up;
+			HalfBand down;
+		};
+
+		std::vector <Stage> stages;
+
+		std::size_t factor = 1;
+
+		std::size_t maximumBlock = 0;
+
+		// Ping-pong buffers at the oversampled rate.
+		std::vector <double> front;
+		std::vector <double> back;
+
+		// Upsamples 'frames' base rate samples, returns the buffer holding the result.
+		double* up(const double* input, std::size_t frames);
+
+		// Downsamples the oversampled 'data' into 'frames' base rate samples.
+		void down(double* data, double* output, std::size_t frames);
+
+	public:
+
+		// Side taps of the half-band stages from the base rate up.
+		static constexpr std::size_t STAGE_TAPS[3] = { 32, 12, 10 };
+
+		Oversampler() : Oversampler(2)
+		{
+		}
+
+		explicit Oversampler(std::size_t _factor, std::size_t _maximumBlock = Settings::BUFFER_SIZE);
+
+		// Allocates; call outside the audio callback. factor is 1, 2, 4 or 8.
+		void setup(std::size_t _factor, std::size_t _maximumBlock = Settings::BUFFER_SIZE);
+
+		/**
+		 * Wraps a per-sample processor, anything callable as double(double).
+		 * input and output may be the same buffer.
+		 */
+		template <typename Processor>
+		void process(const double* input, double* output, std::size_t frames, Processor&& processor)
+		{
+			processBlock(input, output, frames, [&processor](double* data, const std::size_t count)
+			{
+				for (std::size_t n = 0; n < count; ++n)
+				{
+					data[n] = processor(data[n]);
+				}
+			});
+		}
+
+		/**
+		 * Wraps a block processor, callable as void(double* data, std::size_t frames),
+		 * which processes 'frames' oversampled samples in place.
+		 */
+		template <typename BlockProcessor>
+		void processBlock(const double* input, double* output, std::size_t frames, BlockProcessor&& processor)
+		{
+			while (frames > 0)
+			{
+				const std::size_t chunk = std::min(frames, maximumBlock);
+				double* data = up(input, chunk);
+				processor(data, chunk * factor);
+				down(data, output, chunk);
+				input += chunk;
+				output += chunk;
+				frames -= chunk;
+			}
+		}
+
+		// One sample through a per-sample processor.
+		template <typename Processor>
+		double play(double input, Processor&& processor)
+		{
+			double output;
+			process(&input, &output, 1, processor);
+			return output;
+		}
+
+		// The two halves on their own, for processors that need more than one input.
+		// output holds frames * getFactor() samples.
+		void upsample(const double* input, double* output, std::size_t frames);
+
+		// input holds frames * getFactor() samples.
+		void downsample(const double* input, double* output, std::size_t frames);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getFactor() const;
+
+		// Delay from input to output in base rate samples, fractional in general.
+		[[nodiscard]] double getLatency() const;
+
+		// Delay of upsample() alone, in base rate samples, for processors that only look at the upsampled signal.
+		[[nodiscard]] double getUpsampleLatency() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_OVERSAMPLER_HPP
@@ -0,0 +1,179 @@
+#ifndef MAXIMILIAN_SINCINTERPOLATOR_HPP
+#define MAXIMILIAN_SINCINTERPOLATOR_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Band limited interpolation of sample data with a Kaiser windowed sinc,
+	 * for reading a sample at any position and playback rate.
+	 *
+	 * The kernel is tabulated once per quality as a polyphase table: one row
+	 * of coefficients for each of PHASES fractional positions, and the
+	 * coefficients of a position between two rows are interpolated linearly.
+	 * At rates up to the original pitch a read is then one contiguous dot
+	 * product of 'taps' samples, a loop the compiler vectorises.
+	 *
+	 * Reading faster than the original rate (transposing up) would alias, so
+	 * there the kernel is stretched by the rate to lower its cutoff, up to
+	 * MAXIMUM_RATIO, and evaluated from a finer one sided table. That costs
+	 * 'ratio' times more taps.
+	 *
+	 * 	const SincInterpolator& sinc = SincInterpolator::get(SincInterpolator::Quality::High);
+	 * 	double y = sinc.interpolate(data, length, position, rate);
+	 *
+	 * Samples outside [0, length) read as silence.
+	 */
+	class SincInterpolator
+	{
+
+	public:
+
+		enum class Quality : unsigned char
+		{
+			Low,        /*!< 8 taps, around 50 dB. Cheapest, for large voice counts. */
+			Medium,     /*!< 16 taps, around 70 dB. */
+			High,       /*!< 32 taps, around 90 dB. */
+			Best        /*!< 64 taps, around 110 dB. For offline work. */
+		};
+
+		// Fractional positions tabulated between two samples.
+		static constexpr std::size_t PHASES = 512;
+
+		// Highest rate the cutoff follows, faster reads alias above it.
+		static constexpr double MAXIMUM_RATIO = 8.0;
+
+	private:
+
+		std::size_t taps = 0;
+
+		// (PHASES + 1) rows of 'taps' coefficients and the step to the next row.
+		std::vector <double> rows;
+		std::vector <double> steps;
+
+		// The kernel from its centre outwards, PHASES points per sample.
+		std::vector <double> kernel;
+
+		explicit SincInterpolator(Quality quality);
+
+		// Rate above one, where the kernel is stretched.
+		template <typename Sample>
+		double stretched(const Sample* data, long length, long whole, double fraction, double ratio) const
+		{
+			const long reach = long(std::ceil(double(taps / 2) * ratio));
+			const double scale = double(PHASES) / ratio;
+			const std::size_t end = kernel.size() - 1;
+			double sum = 0.0;
+			for (long k = -reach + 1; k <= reach; ++k)
+			{
+				const long index = whole + k;
+				if (index < 0 || index >= length)
+				{
+					continue;
+				}
+				const double at = std::fabs(double(k) - fraction) * scale;
+				const std::size_t point = std::size_t(at);
+				if (point >= end)
+				{
+					continue;
+				}
+				const double coefficient = kernel[point] + (at - double(point)) * (kernel[point + 1] - kernel[point]);
+				sum += coefficient * double(data[index]);
+			}
+			return sum / ratio;
+		}
+
+	public:
+
+		// The shared tables of a quality. The first call builds them, make it at setup.
+		static const SincInterpolator& get(Quality quality);
+
+		/**
+		 * The value of 'data' at 'position' (in samples), band limited for
+		 * reading it at 'ratio' samples per output sample.
+		 */
+		template <typename Sample>
+		double interpolate(const Sample* data, const long length, const double position, double ratio = 1.0) const
+		{
+			const double floor = std::floor(position);
+			const long whole = long(floor);
+			const double fraction = position - floor;
+
+			ratio = std::fabs(ratio);
+			if (ratio > 1.0)
+			{
+				return stretched(data, length, whole, fraction, std::fmin(ratio, MAXIMUM_RATIO));
+			}
+
+			const double row = fraction * double(PHASES);
+			const std::size_t phase = std::size_t(row);
+			const double blend = row - double(phase);
+			const double* coefficients = rows.data() + phase * taps;
+			const double* deltas = steps.data() + phase * taps;
+
+			const long first = whole - long(taps / 2) + 1;
+			if (first >= 0 && first + long(taps) <= length)
+			{
+				const Sample* window = data + first;
+				double sum = 0.0;
+				for (std::size_t j = 0; j < taps; ++j)
+				{
+					sum += (coefficients[j] + blend * deltas[j]) * double(window[j]);
+				}
+				return sum;
+			}
+
+			// Near the ends, skip the taps that fall outside the data.
+			double sum = 0.0;
+			for (std::size_t j = 0; j < taps; ++j)
+			{
+				const long index = first + long(j);
+				if (index >= 0 && index < length)
+				{
+					sum += (coefficients[j] + blend * deltas[j]) * double(data[index]);
+				}
+			}
+			return sum;
+		}
+
+		/**
+		 * Reads 'frames' samples starting at 'position', advancing by 'increment'
+		 * per sample and wrapping between loopStart and loopEnd (in samples).
+		 * Output is multiplied by 'gain', position is left after the last read.
+		 */
+		template <typename Sample>
+		void process(const Sample* data, const long length, double& position, const double increment, double* output,
+				const std::size_t frames, const double loopStart, const double loopEnd, const double gain = 1.0) const
+		{
+			const double span = loopEnd - loopStart;
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				output[n] = gain * interpolate(data, length, position, increment);
+				position += increment;
+				if (span > 0.0)
+				{
+					if (position >= loopEnd)
+					{
+						position -= span * std::floor((position - loopStart) / span);
+					}
+					else if (position < loopStart)
+					{
+						position += span * std::ceil((loopStart - position) / span);
+					}
+				}
+			}
+		}
+
+		// Getters
+
+		// Taps per read at rates up to one.
+		[[nodiscard]] std::size_t getTaps() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_SINCINTERPOLATOR_HPP
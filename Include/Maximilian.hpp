@@ -50,6 +50,9 @@
 #include <queue>
 #include <array>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 #if !defined(_WIN32) && (defined(unix) || defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
 #define OS_IS_UNIX true
@@ -68,6 +71,16 @@
 
 #include "Realtime/Audio.hpp"
 #include "Definition/AudioFormat.hpp"
+#include "Definition/Settings.hpp"
+#include "Delays/DelayMemory.hpp"
+#include "Delays/ModulatedDelay.hpp"
+#include "Filters/SincInterpolator.hpp"
+#include "Samples/SampleBuffer.hpp"
+#include "Samples/SampleData.hpp"
+#include "Samples/OneShotPlayer.hpp"
+#include "Sequencing/Transport.hpp"
+#include "Voices/EnvelopeBank.hpp"
+#include "Voices/VoiceAllocator.hpp"
 #include "Enum/SupportedArchitectures.hpp"
 
 using namespace std;
@@ -78,16 +91,6 @@ using namespace std;
 
 namespace Maximilian
 {
-	class Settings
-	{
-
-	public:
-
-		static constexpr unsigned short SAMPLE_RATE = 44'100;
-		static constexpr unsigned short CHANNELS = 2;
-		static constexpr unsigned short BUFFER_SIZE = 1'024;
-	};
-
 	class Oscilation
 	{
 
@@ -185,7 +188,8 @@ namespace Maximilian
 
 		double ramp(double startVal = 0, double endVal = 1, double duration = 1);
 
-		double ramps(vector <double> rampsArray);
+		//(time in seconds, level) pairs. For many voices, or whole blocks, see EnvelopeBank
+		double ramps(const vector <double>& rampsArray);
 
 		double ar(double attack = 0.1, double release = 0.1);
 
@@ -200,23 +204,41 @@ namespace Maximilian
 
 	};
 
+	/**
+	 * Delay line with a feedback loop.
+	 *
+	 * Storage comes from the shared DelayPool and is sized to the longest delay
+	 * asked for, rounded up to a power of two. The longest delay is given to
+	 * the constructor, and reserve() can grow the line before it plays:
+	 *
+	 * 	DelayLine echo(14'000);
+	 * 	DelayLine tape(DelayLine::DELAY_SIZE);   // as long as the old fixed line
+	 *
+	 * dl() never allocates, longer sizes are clamped to what was reserved.
+	 */
 	class DelayLine
 	{
 
+	public:
+
+		// The length of the old fixed line, in samples, for code that relied on it.
+		static constexpr int DELAY_SIZE = 88'200;
+
 	private:
 
 		int phase = 0;
 
-		double frequency = 0.0;
-		double startphase = 0.0;
-		double endphase = 0.0;
+		std::size_t writeIndex = 0;
+
 		double output = 0.0;
 
-		std::array <double, 88'200> memory{ };
+		DelayMemory memory;
 
 	public:
 
-		DelayLine() = default;
+		explicit DelayLine(std::size_t maximumDelay);
+
+		void reserve(std::size_t maximumDelay);
 
 		double dl(double input, int size, double feedback);
 
@@ -225,23 +247,28 @@ namespace Maximilian
 
 	};
 
+	/**
+	 * Linearly interpolated delay line, sized at construction like DelayLine.
+	 */
 	class FractionalDelay
 	{
 
 	public:
 
+		// Longest delay accepted by dl(), in samples, if the line was reserved for it.
 		static constexpr int DELAY_SIZE = 88'200;
 
 	private:
 
-		int writePointer = 0;
-		int readPointer = 0;
+		std::size_t writePointer = 0;
 
-		std::array <double, DELAY_SIZE> memory{ };
+		DelayMemory memory;
 
 	public:
 
-		FractionalDelay() = default;
+		explicit FractionalDelay(std::size_t maximumDelay);
+
+		void reserve(std::size_t maximumDelay);
 
 		double dl(double sig, double delayTime, double feedback);
 	};
@@ -260,11 +287,30 @@ namespace Maximilian
 		double z = 0.0;//pole
 		double c = 0.0;//filter coefficient
 
+		double r = 0.0;//resonance feedback coefficient
+
+		// Parameters the current coefficients were computed for, negative until first use.
+		double resonantCutoff = -1.0;
+		double resonantQ = -1.0;
+		double bandCutoff = -1.0;
+		double bandQ = -1.0;
+
 		std::array <double, 10> inputs{ };
 		std::array <double, 10> outputs{ };
 
+		void updateResonant(double cutoff1, double resonance);
+
+		void updateBandpass(double cutoff1, double resonance);
+
 	public:
 
+		enum class Mode
+		{
+			LoRes,
+			HiRes,
+			BandPass
+		};
+
 		Filter() = default;
 
 		double lores(double input, double cutoff1, double resonance);
@@ -277,6 +323,13 @@ namespace Maximilian
 
 		double hipass(double input, double cutoff);
 
+		// Runs lores, hires or bandpass over a whole block. When cutoff or resonance
+		// differ from the previous call the coefficients are ramped linearly across
+		// the block instead of jumping, so modulating once per block doesn't zipper.
+		// input and output may point to the same buffer.
+		void process(Mode mode, const double* input, double* output, std::size_t frames, double cutoff1,
+				double resonance);
+
 	};
 
 	class Mixer
@@ -347,7 +400,7 @@ namespace Maximilian
 
 		int myChunkSize;
 		int mySubChunk1Size;
-		int readChannel;
+		int readChannel = 0;
 		int myByteRate;
 
 		double position;
@@ -359,6 +412,36 @@ namespace Maximilian
 
 		LaggingExponential <double> loopRecordLag;
 
+		SincInterpolator::Quality interpolation = SincInterpolator::Quality::Medium;
+
+		//every channel of the file, converted once at load. Shared with copies of this clip
+		std::shared_ptr <const SampleData> sample;
+
+		//the same data when this clip created it, so it can change it without a copy. loopRecord()
+		//writes only through it, so it never copies or releases data on the audio thread
+		SampleData* editable = nullptr;
+
+		//data handed over by swapSampleData(), and once swapped in, the data it replaced
+		std::shared_ptr <const SampleData> pending;
+		std::atomic <bool> swapPending{ false };
+		std::mutex swapMutex;
+
+		SampleBuffer::Format storage = SampleBuffer::Format::Float;
+
+		double getSincIncrement(double speed) const;
+
+		//the sample data for writing, copied first if it is shared
+		SampleData& edit();
+
+		//takes the length, channels and sample rate from the current sample data
+		void useSample();
+
+		//a sample of the channel the mono playback functions use
+		inline double at(const long index) const
+		{
+			return sample->buffer.get(readChannel, index);
+		}
+
 	public:
 
 		short myBitsPerSample;
@@ -373,25 +456,62 @@ namespace Maximilian
 
 		void setLength(unsigned long numSamples);
 
+		//the sample data, planar and block readable, of every channel
+		const SampleBuffer& getData() const
+		{
+			return sample->buffer;
+		}
+
+		//for writing: copies the data first when other clips share it
+		SampleBuffer& editData()
+		{
+			return edit().buffer;
+		}
+
+		//the data this clip plays, to share with other clips
+		std::shared_ptr <const SampleData> getSampleData() const;
+
+		//plays 'data' from now on, without copying it. Call it outside the audio callback
+		void setSampleData(std::shared_ptr <const SampleData> data);
 
-		//	char* 	myData;
-		short* temp;
+		//hands 'data' over from any thread, a loader thread for instance. It replaces the
+		//current data at the next trigger() or update(), and the data it replaces is released
+		//by the next swap or the clip's destructor, so the audio thread never frees memory
+		void swapSampleData(std::shared_ptr <const SampleData> data);
 
-		// get/set for the Path property
+		//swaps in data from swapSampleData() if there is any. Never blocks
+		void update();
 
-		~Clip()
+		//the channel played by play(), playLoop() and the others
+		int getReadChannel() const
 		{
-			//		if (myData) free(myData);
-			if (temp)
-			{ free(temp); }
-			printf("freeing SampleData");
+			return readChannel;
+		}
+
+		void setReadChannel(int channel);
 
+		//Float by default. Int16 halves the memory. Converts loaded data and applies to later loads
+		void setStorage(SampleBuffer::Format format);
+
+		SampleBuffer::Format getStorage() const
+		{
+			return storage;
 		}
 
-		Clip() : temp(nullptr), position(0), recordPosition(0), myChannels(1), mySampleRate(Settings::SAMPLE_RATE)
+		//makes the data this clip's own, copying it if it is shared or mapped from the file, so
+		//loopRecord() can write to it. Call it outside the audio callback after loading,
+		//setSampleData(), update() or sharing the data with another clip; loopRecord() records
+		//nothing while the data isn't this clip's alone
+		void prepareRecord();
+
+		Clip();
+
+		Clip(const Clip& source) : Clip()
 		{
-		};
+			*this = source;
+		}
 
+		//shares the sample data, nothing is copied
 		Clip& operator=(const Clip& source)
 		{
 			if (this == &source)
@@ -401,11 +521,12 @@ namespace Maximilian
 			position = 0;
 			recordPosition = 0;
 			myChannels = source.myChannels;
-			mySampleRate = Settings::SAMPLE_RATE;
-			free(temp);
+			mySampleRate = source.mySampleRate;
+			readChannel = source.readChannel;
+			storage = source.storage;
+			sample = source.sample;
+			editable = nullptr;
 			myDataSize = source.myDataSize;
-			temp = (short*)malloc(myDataSize * sizeof(char));
-			memcpy(temp, source.temp, myDataSize * sizeof(char));
 			length = source.length;
 			return *this;
 		}
@@ -429,12 +550,12 @@ namespace Maximilian
 			loopRecordLag.addSample(recordEnabled);
 			if (recordPosition < start * length)
 			{ recordPosition = start * length; }
-			if (recordEnabled)
+			if (recordEnabled && editable != nullptr && sample.use_count() == 1)
 			{
-				double currentSample = temp[(unsigned long)recordPosition] / 32767.0;
+				double currentSample = at((long)recordPosition);
 				newSample = (recordMix * currentSample) + ((1.0 - recordMix) * newSample);
 				newSample *= loopRecordLag.value();
-				temp[(unsigned long)recordPosition] = newSample * 32767;
+				editable->buffer.set(readChannel, (unsigned long)recordPosition, float(newSample));
 			}
 			++recordPosition;
 			if (recordPosition >= end * length)
@@ -467,6 +588,16 @@ namespace Maximilian
 
 		double play4(double frequency, double start, double end);
 
+		//band limited windowed sinc playback, for transposing by large intervals. playSinc(speed)
+		//also corrects for a file sample rate that differs from Settings::SAMPLE_RATE
+		double playSinc(double speed);
+
+		double playSinc(double frequency, double start, double end);
+
+		void playSinc(double* buffer, std::size_t frames, double speed);
+
+		void setInterpolation(SincInterpolator::Quality quality);
+
 		double bufferPlay(unsigned char& bufferin, long length);
 
 		double bufferPlay(unsigned char& bufferin, double speed, long length);
@@ -484,6 +615,25 @@ namespace Maximilian
 		{
 			fstream myFile(filename.c_str(), ios::out | ios::binary);
 
+			// written back as 16 bit PCM, every channel interleaved
+			const SampleBuffer& data = sample->buffer;
+			std::vector <short> interleaved(data.getNumChannels() * data.getNumFrames());
+			for (std::size_t c = 0; c < data.getNumChannels(); ++c)
+			{
+				for (std::size_t i = 0; i < data.getNumFrames(); ++i)
+				{
+					interleaved[i * data.getNumChannels() + c] = SampleBuffer::toInt16(data.get(c, i));
+				}
+			}
+			myFormat = 1;
+			mySubChunk1Size = 16;
+			myChannels = short(data.getNumChannels());
+			myBitsPerSample = 16;
+			myBlockAlign = short(myChannels * 2);
+			myByteRate = mySampleRate * myBlockAlign;
+			myDataSize = int(interleaved.size() * sizeof(short));
+			myChunkSize = 36 + myDataSize;
+
 			// write the wav file per the wav file format
 			myFile.seekp(0, ios::beg);
 			myFile.write("RIFF", 4);
@@ -499,7 +649,7 @@ namespace Maximilian
 			myFile.write((char*)&myBitsPerSample, 2);
 			myFile.write("data", 4);
 			myFile.write((char*)&myDataSize, 4);
-			myFile.write((char*)temp, myDataSize);
+			myFile.write((char*)interleaved.data(), myDataSize);
 
 			return true;
 		}
@@ -561,6 +711,8 @@ namespace Maximilian
 
 	};
 
+	//per sample gate and compressor. For buses, look-ahead, side-chains and limiting, see Compressor
+	//(Dynamics/Compressor.hpp)
 	class Dyn
 	{
 
@@ -649,6 +801,7 @@ namespace Maximilian
 	public:
 		/*atan distortion, see http://www.musicdsp.org/showArchiveComment.php?ArchiveID=104*/
 		/*shape from 1 (soft clipping) to infinity (hard clipping)*/
+		/*aliases at high shapes, wrap it in an Oversampler (Filters/Oversampler.hpp) to avoid that*/
 		double atanDist(double in, double shape);
 
 		double fastAtanDist(double in, double shape);
@@ -659,6 +812,13 @@ namespace Maximilian
 	class Flanger
 	{
 	public:
+		//longest delay the lines hold unless setup() says otherwise, enough for a delay of 2047 at full depth
+		static constexpr std::size_t MAXIMUM_DELAY = 4'096;
+
+		//longest delay flange() will reach, delay * (1 + depth) + 1, for all the lines. Allocates, call outside the audio callback.
+		//longer delays are clamped
+		void setup(std::size_t maximumDelay);
+
 		//delay = delay time - ~800 sounds good
 		//feedback = 0 - 1
 		//speed = lfo speed in Hz, 0.0001 - 10 sounds good
@@ -667,14 +827,42 @@ namespace Maximilian
 		flange(double input, unsigned int delay, double feedback, double speed,
 				double depth);
 
-		DelayLine dl;
+		//block versions, mono and a stereo pair sharing one LFO. The LFO runs once every
+		//CONTROL_PERIOD samples, the delay time glides between those points and is read
+		//with fractional interpolation. input and output may be the same buffers
+		void
+		flange(const double* input, double* output, std::size_t frames, unsigned int delay, double feedback,
+				double speed, double depth);
+
+		void
+		flange(const double* const* input, double* const* output, std::size_t frames, unsigned int delay,
+				double feedback, double speed, double depth);
+
+		static constexpr std::size_t CONTROL_PERIOD = 32;
+
+		DelayLine dl{ MAXIMUM_DELAY };
 		Oscilation lfo;
 
+		ModulatedDelay <1> line{ MAXIMUM_DELAY };
+		ModulatedDelay <2> lines{ MAXIMUM_DELAY };
+
+		//delay time reached at the last control point, and the per sample glide towards the next
+		double currentDelay = -1.0;
+		double delayStep = 0.0;
+		std::size_t controlCountdown = 0;
+
 	};
 
 	class Chorus
 	{
 	public:
+		//as Flanger
+		static constexpr std::size_t MAXIMUM_DELAY = 4'096;
+
+		//longest delay chorus() will reach, delay * (1 + 1.02 * depth) + 1. Allocates, call outside the audio
+		//callback. longer delays are clamped
+		void setup(std::size_t maximumDelay);
+
 		//delay = delay time - ~800 sounds good
 		//feedback = 0 - 1
 		//speed = lfo speed in Hz, 0.0001 - 10 sounds good
@@ -683,12 +871,32 @@ namespace Maximilian
 		chorus(double input, unsigned int delay, double feedback, double speed,
 				double depth);
 
-		DelayLine dl, dl2;
+		//block versions, as Flanger. Both voices read from a single write head
+		void
+		chorus(const double* input, double* output, std::size_t frames, unsigned int delay, double feedback,
+				double speed, double depth);
+
+		void
+		chorus(const double* const* input, double* const* output, std::size_t frames, unsigned int delay,
+				double feedback, double speed, double depth);
+
+		static constexpr std::size_t CONTROL_PERIOD = 32;
+
+		DelayLine dl{ MAXIMUM_DELAY }, dl2{ MAXIMUM_DELAY };
 		Oscilation lfo;
 		Filter lopass;
 
+		ModulatedDelay <1> line{ MAXIMUM_DELAY };
+		ModulatedDelay <2> lines{ MAXIMUM_DELAY };
+
+		//delay times of both voices at the last control point, and their per sample glide
+		double currentDelay[2] = { -1.0, -1.0 };
+		double delayStep[2] = { 0.0, 0.0 };
+		std::size_t controlCountdown = 0;
+
 	};
 
+	//one channel, one sample at a time. To meter many channels at once, see MeterBank (Metering/MeterBank.hpp)
 	template <typename T>
 	class maxiEnvelopeFollowerType
 	{
@@ -780,11 +988,16 @@ namespace Maximilian
 
 		 w = filter.setCutoff(param1).setResonance(param2).play(w, 0.0, 1.0, 0.0, 0.0);
 
+		 or run whole blocks, with a fixed cutoff or with one cutoff per sample
+
+		 filter.process(in, out, frames, 0.0, 1.0, 0.0, 0.0);
+		 filter.process(in, cutoffs, out, frames, 0.0, 1.0, 0.0, 0.0);
+
 		 */
 	class StateVariableFilter
 	{
 	public:
-		StateVariableFilter() : v0z(0), v1(0), v2(0)
+		StateVariableFilter() : v0z(0), v1(0), v2(0), freq(-1), res(-1)
 		{
 			setParams(1000, 1);
 		}
@@ -803,6 +1016,16 @@ namespace Maximilian
 			return *this;
 		}
 
+		inline double getCutoff() const
+		{
+			return freq;
+		}
+
+		inline double getResonance() const
+		{
+			return res;
+		}
+
 		//run the filter, and get a mixture of lowpass, bandpass, highpass and notch outputs
 		inline double play(double w, double lpmix, double bpmix, double hpmix, double notchmix)
 		{
@@ -820,12 +1043,61 @@ namespace Maximilian
 			return (low * lpmix) + (band * bpmix) + (high * hpmix) + (notch * notchmix);
 		}
 
+		//as play, over a block at the current cutoff and resonance. input and output may be the same buffer
+		inline void
+		process(const double* input, double* output, std::size_t frames, double lpmix, double bpmix, double hpmix,
+				double notchmix)
+		{
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				output[i] = play(input[i], lpmix, bpmix, hpmix, notchmix);
+			}
+		}
+
+		//audio rate cutoff, one value in Hz per sample. Uses fastTan so modulating every sample stays cheap
+		inline void
+		process(const double* input, const double* cutoff, double* output, std::size_t frames, double lpmix,
+				double bpmix, double hpmix, double notchmix)
+		{
+			if (frames == 0)
+			{
+				return;
+			}
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				const double gi = fastTan(PI * cutoff[i] / Settings::SAMPLE_RATE);
+				const double gv = gi / (1.0 + gi * (gi + k));
+				const double w = input[i];
+				const double v1z = v1;
+				const double v3 = w + v0z - 2.0 * v2;
+				v1 += gv * v3 - 2.0 * (gi + k) * gv * v1z;
+				v2 += gi * gv * v3 + 2.0 * gv * v1z;
+				v0z = w;
+				output[i] = (v2 * lpmix) + (v1 * bpmix) + ((w - k * v1 - v2) * hpmix) + ((w - k * v1) * notchmix);
+			}
+			setParams(cutoff[frames - 1], res);
+		}
+
+		//tan(x) for 0 <= x < PI / 2, a [7/6] Pade approximant with the upper half of the range
+		//reflected through tan(x) = 1 / tan(PI / 2 - x). Relative error stays below 1e-9
+		static inline double fastTan(double x)
+		{
+			const bool reflect = x > PI * 0.25;
+			const double r = reflect ? PI * 0.5 - x : x;
+			const double r2 = r * r;
+			const double numerator = r * (135135.0 - r2 * (17325.0 - r2 * (378.0 - r2)));
+			const double denominator = 135135.0 - r2 * (62370.0 - r2 * (3150.0 - 28.0 * r2));
+			return reflect ? denominator / numerator : numerator / denominator;
+		}
+
 	private:
 		inline void setParams(double _freq, double _res)
 		{
+			if (_freq == freq && _res == res)
+			{ return; }
 			freq = _freq;
 			res = _res;
-			g = tan(PI * freq / Settings::SAMPLE_RATE);
+			g = fastTan(PI * freq / Settings::SAMPLE_RATE);
 			damping = res == 0 ? 0 : 1.0 / res;
 			k = damping;
 			ginv = g / (1.0 + g * (g + k));
@@ -840,6 +1112,159 @@ namespace Maximilian
 
 	};
 
+	/*
+		 StateVariableFilter for several independent channels or voices at once.
+
+		 Every lane has its own cutoff, resonance and state. The filter arithmetic
+		 is written as loops over the lanes so the compiler can vectorise it.
+
+		 StateVariableFilterN<8> voices;
+		 voices.setCutoff(3, 440.0);
+		 voices.process(channels, frames, 1.0, 0.0, 0.0, 0.0);
+		 */
+	template <std::size_t Lanes>
+	class StateVariableFilterN
+	{
+	public:
+		using Frame = std::array <double, Lanes>;
+
+		StateVariableFilterN()
+		{
+			freq.fill(1000);
+			res.fill(1);
+			for (std::size_t lane = 0; lane < Lanes; ++lane)
+			{
+				updateLane(lane);
+			}
+		}
+
+		//20 < cutoff < 20000
+		inline void setCutoff(std::size_t lane, double cutoff)
+		{
+			freq[lane] = cutoff;
+			updateLane(lane);
+		}
+
+		inline void setCutoff(double cutoff)
+		{
+			freq.fill(cutoff);
+			updateAll();
+		}
+
+		//from 0 upwards, starts to ring from 2-3ish, cracks a bit around 10
+		inline void setResonance(std::size_t lane, double q)
+		{
+			res[lane] = q;
+			updateLane(lane);
+		}
+
+		inline void setResonance(double q)
+		{
+			res.fill(q);
+			updateAll();
+		}
+
+		//one sample of every lane, filtered in place
+		inline void play(Frame& w, double lpmix, double bpmix, double hpmix, double notchmix)
+		{
+			for (std::size_t i = 0; i < Lanes; ++i)
+			{
+				const double v1z = v1[i];
+				const double v3 = w[i] + v0z[i] - 2.0 * v2[i];
+				v1[i] += g1[i] * v3 - g2[i] * v1z;
+				v2[i] += g3[i] * v3 + g4[i] * v1z;
+				v0z[i] = w[i];
+				w[i] = (v2[i] * lpmix) + (v1[i] * bpmix) + ((w[i] - k[i] * v1[i] - v2[i]) * hpmix) +
+					   ((w[i] - k[i] * v1[i]) * notchmix);
+			}
+		}
+
+		//planar buffers filtered in place, channels[lane] holds 'frames' samples
+		inline void process(double* const* channels, std::size_t frames, double lpmix, double bpmix, double hpmix,
+				double notchmix)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				Frame w;
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{ w[i] = channels[i][n]; }
+				play(w, lpmix, bpmix, hpmix, notchmix);
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{ channels[i][n] = w[i]; }
+			}
+		}
+
+		//as above with audio rate cutoff, cutoff[lane] holds one value in Hz per sample
+		inline void
+		process(double* const* channels, const double* const* cutoff, std::size_t frames, double lpmix, double bpmix,
+				double hpmix, double notchmix)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{
+					g[i] = StateVariableFilter::fastTan(PI * cutoff[i][n] / Settings::SAMPLE_RATE);
+				}
+				updateFromG();
+				Frame w;
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{ w[i] = channels[i][n]; }
+				play(w, lpmix, bpmix, hpmix, notchmix);
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{ channels[i][n] = w[i]; }
+			}
+			if (frames > 0)
+			{
+				for (std::size_t i = 0; i < Lanes; ++i)
+				{ freq[i] = cutoff[i][frames - 1]; }
+			}
+		}
+
+		inline void reset()
+		{
+			v0z.fill(0);
+			v1.fill(0);
+			v2.fill(0);
+		}
+
+	private:
+		inline void updateLane(std::size_t i)
+		{
+			g[i] = StateVariableFilter::fastTan(PI * freq[i] / Settings::SAMPLE_RATE);
+			k[i] = res[i] == 0 ? 0 : 1.0 / res[i];
+			g1[i] = g[i] / (1.0 + g[i] * (g[i] + k[i]));
+			g2[i] = 2.0 * (g[i] + k[i]) * g1[i];
+			g3[i] = g[i] * g1[i];
+			g4[i] = 2.0 * g1[i];
+		}
+
+		inline void updateAll()
+		{
+			for (std::size_t i = 0; i < Lanes; ++i)
+			{
+				g[i] = StateVariableFilter::fastTan(PI * freq[i] / Settings::SAMPLE_RATE);
+				k[i] = res[i] == 0 ? 0 : 1.0 / res[i];
+			}
+			updateFromG();
+		}
+
+		inline void updateFromG()
+		{
+			for (std::size_t i = 0; i < Lanes; ++i)
+			{
+				g1[i] = g[i] / (1.0 + g[i] * (g[i] + k[i]));
+				g2[i] = 2.0 * (g[i] + k[i]) * g1[i];
+				g3[i] = g[i] * g1[i];
+				g4[i] = 2.0 * g1[i];
+			}
+		}
+
+		alignas(32) Frame v0z{ }, v1{ }, v2{ };
+		alignas(32) Frame g{ }, k{ }, g1{ }, g2{ }, g3{ }, g4{ };
+		Frame freq{ }, res{ };
+
+	};
+
 	class maxiKick
 	{
 
@@ -870,6 +1295,16 @@ namespace Maximilian
 		Env envelope;
 		Distortion distort;
 		Filter filter;
+
+		//plays each hit from a buffer rendered once per set of parameters, in the background
+		//when they change (see OneShotCache), instead of synthesising it. Gain and the limiter
+		//still apply as it plays. Call it at setup
+		void setCached(bool cached);
+
+	private:
+
+		OneShotPlayer oneShot;
+
 	};
 
 	class maxiSnare
@@ -903,6 +1338,13 @@ namespace Maximilian
 		Distortion distort;
 		Filter filter;
 
+		//plays each hit from a buffer rendered once per set of parameters, like maxiKick. The
+		//noise is then the same in every hit
+		void setCached(bool cached);
+
+	private:
+
+		OneShotPlayer oneShot;
 
 	};
 
@@ -938,29 +1380,399 @@ namespace Maximilian
 		Distortion distort;
 		StateVariableFilter filter;
 
+		//plays each hit from a buffer rendered once per set of parameters, like maxiKick. The
+		//noise is then the same in every hit
+		void setCached(bool cached);
+
+	private:
+
+		OneShotPlayer oneShot;
 
 	};
 
+	//polyphonic subtractive synth: two oscillators, a resonant lowpass, an amplitude and a
+	//modulation envelope per voice, two LFOs and a modulation matrix.
+	//
+	//	maxiSynth synth(64);
+	//	synth.setModulation(maxiSynth::Source::Envelope, maxiSynth::Target::Cutoff, 3);
+	//	synth.noteOn(60, 100);
+	//	synth.play(left, right, frames);
+	//
+	//voice state is stored one array per parameter with the sounding voices packed at the
+	//front, and every sample runs each stage as one loop across the voices, which the compiler
+	//turns into SIMD lanes. Modulation is worked out every CONTROL_PERIOD samples. Nothing
+	//allocates after setup()
 	class maxiSynth
 	{
 
+	public:
+
+		enum class Waveform : unsigned char
+		{
+			Sine,
+			Triangle,
+			Saw,        /*!< Band limited (polyBLEP). */
+			Pulse,      /*!< Band limited (polyBLEP), width from setPulseWidth(). */
+			Noise
+		};
+
+		enum class Source : unsigned char
+		{
+			LFO1,       /*!< -1 to 1. */
+			LFO2,       /*!< -1 to 1. */
+			Envelope,   /*!< The modulation envelope, 0 to 1. */
+			Velocity,   /*!< 0 to 1. */
+			KeyTrack,   /*!< Octaves from middle C. */
+			ModWheel    /*!< 0 to 1, from setModWheel(). */
+		};
+
+		enum class Target : unsigned char
+		{
+			Pitch,      /*!< In semitones. */
+			Cutoff,     /*!< In octaves. */
+			Resonance,  /*!< Added to Q. */
+			Amplitude,  /*!< Added to a gain of 1. */
+			PulseWidth, /*!< Added to the width. */
+			Pan         /*!< Added to the pan, -1 to 1. */
+		};
+
+		static constexpr std::size_t MAXIMUM_VOICES = 256;
+
+		static constexpr std::size_t CONTROL_PERIOD = 16;
+
+		//a stolen voice fades out over this long before it plays its new note
+		static constexpr double STEAL_FADE_MS = 3.0;
+
+		maxiSynth() : maxiSynth(32)
+		{
+		}
+
+		explicit maxiSynth(std::size_t voices);
+
+		//allocates, call it outside the audio callback. Stops every note
+		void setup(std::size_t voices);
+
+		//velocity from 0 to 127, like MIDI
+		void noteOn(double note, double velocity = 100);
+
+		void noteOff(double note);
+
+		void allNotesOff();
+
+		double play();
+
+		void play(double* output, std::size_t frames);
+
+		void play(double* left, double* right, std::size_t frames);
+
+		//getters
+
+		std::size_t getNumActive() const;
+
+		std::size_t getNumVoices() const;
+
+		//setters
+
+		//oscillator 0 or 1
+		void setWaveform(std::size_t oscillator, Waveform waveform);
+
+		//oscillator 1 against oscillator 0, in semitones
+		void setDetune(double semitones);
+
+		//0 is oscillator 0 alone, 1 oscillator 1 alone
+		void setOscillatorMix(double mix);
+
+		void setPulseWidth(double width);
+
+		void setCutoff(double frequency);
+
+		void setResonance(double q);
+
+		//times in milliseconds, sustain from 0 to 1
+		void setAmpEnvelope(double attack, double decay, double sustain, double release);
+
+		void setModEnvelope(double attack, double decay, double sustain, double release);
+
+		//LFO 0 or 1, Noise gives sample and hold
+		void setLFO(std::size_t lfo, double frequency, Waveform waveform = Waveform::Sine);
+
+		//how far 'source' moves 'target', in the target's units. 0 removes the route
+		void setModulation(Source source, Target target, double amount);
+
+		void setModWheel(double value);
+
+		void setPitchBend(double semitones);
+
+		void setPan(double pan);
+
+		void setGain(double _gain);
+
+		void setStealing(VoiceAllocator::Stealing stealing);
+
+	private:
+
+		static constexpr std::size_t SOURCES = 6;
+		static constexpr std::size_t TARGETS = 6;
+
+		enum class Stage : unsigned char
+		{
+			Attack,
+			Decay,
+			Release
+		};
+
+		struct Envelope
+		{
+			double attack = 0;
+			double decay = 0;
+			double sustain = 1;
+			double release = 0;
+		};
+
+		struct LFO
+		{
+			double frequency = 1;
+			double phase = 0;
+			double value = 0;
+			Waveform waveform = Waveform::Sine;
+		};
+
+		VoiceAllocator allocator;
+
+		//per voice, indexed by slot in the allocator's active list
+		std::vector <double> notes, velocities;
+		std::vector <double> phases0, phases1, increments0, increments1, widths;
+		std::vector <std::uint32_t> seeds;
+		std::vector <double> filter1, filter2, a1, a2, a3;
+		std::vector <double> levels, targets, rates;
+		std::vector <double> modLevels, modTargets, modRates;
+		std::vector <Stage> stages, modStages;
+		std::vector <double> gains, pansLeft, pansRight;
+		std::vector <double> fades, fadeSteps, pendingNotes, pendingVelocities;
+
+		//one sample of every voice, between stages
+		std::vector <double> oscillator0, oscillator1, voiceOutput;
+
+		Waveform waveforms[2] = { Waveform::Saw, Waveform::Saw };
+		double detune = 0.07;
+		double mix = 0.5;
+		double pulseWidth = 0.5;
+		double cutoff = 2000;
+		double resonance = 0.707;
+		double modWheel = 0;
+		double pitchBend = 0;
+		double pan = 0;
+		double gain = 0.25;
+
+		//attack, decay and release as per sample rates, sustain as a level
+		Envelope ampEnvelope;
+		Envelope modEnvelope;
+
+		LFO lfos[2];
+
+		double modulation[SOURCES][TARGETS] = {};
+
+		std::uint32_t noiseSeed = 22222;
+
+		std::size_t countdown = 0;
+
+		//coefficients, pitch and gains of one voice from the modulation
+		void control(std::size_t slot);
+
+		//LFOs, envelope stages, retirement and steals that have faded out
+		void control();
+
+		void start(std::size_t slot, double note, double velocity);
+
+		//moves the data of one slot to another, when a voice retires
+		void move(std::size_t from, std::size_t to);
+
+		void renderOscillator(Waveform waveform, std::vector <double>& phases, const std::vector <double>& increments,
+				std::vector <double>& output, std::size_t count);
+
+		//'frames' samples, less than a control period
+		void render(double* left, double* right, std::size_t frames);
 
 	};
 
+	//granular synthesis on the data of a Clip: short windowed grains of the sample, each with
+	//its own position, pitch and pan, overlapped into a cloud.
+	//
+	//	granularSynth cloud(clip);
+	//	cloud.setDensity(400);
+	//	cloud.setDuration(80);
+	//	cloud.setPositionSpread(0.05);
+	//	cloud.play(left, right, frames);
+	//
+	//grains live in a pool allocated by setup(), one array per parameter with the sounding grains
+	//packed at the front. The scheduler starts each grain on the exact sample its onset falls on,
+	//whatever the block size, and each grain renders a block in one loop from a precomputed
+	//window table, so clouds of thousands of grains a second stay cheap. Nothing allocates after
+	//setup()
 	class granularSynth
 	{
 
+	public:
+
+		enum class Shape : unsigned char
+		{
+			Hann,
+			Gaussian,
+			Tukey,      /*!< Flat in the middle, cosine edges over a quarter of the grain each. */
+			Triangle
+		};
+
+		static constexpr std::size_t MAXIMUM_GRAINS = 4096;
+
+		//points in each window table, one more is kept for interpolation
+		static constexpr std::size_t WINDOW_SIZE = 1024;
+
+		granularSynth() : granularSynth(MAXIMUM_GRAINS)
+		{
+		}
+
+		explicit granularSynth(std::size_t grains);
+
+		explicit granularSynth(const Clip& clip, std::size_t grains = MAXIMUM_GRAINS);
+
+		//allocates, call it outside the audio callback. Stops every grain
+		void setup(std::size_t grains);
+
+		//plays the clip's data, shared rather than copied. Call it outside the audio callback
+		void setSample(const Clip& clip);
+
+		void setSample(std::shared_ptr <const SampleData> data);
+
+		/**
+		 * Starts one grain on the next sample played, on top of the cloud:
+		 * 'position' from 0 to 1 in the sample, 'duration' in milliseconds,
+		 * 'pitch' in semitones and 'pan' from -1 to 1.
+		 */
+		void trigger(double position, double duration, double pitch = 0, double pan = 0, double _gain = 1);
+
+		//stops every grain, and the cloud until the next setDensity()
+		void stop();
+
+		double play();
+
+		void play(double* output, std::size_t frames);
+
+		void play(double* left, double* right, std::size_t frames);
+
+		//getters
+
+		std::size_t getNumGrains() const;
+
+		std::size_t getCapacity() const;
+
+		//grains that could not start because the pool was full
+		std::uint64_t getDroppedGrains() const;
+
+		//setters
+
+		//grains started each second by the cloud, 0 for none
+		void setDensity(double grainsPerSecond);
+
+		//0 starts grains at regular intervals, 1 makes each interval anything from nothing to twice as long
+		void setScatter(double _scatter);
+
+		//where grains start, from 0 to 1 in the sample
+		void setPosition(double _position);
+
+		//how far either side of the position grains start, from 0 to 1
+		void setPositionSpread(double spread);
+
+		//in milliseconds
+		void setDuration(double _duration);
+
+		//from 0 to 1, a fraction of the duration either side
+		void setDurationSpread(double spread);
+
+		//in semitones
+		void setPitch(double semitones);
+
+		void setPitchSpread(double semitones);
+
+		//from -1 to 1
+		void setPan(double _pan);
+
+		void setPanSpread(double spread);
+
+		void setShape(Shape _shape);
+
+		void setGain(double _gain);
+
+		void setReadChannel(std::size_t channel);
+
+	private:
+
+		std::shared_ptr <const SampleData> sample;
+
+		//per grain, the sounding ones first
+		std::vector <double> positions, increments, phases, phaseIncrements;
+		std::vector <double> gains, gainsLeft, gainsRight;
+		std::vector <std::size_t> remaining, delays;
+		std::vector <const double*> windows;
+
+		std::size_t active = 0;
+		std::uint64_t dropped = 0;
+
+		//samples from the start of the block to the next grain of the cloud
+		double untilNext = 0;
+
+		double density = 0;
+		double scatter = 0;
+		double position = 0;
+		double positionSpread = 0;
+		double duration = 50;
+		double durationSpread = 0;
+		double pitch = 0;
+		double pitchSpread = 0;
+		double pan = 0;
+		double panSpread = 0;
+		double gain = 0.5;
+
+		Shape shape = Shape::Hann;
+
+		std::size_t readChannel = 0;
+
+		std::uint32_t seed = 33333;
+
+		//-1 to 1
+		double random();
+
+		//a grain starting 'delay' samples into the next block rendered
+		void start(std::size_t delay, double _position, double _duration, double _pitch, double _pan, double _gain);
+
+		//a grain of the cloud, its parameters drawn around the settings
+		void start(std::size_t delay);
+
+		//adds the sounding grains into 'left' and 'right', or into 'left' alone with no pan when 'right' is null
+		void render(double* left, double* right, std::size_t frames);
+
+		//WINDOW_SIZE + 1 points of a shape, computed once for every granularSynth
+		static const double* window(Shape shape);
 
 	};
 
 	class maxiSampler
 	{
 
+		//starts a note on a free voice
+		void start(int voice, double note, double velocityGain);
+
+		//the next sample of a sounding voice. Retires it once its envelope has ended
+		double next(int voice);
+
 	public:
 		maxiSampler();
 
+		//only the voices that are sounding are processed
 		double play();
 
+		//a block of the sounding voices, written to 'output'
+		void play(double* output, std::size_t frames);
+
 		void setPitch(double pitch, bool setall = false);
 
 		void midiNoteOn(double pitch, double velocity, bool setall = false);
@@ -979,8 +1791,14 @@ namespace Maximilian
 
 		void load(string inFile, bool setall = true);
 
+		//new sample data for every voice, from any thread. Each voice changes over at its next trigger
+		void swapSample(std::shared_ptr <const SampleData> data);
+
 		void setNumVoices(int numVoices);
 
+		//what a note does when every voice is busy, Oldest by default
+		void setStealing(VoiceAllocator::Stealing stealing);
+
 		double position;
 
 		void trigger();
@@ -1013,14 +1831,34 @@ namespace Maximilian
 		StateVariableFilter filters[32];
 		bool sustain = true;
 
+		//a stolen voice fades out over this long before it plays its new note
+		static constexpr double STEAL_FADE_MS = 5.0;
+
+		//a releasing envelope below this has ended and its voice is freed
+		static constexpr double SILENCE = 0.0001;
+
+		VoiceAllocator allocator;
+
+		//the note the next trigger() plays, set by midiNoteOn() and setPitch()
+		double nextPitch = 0;
+		double nextGain = 1;
+
+		//the note a stolen voice plays once it has faded out
+		double pendingPitch[32];
+		double pendingGain[32];
+		double fades[32];
+
 
 	};
 
+	//ticks a number of times a beat, checked once a sample through 'tick'. For sequencing whole
+	//blocks, with tempo changes and events on exact samples, use Transport
 	class maxiClock
 	{
 	public:
 		maxiClock();
 
+		//counts one sample, and sets 'tick' on the sample a tick falls on
 		void ticker();
 
 		void setTempo(double bpm);
@@ -1036,6 +1874,11 @@ namespace Maximilian
 		int ticks;
 		bool tick;
 
+	private:
+
+		//samples to the next tick, with the fraction carried over so the ticks don't drift
+		double untilTick;
+
 	};
 
 	class maxiRecorder
@@ -0,0 +1,221 @@
+#ifndef MAXIMILIAN_LOUDNESSMETER_HPP
+#define MAXIMILIAN_LOUDNESSMETER_HPP
+
+#include "Definition/Settings.hpp"
+#include "Filters/Biquad.hpp"
+#include "Filters/Oversampler.hpp"
+#include "Samples/SampleData.hpp"
+
+#include <array>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Loudness as ITU-R BS.1770-4 and EBU R128 define it: momentary (400 ms),
+	 * short-term (3 s) and integrated loudness in LUFS, the loudness range
+	 * in LU (EBU Tech 3342) and the true peak in dBTP.
+	 *
+	 * Each channel is K-weighted by two second order sections and its mean
+	 * square taken over 100 ms steps, from which the 400 ms and 3 s windows
+	 * are summed. Integrated loudness is gated at -70 LUFS and then 10 LU
+	 * below the loudness of what is left, and the loudness range takes the
+	 * 10th to 95th percentile of the short-term values above -70 LUFS and
+	 * 20 LU below their mean. Instead of keeping every block for the gates,
+	 * the blocks go into histograms of 0.01 LU bins that hold their count
+	 * and their summed energy, so the memory is the same for a jingle and
+	 * for a feature film and the integrated loudness stays exact to within
+	 * the one bin the relative gate falls in.
+	 *
+	 * 	LoudnessMeter meter;
+	 * 	meter.setup(2);
+	 * 	meter.process(channels, frames);       // on the audio thread
+	 * 	double lufs = meter.getIntegrated();
+	 *
+	 * measure() does the same for a whole file or sample on every core.
+	 * Nothing allocates after setup().
+	 */
+	class LoudnessMeter
+	{
+
+	public:
+
+		// What the loudness getters return before there is anything above the absolute gate.
+		static constexpr double SILENCE = -std::numeric_limits <double>::infinity();
+
+		static constexpr std::size_t TRUE_PEAK_FACTOR = 4;
+
+		// A whole programme, as measure() reports it.
+		struct Measurement
+		{
+			double integrated = SILENCE;        /*!< LUFS */
+			double range = 0.0;                 /*!< LU */
+			double momentaryMaximum = SILENCE;  /*!< LUFS */
+			double shortTermMaximum = SILENCE;  /*!< LUFS */
+			double truePeak = SILENCE;          /*!< dBTP */
+		};
+
+	private:
+
+		// The 400 ms and 3 s windows in 100 ms steps.
+		static constexpr std::size_t MOMENTARY_STEPS = 4;
+		static constexpr std::size_t SHORT_TERM_STEPS = 30;
+
+		// Histogram bins from the absolute gate up.
+		static constexpr double GATE = -70.0;
+		static constexpr double BIN_WIDTH = 0.01;
+		static constexpr std::size_t BINS = 8000;
+
+		struct Histogram
+		{
+			std::vector <std::uint64_t> counts;
+			std::vector <double> energies;
+			std::uint64_t total = 0;
+			double energy = 0.0;
+
+			void setup();
+
+			void clear();
+
+			// A block of mean square 'energy', if it is above the absolute gate.
+			void add(double energy);
+
+			void merge(const Histogram& other);
+
+			// The first bin above the relative gate 'offset' LU below the mean of every block.
+			[[nodiscard]] std::size_t firstAbove(double offset) const;
+
+			// The mean energy of the blocks above the relative gate, 0 if none.
+			[[nodiscard]] double gated(double offset) const;
+
+			// Between the 'low' and 'high' fractiles of the blocks above the relative gate, in LU.
+			[[nodiscard]] double range(double offset, double low, double high) const;
+		};
+
+		struct Channel
+		{
+			Biquad shelf;
+			Biquad highPass;
+			Oversampler oversampler;
+			double weight = 1.0;
+		};
+
+		std::vector <Channel> channels;
+
+		std::vector <double> filtered;
+		std::vector <double> oversampled;
+
+		std::size_t maximumBlock = 0;
+		double sampleRate = Settings::SAMPLE_RATE;
+
+		// Samples in a 100 ms step, and how far into the current one.
+		std::size_t step = 0;
+		std::size_t position = 0;
+		double accumulated = 0.0;
+
+		// Mean squares of the last SHORT_TERM_STEPS steps.
+		std::array <double, SHORT_TERM_STEPS> steps{ };
+		std::size_t stepIndex = 0;
+		std::uint64_t stepsDone = 0;
+
+		double momentary = 0.0;
+		double shortTerm = 0.0;
+		double momentaryMaximum = 0.0;
+		double shortTermMaximum = 0.0;
+		double peak = 0.0;
+
+		Histogram blocks;
+		Histogram shortTerms;
+
+		bool truePeak = true;
+
+		void completeStep();
+
+		// Forgets the gating blocks and the maxima but not the filters or the steps, for measure()'s pre-roll.
+		void clearGating();
+
+		// Runs the true peak filters on silence, so the last samples of a programme reach the peak.
+		void flushPeak();
+
+		void merge(const LoudnessMeter& other);
+
+		// Splits a programme between threads. 'read' is callable as void(channel, start, count, double*).
+		template <typename Reader>
+		static Measurement measure(std::size_t numChannels, double rate, std::uint64_t frames, std::size_t threads,
+				const Reader& read);
+
+		static double toLoudness(double energy);
+
+	public:
+
+		LoudnessMeter() = default;
+
+		/**
+		 * Allocates for 'numChannels' channels at 'rate' and blocks up to
+		 * 'block' samples (longer ones are processed in pieces), and sets the
+		 * channel weights: 1, except that with 5 channels (L R C Ls Rs) the
+		 * surrounds get 1.41, and with 6 (L R C LFE Ls Rs) the LFE is left
+		 * out as well. Call it outside the audio callback.
+		 */
+		void setup(std::size_t numChannels, double rate = Settings::SAMPLE_RATE,
+				std::size_t block = Settings::BUFFER_SIZE);
+
+		// 'frames' samples of every channel, inputs[channel][frame].
+		void process(const double* const* inputs, std::size_t frames);
+
+		// Starts a new measurement.
+		void reset();
+
+		/**
+		 * Measures every channel of 'data' using up to 'threads' threads, 0
+		 * for one per core.
+		 *
+		 * 	auto result = LoudnessMeter::measure(*clip.getSampleData());
+		 */
+		static Measurement measure(const SampleData& data, std::size_t threads = 0);
+
+		// As above for a WAV file, read through its mapping. False if it can't be opened.
+		static bool measure(const std::string& fileName, Measurement& result, std::size_t threads = 0);
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		// Over the last 400 ms, in LUFS, updated every 100 ms.
+		[[nodiscard]] double getMomentary() const;
+
+		// Over the last 3 s, in LUFS, updated every 100 ms.
+		[[nodiscard]] double getShortTerm() const;
+
+		[[nodiscard]] double getMomentaryMaximum() const;
+
+		[[nodiscard]] double getShortTermMaximum() const;
+
+		// Gated, since setup() or reset(), in LUFS. Walks the histogram, so read it a few times a second rather than every block.
+		[[nodiscard]] double getIntegrated() const;
+
+		// In LU. Walks the histogram like getIntegrated().
+		[[nodiscard]] double getLoudnessRange() const;
+
+		// The highest true peak (or sample peak, with true peak off) since setup() or reset(), in dBTP.
+		[[nodiscard]] double getTruePeak() const;
+
+		// Everything above as a Measurement.
+		[[nodiscard]] Measurement getMeasurement() const;
+
+		// Setters
+
+		// How much 'channel' counts towards the loudness, 0 to leave it out.
+		void setWeight(std::size_t channel, double weight);
+
+		void setTruePeak(bool enabled);
+
+	};
+}
+
+#endif //MAXIMILIAN_LOUDNESSMETER_HPP
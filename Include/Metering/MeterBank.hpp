@@ -0,0 +1,174 @@
+#ifndef MAXIMILIAN_METERBANK_HPP
+#define MAXIMILIAN_METERBANK_HPP
+
+#include "Definition/Settings.hpp"
+#include "Filters/Oversampler.hpp"
+#include "Metering/TripleBuffer.hpp"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Meters for any number of channels: peak, true peak, RMS, an envelope
+	 * follower and the correlation of stereo pairs, measured a block at a
+	 * time on the audio thread and published for other threads to read.
+	 *
+	 * Channels 0 and 1, 2 and 3 and so on are taken as stereo pairs for the
+	 * correlation; both channels of a pair report it, and a last channel
+	 * without a partner reports 0.
+	 *
+	 * 	// Audio thread.
+	 * 	meters.process(channels, frames);
+	 *
+	 * 	// UI thread, never blocks and never blocks the audio thread.
+	 * 	const MeterBank::Snapshot& snapshot = meters.read();
+	 * 	draw(snapshot.readings[0].truePeak);
+	 *
+	 * Peak, RMS and correlation are sums and maxima over the block, plain
+	 * loops over each channel that the compiler vectorises, and the RMS and
+	 * correlation windows decay once per block rather than once per sample.
+	 * The envelope follower has to run sample by sample, so it runs on
+	 * groups of LANES channels side by side instead. True peak is the peak
+	 * of the signal at four times the rate (as ITU-R BS.1770 describes);
+	 * it costs the most, setTruePeak(false) turns it off.
+	 * Nothing allocates after setup().
+	 */
+	class MeterBank
+	{
+
+	public:
+
+		// Channels whose envelope followers run together.
+		static constexpr std::size_t LANES = 8;
+
+		static constexpr std::size_t TRUE_PEAK_FACTOR = 4;
+
+		// Amplitudes, not decibels; Decibels converts them.
+		struct Reading
+		{
+			// Largest sample, falling back at the peak decay.
+			double peak = 0.0;
+
+			// Largest value between samples too, falling back at the peak decay.
+			double truePeak = 0.0;
+
+			double rms = 0.0;
+
+			// maxiEnvelopeFollower's envelope at the end of the block.
+			double envelope = 0.0;
+
+			// From -1, out of phase, to 1, mono.
+			double correlation = 0.0;
+
+			// Largest true peak (or peak, with true peak off) since reset().
+			double maximum = 0.0;
+		};
+
+		struct Snapshot
+		{
+			std::vector <Reading> readings;
+
+			// Frames metered since setup() up to the end of these readings.
+			std::uint64_t frame = 0;
+		};
+
+	private:
+
+		struct Channel
+		{
+			Oversampler oversampler;
+
+			double peak = 0.0;
+			double truePeak = 0.0;
+			double maximum = 0.0;
+
+			// Exponentially weighted sums over the window.
+			double energy = 0.0;
+			double product = 0.0;
+		};
+
+		using Lanes = std::array <double, LANES>;
+
+		std::vector <Channel> channels;
+
+		// Envelope of each group of LANES channels.
+		std::vector <Lanes> envelopes;
+
+		// The last block of one group, frame-major, or one channel at the oversampled rate.
+		std::vector <double> scratch;
+
+		// Weight of the sums in 'energy', the same for every channel.
+		double weight = 0.0;
+
+		std::uint64_t frame = 0;
+
+		std::size_t maximumBlock = 0;
+
+		double peakDecay = 0.0;
+		double windowDecay = 0.0;
+		double attack = 0.0;
+		double release = 0.0;
+
+		double peakRate = 20.0;
+		double windowTime = 300.0;
+
+		bool truePeak = true;
+
+		TripleBuffer <Snapshot> published;
+
+		// Frames [offset, offset + frames) of every input.
+		void processBlock(const double* const* inputs, std::size_t offset, std::size_t frames);
+
+		void publish();
+
+	public:
+
+		MeterBank();
+
+		/**
+		 * Allocates for 'numChannels' channels and blocks up to 'block'
+		 * samples (longer ones are processed in pieces). Call it outside the
+		 * audio callback.
+		 */
+		void setup(std::size_t numChannels, std::size_t block = Settings::BUFFER_SIZE);
+
+		// Audio thread: meters 'frames' samples of every channel, inputs[channel][frame], and publishes the readings.
+		void process(const double* const* inputs, std::size_t frames);
+
+		// Audio thread: clears every meter.
+		void reset();
+
+		/**
+		 * Reading thread: the latest published readings. Only one thread may
+		 * read; what it returns stays valid until its next call.
+		 */
+		const Snapshot& read();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		// Setters
+
+		// How fast peak and true peak fall back, in dB per second.
+		void setPeakDecay(double decibelsPerSecond);
+
+		// Time constant of the RMS and correlation, in milliseconds.
+		void setWindow(double milliseconds);
+
+		// The envelope follower's times, in milliseconds, as for maxiEnvelopeFollower.
+		void setAttack(double milliseconds);
+
+		void setRelease(double milliseconds);
+
+		void setTruePeak(bool enabled);
+
+	};
+}
+
+#endif //MAXIMILIAN_METERBANK_HPP
@@ -0,0 +1,92 @@
+#ifndef MAXIMILIAN_TRIPLEBUFFER_HPP
+#define MAXIMILIAN_TRIPLEBUFFER_HPP
+
+#include <array>
+#include <atomic>
+
+namespace Maximilian
+{
+
+	/**
+	 * Hands the latest value of a T from one writing thread to one reading
+	 * thread without either of them ever waiting.
+	 *
+	 * There are three copies: the writer fills its own, publish() swaps it
+	 * with the middle one, and the reader's update() swaps its own with the
+	 * middle one when something new was published there. The swaps are a
+	 * single atomic exchange each, so the audio thread can publish meter
+	 * readings every block while a UI thread reads them whenever it likes;
+	 * readings published between two updates are simply skipped.
+	 *
+	 * 	// Audio thread.
+	 * 	buffer.write() = readings;
+	 * 	buffer.publish();
+	 *
+	 * 	// UI thread.
+	 * 	buffer.update();
+	 * 	draw(buffer.read());
+	 */
+	template <typename T>
+	class TripleBuffer
+	{
+
+	private:
+
+		static constexpr unsigned char INDEX = 0x3;
+		static constexpr unsigned char FRESH = 0x4;
+
+		std::array <T, 3> slots{ };
+
+		// Index of the middle copy, with FRESH set while the reader hasn't taken it.
+		std::atomic <unsigned char> middle{ 1 };
+
+		// Each owned by one side.
+		alignas(64) unsigned char back = 0;
+		alignas(64) unsigned char front = 2;
+
+	public:
+
+		TripleBuffer() = default;
+
+		// Copies 'value' into every slot, to size them before use. Not thread safe.
+		void fill(const T& value)
+		{
+			for (T& slot : slots)
+			{
+				slot = value;
+			}
+		}
+
+		// Writer: the copy to fill in. It holds what was there before, not necessarily the last value written.
+		T& write()
+		{
+			return slots[back];
+		}
+
+		// Writer: makes the copy from write() the latest.
+		void publish()
+		{
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+		}
+
+		// Reader: takes the latest value if there is a newer one than read() holds. Returns whether there was.
+		bool update()
+		{
+			if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+			{
+				return false;
+			}
+			front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+			return true;
+		}
+
+		// Reader: the value taken by the last update().
+		const T& read() const
+		{
+			return slots[front];
+		}
+
+	};
+}
+
+#endif //MAXIMILIAN_TRIPLEBUFFER_HPP
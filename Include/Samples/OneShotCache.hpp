@@ -0,0 +1,123 @@
+#ifndef MAXIMILIAN_ONESHOTCACHE_HPP
+#define MAXIMILIAN_ONESHOTCACHE_HPP
+
+#include "Samples/SampleData.hpp"
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Sounds that are the same every time they are triggered, drum hits for
+	 * instance, rendered once into buffers and kept.
+	 *
+	 * A sound is identified by the function that renders it and the
+	 * parameters it is rendered with. Instruments ask for one through a
+	 * OneShotPlayer from the audio thread, which never waits: the request
+	 * goes to a background thread, shared by every instrument, which finds
+	 * the sound among those already rendered or renders it, and hands it
+	 * back. Until then the instrument synthesises its hits as usual.
+	 *
+	 * Up to MAXIMUM_ENTRIES sounds are kept, the least recently asked for
+	 * that no instrument holds go first.
+	 */
+	class OneShotCache
+	{
+
+	public:
+
+		static constexpr std::size_t PARAMETERS = 12;
+
+		using Parameters = std::array <double, PARAMETERS>;
+
+		// Renders the sound for a set of parameters. Runs on the background thread.
+		using Renderer = std::shared_ptr <const SampleData> (*)(const Parameters& parameters);
+
+		static constexpr std::size_t MAXIMUM_ENTRIES = 256;
+
+		// Requests waiting for the background thread. More are refused, and asked again later.
+		static constexpr std::size_t MAXIMUM_REQUESTS = 256;
+
+		// Where the background thread leaves a sound for one instrument.
+		struct Slot
+		{
+			std::mutex mutex;
+
+			std::shared_ptr <const SampleData> ready;
+
+			Parameters parameters{};
+
+			std::atomic <bool> fresh{ false };
+		};
+
+	private:
+
+		struct Request
+		{
+			std::shared_ptr <Slot> slot;
+
+			Renderer renderer = nullptr;
+
+			Parameters parameters{};
+		};
+
+		struct Entry
+		{
+			Renderer renderer = nullptr;
+
+			Parameters parameters{};
+
+			std::shared_ptr <const SampleData> data;
+
+			std::uint64_t used = 0;
+		};
+
+		std::mutex requestMutex;
+
+		std::vector <Request> requests;
+
+		// The background thread's side of 'requests', swapped with it.
+		std::vector <Request> serving;
+
+		std::mutex cacheMutex;
+
+		std::vector <Entry> entries;
+
+		std::uint64_t clock = 0;
+
+		OneShotCache();
+
+		void run();
+
+		// Finds or renders a sound. Holds 'cacheMutex' while it renders.
+		std::shared_ptr <const SampleData> find(Renderer renderer, const Parameters& parameters);
+
+	public:
+
+		// Lives for the whole program, like its thread. Starts the thread the first time.
+		static OneShotCache& get();
+
+		// Asks for a sound to be left in 'slot'. Never blocks; false if the request could not be queued.
+		bool request(const std::shared_ptr <Slot>& slot, Renderer renderer, const Parameters& parameters);
+
+		// The sound, rendered on the calling thread if it isn't kept yet. For setup, to have sounds ready.
+		std::shared_ptr <const SampleData> render(Renderer renderer, const Parameters& parameters);
+
+		// Drops every sound no instrument holds.
+		void clear();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumEntries();
+
+	};
+}
+
+#endif //MAXIMILIAN_ONESHOTCACHE_HPP
@@ -0,0 +1,111 @@
+#ifndef MAXIMILIAN_ONESHOTPLAYER_HPP
+#define MAXIMILIAN_ONESHOTPLAYER_HPP
+
+#include "Samples/OneShotCache.hpp"
+
+namespace Maximilian
+{
+
+	/**
+	 * The audio thread's side of the OneShotCache, for one instrument.
+	 *
+	 * 	if (!player.trigger(&render, parameters))
+	 * 	{
+	 * 		// not rendered yet, synthesise this hit
+	 * 	}
+	 * 	...
+	 * 	if (player.isActive())
+	 * 	{
+	 * 		output = player.play();
+	 * 	}
+	 *
+	 * trigger() never blocks or allocates. The first time it sees a set of
+	 * parameters it asks the cache for the sound and returns false; once the
+	 * sound has arrived, triggers with those parameters play it. The last
+	 * SOUNDS sounds are held.
+	 */
+	class OneShotPlayer
+	{
+
+	public:
+
+		// Sounds held at once, so hits that alternate between a few settings all play from the cache.
+		static constexpr std::size_t SOUNDS = 4;
+
+	private:
+
+		bool enabled = false;
+
+		std::shared_ptr <OneShotCache::Slot> slot;
+
+		// The sounds held, the parameters they were rendered with, and when each was last played.
+		std::array <std::shared_ptr <const SampleData>, SOUNDS> sounds;
+		std::array <OneShotCache::Parameters, SOUNDS> soundParameters{};
+		std::array <std::uint64_t, SOUNDS> used{};
+		std::uint64_t clock = 0;
+
+		// The parameters last asked for, while waiting for them.
+		OneShotCache::Parameters requestedParameters{};
+		bool requested = false;
+
+		const float* samples = nullptr;
+		std::size_t frames = 0;
+		std::size_t position = 0;
+		bool playing = false;
+
+		// The last trigger played from the cache.
+		bool active = false;
+
+		// Takes a sound the cache has left in the slot. Never blocks.
+		void update();
+
+	public:
+
+		OneShotPlayer() = default;
+
+		// A copy shares the sounds but gets its own slot.
+		OneShotPlayer(const OneShotPlayer& other);
+
+		OneShotPlayer& operator=(const OneShotPlayer& other);
+
+		/**
+		 * Starts the sound for 'parameters' and returns true if it has been
+		 * rendered. Otherwise stops, asks for it, and returns false.
+		 */
+		bool trigger(OneShotCache::Renderer renderer, const OneShotCache::Parameters& parameters);
+
+		void stop();
+
+		// The next sample of the sound, silence once it has ended.
+		inline double play()
+		{
+			if (!playing)
+			{
+				return 0.0;
+			}
+			const double output = samples[position];
+			if (++position >= frames)
+			{
+				playing = false;
+			}
+			return output;
+		}
+
+		// Getters
+
+		[[nodiscard]] bool isEnabled() const;
+
+		[[nodiscard]] bool isPlaying() const;
+
+		// From a trigger() that returned true to the next trigger(): the hit is the player's, even once it has ended.
+		[[nodiscard]] bool isActive() const;
+
+		// Setters
+
+		// Allocates the slot and starts the cache's thread: call it at setup.
+		void setEnabled(bool _enabled);
+
+	};
+}
+
+#endif //MAXIMILIAN_ONESHOTPLAYER_HPP
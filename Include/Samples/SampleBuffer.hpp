@@ -0,0 +1,175 @@
+#ifndef MAXIMILIAN_SAMPLEBUFFER_HPP
+#define MAXIMILIAN_SAMPLEBUFFER_HPP
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Sample data in memory: one plane per channel, every plane starting on
+	 * an ALIGNMENT byte boundary, stored as float or, to halve the memory of
+	 * large sample sets, as 16 bit integers.
+	 *
+	 * Files are converted into this form once, when they are loaded, so
+	 * playback reads samples that are ready to use. Float planes can be used
+	 * directly through getFloat(); get() and read() work in either format,
+	 * scaling 16 bit samples to [-1, 1].
+	 */
+	class SampleBuffer
+	{
+
+	public:
+
+		enum class Format : unsigned char
+		{
+			Float,      /*!< 32 bit float, no conversion on playback. */
+			Int16       /*!< Half the memory, scaled on every read. */
+		};
+
+		static constexpr std::size_t ALIGNMENT = 64;
+
+		static constexpr float INT16_SCALE = 1.0f / 32767.0f;
+
+	private:
+
+		Format format = Format::Float;
+
+		std::size_t channels = 0;
+
+		std::size_t frames = 0;
+
+		// Samples from the start of one plane to the next, a whole number of ALIGNMENT when owned.
+		std::size_t stride = 0;
+
+		void* data = nullptr;
+
+		// Set when the samples live in memory owned elsewhere, a mapped file for instance.
+		std::shared_ptr <void> owner;
+
+		[[nodiscard]] std::size_t getSampleSize() const;
+
+	public:
+
+		SampleBuffer() = default;
+
+		SampleBuffer(std::size_t _channels, std::size_t _frames, Format _format = Format::Float);
+
+		SampleBuffer(const SampleBuffer& other);
+
+		SampleBuffer(SampleBuffer&& other) noexcept;
+
+		SampleBuffer& operator=(SampleBuffer other) noexcept;
+
+		~SampleBuffer();
+
+		void swap(SampleBuffer& other) noexcept;
+
+		// Zeroed storage. Allocates, like everything that changes the size or format.
+		void allocate(std::size_t _channels, std::size_t _frames, Format _format = Format::Float);
+
+		// Changes the number of frames, keeping the samples that still fit and zeroing new ones.
+		void resize(std::size_t _frames);
+
+		/**
+		 * Replaces the content with interleaved PCM from a file: 8, 16, 24 or 32
+		 * bit integers (8 bit unsigned, the others signed little endian) or 32
+		 * and 64 bit floats. Returns false, leaving the buffer alone, for any
+		 * other sample type.
+		 */
+		bool assignInterleaved(const void* source, std::size_t _frames, std::size_t _channels,
+				unsigned short bitsPerSample, bool floatingPoint, Format _format = Format::Float);
+
+		/**
+		 * Uses one channel of samples in place instead of copying them, kept
+		 * alive by 'owner'. The plane is then only aligned to the sample size.
+		 * Copies of the buffer are ordinary owned copies.
+		 */
+		void adopt(std::shared_ptr <void> _owner, void* samples, std::size_t _frames, Format _format);
+
+		void release();
+
+		void clear();
+
+		[[nodiscard]] inline float get(const std::size_t channel, const std::size_t frame) const
+		{
+			const std::size_t index = channel * stride + frame;
+			return format == Format::Float
+				   ? static_cast<const float*>(data)[index]
+				   : static_cast<const std::int16_t*>(data)[index] * INT16_SCALE;
+		}
+
+		inline void set(const std::size_t channel, const std::size_t frame, const float value)
+		{
+			const std::size_t index = channel * stride + frame;
+			if (format == Format::Float)
+			{
+				static_cast<float*>(data)[index] = value;
+			}
+			else
+			{
+				static_cast<std::int16_t*>(data)[index] = toInt16(value);
+			}
+		}
+
+		// 'count' samples of a channel from 'start', as doubles. Reads past the end are zero.
+		void read(std::size_t channel, std::size_t start, std::size_t count, double* output) const;
+
+		void read(std::size_t channel, std::size_t start, std::size_t count, float* output) const;
+
+		void write(std::size_t channel, std::size_t start, std::size_t count, const double* input);
+
+		/**
+		 * Calls function(samples, scale) with the channel's plane in its stored
+		 * type (const float* or const std::int16_t*) and the factor that brings
+		 * it to [-1, 1], so templated readers run on either format.
+		 */
+		template <typename Function>
+		decltype(auto) visit(const std::size_t channel, Function&& function) const
+		{
+			if (format == Format::Int16)
+			{
+				return function(getInt16(channel), double(INT16_SCALE));
+			}
+			return function(getFloat(channel), 1.0);
+		}
+
+		static std::int16_t toInt16(float value);
+
+		// One sample of a file's PCM or float data, scaled so positive full scale is 1.
+		static double decodeSample(const unsigned char* sample, unsigned short bitsPerSample, bool floatingPoint);
+
+		// Getters
+
+		[[nodiscard]] Format getFormat() const;
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		[[nodiscard]] std::size_t getNumFrames() const;
+
+		[[nodiscard]] std::size_t getBytes() const;
+
+		[[nodiscard]] bool isEmpty() const;
+
+		[[nodiscard]] bool isAdopted() const;
+
+		// The plane of a channel, nullptr when stored in the other format.
+		[[nodiscard]] const float* getFloat(std::size_t channel) const;
+
+		[[nodiscard]] float* getFloat(std::size_t channel);
+
+		[[nodiscard]] const std::int16_t* getInt16(std::size_t channel) const;
+
+		[[nodiscard]] std::int16_t* getInt16(std::size_t channel);
+
+		// Setters
+
+		// Converts the samples held to the new format.
+		void setFormat(Format _format);
+
+	};
+}
+
+#endif //MAXIMILIAN_SAMPLEBUFFER_HPP
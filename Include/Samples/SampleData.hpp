@@ -0,0 +1,27 @@
+#ifndef MAXIMILIAN_SAMPLEDATA_HPP
+#define MAXIMILIAN_SAMPLEDATA_HPP
+
+#include "Samples/SampleBuffer.hpp"
+#include "Definition/Settings.hpp"
+
+namespace Maximilian
+{
+
+	/**
+	 * A loaded sample, the part of a Clip that doesn't change while it plays.
+	 *
+	 * Clips hold it through a std::shared_ptr <const SampleData>, so any number
+	 * of them (the voices of a sampler, copies made with operator=) play one
+	 * copy of the samples. A Clip that writes to its samples, by recording or
+	 * normalising for instance, first takes a copy of its own.
+	 */
+	struct SampleData
+	{
+		SampleBuffer buffer;
+
+		// Rate the samples were recorded at, the playback functions correct for it.
+		int sampleRate = Settings::SAMPLE_RATE;
+	};
+}
+
+#endif //MAXIMILIAN_SAMPLEDATA_HPP
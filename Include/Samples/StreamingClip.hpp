@@ -0,0 +1,220 @@
+#ifndef MAXIMILIAN_STREAMINGCLIP_HPP
+#define MAXIMILIAN_STREAMINGCLIP_HPP
+
+#include "Samples/SampleBuffer.hpp"
+
+#include <atomic>
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	class StreamPrefetcher;
+
+	/**
+	 * Plays a WAV file from disk without loading it, for samples too long or
+	 * too many to keep in memory.
+	 *
+	 * Only the first 'headSeconds' of the file are held in memory, so a
+	 * trigger starts sounding at once. The rest is read by one prefetch
+	 * thread, shared by every StreamingClip, with pread into a lock-free ring
+	 * of 'ringSeconds'. The thread keeps the ring READ_AHEAD_SECONDS of
+	 * playback ahead of the play position, scaled by the playback speed, and
+	 * a trigger sends it back to the end of the head, which it has
+	 * 'headSeconds' to reach.
+	 *
+	 * 	StreamingClip cello;
+	 * 	cello.open("cello_C2.wav");
+	 * 	cello.trigger();
+	 * 	double y = cello.play(1.0);
+	 *
+	 * The audio thread never blocks or allocates: when the data it needs has
+	 * not arrived it plays silence, keeps time, and counts an underrun in
+	 * getStatistics(). Playback only runs forwards.
+	 */
+	class StreamingClip
+	{
+
+		friend class StreamPrefetcher;
+
+	public:
+
+		struct Statistics
+		{
+			// Times playback caught up with the prefetch thread.
+			std::uint64_t underruns = 0;
+
+			// Samples played as silence because of them.
+			std::uint64_t missedFrames = 0;
+
+			std::uint64_t reads = 0;
+
+			std::uint64_t bytesRead = 0;
+		};
+
+		static constexpr double HEAD_SECONDS = 0.5;
+
+		static constexpr double RING_SECONDS = 2.0;
+
+		// How far ahead of playback the ring is kept at speed 1.
+		static constexpr double READ_AHEAD_SECONDS = 0.5;
+
+		// Largest single read, in frames.
+		static constexpr std::size_t MAXIMUM_READ = 32768;
+
+		struct File;
+
+	private:
+
+		std::unique_ptr <File> file;
+
+		unsigned short channels = 0;
+		unsigned short bitsPerSample = 0;
+		unsigned short blockAlign = 0;
+		bool floatingPoint = false;
+
+		double sampleRate = 0.0;
+
+		std::uint64_t dataOffset = 0;
+		std::uint64_t frames = 0;
+
+		// The start of the file, always in memory.
+		SampleBuffer head;
+		std::uint64_t headFrames = 0;
+
+		// Frame f of the file lives at slot f & mask.
+		SampleBuffer ring;
+		std::uint64_t capacity = 0;
+		std::uint64_t mask = 0;
+
+		// Audio thread to prefetch thread: where to read from. A new generation restarts the ring.
+		std::atomic <std::uint64_t> requestedGeneration{ 0 };
+		std::atomic <std::uint64_t> requestedFrame{ 0 };
+		std::atomic <std::uint64_t> consumedFrame{ 0 };
+		std::atomic <double> speedHint{ 1.0 };
+
+		// Prefetch thread to audio thread: the generation the ring holds and its end.
+		std::atomic <std::uint64_t> ringGeneration{ 0 };
+		std::atomic <std::uint64_t> ringEnd{ 0 };
+
+		std::atomic <std::uint64_t> underruns{ 0 };
+		std::atomic <std::uint64_t> missedFrames{ 0 };
+		std::atomic <std::uint64_t> reads{ 0 };
+		std::atomic <std::uint64_t> bytesRead{ 0 };
+
+		// Prefetch thread only.
+		std::vector <unsigned char> scratch;
+		std::uint64_t servedGeneration = 0;
+		std::uint64_t fillFrame = 0;
+
+		// Audio thread only.
+		std::uint64_t generation = 0;
+		double position = 0.0;
+		double lastSpeed = 1.0;
+		std::size_t readChannel = 0;
+		bool playing = false;
+		bool looping = false;
+		bool starved = false;
+
+		// Points the prefetch thread at 'frame'.
+		void request(std::uint64_t frame);
+
+		// Fills the ring up to the read-ahead. Runs on the prefetch thread.
+		void service();
+
+		// One sample of the read channel, false if it has not been read from disk yet.
+		inline bool fetch(const std::uint64_t frame, float& value) const
+		{
+			if (frame < headFrames)
+			{
+				value = head.get(readChannel, std::size_t(frame));
+				return true;
+			}
+			if (frame >= frames)
+			{
+				value = 0.0f;
+				return true;
+			}
+			if (ringGeneration.load(std::memory_order_acquire) != generation ||
+				frame < requestedFrame.load(std::memory_order_relaxed) ||
+				frame >= ringEnd.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			value = ring.get(readChannel, std::size_t(frame & mask));
+			return true;
+		}
+
+	public:
+
+		StreamingClip();
+
+		StreamingClip(const StreamingClip&) = delete;
+
+		StreamingClip& operator=(const StreamingClip&) = delete;
+
+		~StreamingClip();
+
+		/**
+		 * Reads the header and the head of the file and registers with the
+		 * prefetch thread. Allocates and does file I/O: call it at setup.
+		 * Returns false if the file can't be opened or isn't a WAV we read.
+		 */
+		bool open(const std::string& fileName, double headSeconds = HEAD_SECONDS, double ringSeconds = RING_SECONDS);
+
+		void close();
+
+		// Starts from the beginning. The head plays while the ring refills.
+		void trigger();
+
+		void stop();
+
+		// The next sample of the read channel at 'speed' times the original rate, interpolated linearly.
+		double play(double speed = 1.0);
+
+		void play(double* buffer, std::size_t length, double speed = 1.0);
+
+		// Getters
+
+		[[nodiscard]] bool isOpen() const;
+
+		[[nodiscard]] bool isPlaying() const;
+
+		[[nodiscard]] std::size_t getNumChannels() const;
+
+		[[nodiscard]] std::uint64_t getNumFrames() const;
+
+		[[nodiscard]] double getSampleRate() const;
+
+		// Play position from 0 to 1.
+		[[nodiscard]] double getPosition() const;
+
+		// Frames ahead of the play position that are ready in the ring.
+		[[nodiscard]] std::uint64_t getBufferedFrames() const;
+
+		// Bytes held in memory by the head and the ring.
+		[[nodiscard]] std::size_t getResidentBytes() const;
+
+		// Safe to call from any thread.
+		[[nodiscard]] Statistics getStatistics() const;
+
+		// Setters
+
+		// Jumps to 'newPosition' (0 to 1). Past the head this underruns until the ring catches up.
+		void setPosition(double newPosition);
+
+		void setReadChannel(std::size_t channel);
+
+		// Restarts from the head at the end of the file.
+		void setLooping(bool _looping);
+
+		void resetStatistics();
+
+	};
+}
+
+#endif //MAXIMILIAN_STREAMINGCLIP_HPP
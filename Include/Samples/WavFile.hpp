@@ -0,0 +1,142 @@
+#ifndef MAXIMILIAN_WAVFILE_HPP
+#define MAXIMILIAN_WAVFILE_HPP
+
+#include "Samples/SampleBuffer.hpp"
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * A WAV, RF64 or BW64 file mapped into memory.
+	 *
+	 * open() maps the whole file and walks its chunks once, checking that
+	 * every chunk fits in the file and that the format is one we can read:
+	 * integer PCM of 8 to 32 bits or 32 and 64 bit float, plain or
+	 * WAVE_FORMAT_EXTENSIBLE. Nothing is read or copied up front, the
+	 * samples are paged in from the data chunk as they are used.
+	 *
+	 * From there the samples can go into a SampleBuffer three ways:
+	 *
+	 * - map(): a mono file already in the buffer's format is used in place,
+	 *   no copy at all. Pages are private, so writing to the buffer (loop
+	 *   recording, normalising) never touches the file.
+	 * - decode(): anything else is converted straight out of the mapping
+	 *   into planar storage, one pass, no intermediate buffers.
+	 * - read(): decodes any range of one channel on demand, for callers that
+	 *   never want the whole file in memory.
+	 *
+	 * On systems without mmap the file is read into memory instead.
+	 */
+	class WavFile
+	{
+
+	public:
+
+		enum class Encoding : unsigned char
+		{
+			Integer,
+			Float
+		};
+
+		// How the samples are going to be read, passed on to the kernel with madvise.
+		enum class Access : unsigned char
+		{
+			Normal,
+			Sequential,
+			Random,
+			WillNeed,   /*!< Start paging the data in now. */
+			DontNeed    /*!< Drop the pages, they will be read again if used. */
+		};
+
+		struct Mapping;
+
+	private:
+
+		std::shared_ptr <Mapping> mapping;
+
+		std::string error;
+
+		unsigned short formatTag = 0;
+		unsigned short channels = 0;
+		unsigned short bitsPerSample = 0;
+		unsigned short blockAlign = 0;
+
+		std::uint32_t sampleRate = 0;
+		std::uint32_t byteRate = 0;
+
+		Encoding encoding = Encoding::Integer;
+
+		bool rf64 = false;
+
+		// Start and length of the sample data, whole frames only.
+		unsigned char* samples = nullptr;
+		std::uint64_t dataSize = 0;
+
+		bool fail(const std::string& message);
+
+		bool parse();
+
+		bool parseFormat(const unsigned char* chunk, std::uint64_t size);
+
+	public:
+
+		WavFile() = default;
+
+		explicit WavFile(const std::string& path);
+
+		bool open(const std::string& path);
+
+		void close();
+
+		void advise(Access access) const;
+
+		// Uses the data chunk as 'buffer' in place, when the layout allows it. Returns false otherwise.
+		bool map(SampleBuffer& buffer, SampleBuffer::Format format) const;
+
+		// Converts every channel into 'buffer'.
+		bool decode(SampleBuffer& buffer, SampleBuffer::Format format) const;
+
+		// 'count' samples of one channel from frame 'start'. Past the end reads as zero.
+		void read(std::size_t channel, std::uint64_t start, std::size_t count, float* output) const;
+
+		// Getters
+
+		[[nodiscard]] bool isOpen() const;
+
+		// Why the last open() failed.
+		[[nodiscard]] const std::string& getError() const;
+
+		[[nodiscard]] unsigned short getFormatTag() const;
+
+		[[nodiscard]] Encoding getEncoding() const;
+
+		[[nodiscard]] unsigned short getNumChannels() const;
+
+		[[nodiscard]] unsigned short getBitsPerSample() const;
+
+		[[nodiscard]] unsigned short getBlockAlign() const;
+
+		[[nodiscard]] std::uint32_t getSampleRate() const;
+
+		[[nodiscard]] std::uint32_t getByteRate() const;
+
+		[[nodiscard]] std::uint64_t getNumFrames() const;
+
+		[[nodiscard]] std::uint64_t getDataSize() const;
+
+		// Byte offset of the first sample in the file, for reading it without the mapping.
+		[[nodiscard]] std::uint64_t getDataOffset() const;
+
+		[[nodiscard]] const unsigned char* getData() const;
+
+		[[nodiscard]] bool isRF64() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_WAVFILE_HPP
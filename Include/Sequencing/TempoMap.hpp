@@ -0,0 +1,80 @@
+#ifndef MAXIMILIAN_TEMPOMAP_HPP
+#define MAXIMILIAN_TEMPOMAP_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Converts between musical time, in ticks of TICKS_PER_BEAT to the beat,
+	 * and the sample timeline, through a list of tempo changes.
+	 *
+	 * Each change stores the exact sample it falls on, and a tick is placed
+	 * from the change before it rather than from the tick before it, so
+	 * positions never drift however long the song is. Ticks land on the
+	 * nearest sample.
+	 */
+	class TempoMap
+	{
+
+	public:
+
+		static constexpr std::int64_t TICKS_PER_BEAT = 960;
+
+		// Changes that fit without allocating.
+		static constexpr std::size_t RESERVED_CHANGES = 64;
+
+		struct Change
+		{
+			std::int64_t tick = 0;
+
+			// Where the tick falls, not rounded.
+			double sample = 0.0;
+
+			double samplesPerTick = 0.0;
+
+			double bpm = 0.0;
+		};
+
+	private:
+
+		std::vector <Change> changes;
+
+		double sampleRate = 0.0;
+
+		// The change in force at 'tick'.
+		const Change& atTick(std::int64_t tick) const;
+
+		const Change& atSample(double sample) const;
+
+	public:
+
+		explicit TempoMap(double bpm = 120.0);
+
+		// A single tempo from the start. Takes the sample rate from Settings.
+		void reset(double bpm);
+
+		// The tempo from 'tick' on, replacing any change after it.
+		void setTempo(std::int64_t tick, double bpm);
+
+		// The nearest sample to 'tick'.
+		[[nodiscard]] std::int64_t toSample(std::int64_t tick) const;
+
+		// Where 'sample' falls in ticks, with the fraction.
+		[[nodiscard]] double toTick(std::int64_t sample) const;
+
+		// Getters
+
+		[[nodiscard]] double getTempo(std::int64_t tick) const;
+
+		[[nodiscard]] double getSamplesPerTick(std::int64_t tick) const;
+
+		[[nodiscard]] const std::vector <Change>& getChanges() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_TEMPOMAP_HPP
@@ -0,0 +1,198 @@
+#ifndef MAXIMILIAN_TRANSPORT_HPP
+#define MAXIMILIAN_TRANSPORT_HPP
+
+#include "Sequencing/TempoMap.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+namespace Maximilian
+{
+
+	/**
+	 * A play position on an integer sample timeline, a tempo map, and a queue
+	 * of events in musical time that fire on the exact sample they fall on.
+	 *
+	 * process() splits each block at the events inside it: it calls
+	 * render(offset, frames) for the stretch up to an event, handle(event) for
+	 * the event, and carries on, so a trigger handled there sounds from its
+	 * own sample whatever the block size. The work per block follows the
+	 * number of events in it, nothing is done per sample.
+	 *
+	 * 	transport.schedule({ 0, TempoMap::TICKS_PER_BEAT, KICK });
+	 * 	transport.play();
+	 *
+	 * 	transport.process(frames,
+	 * 		[&](std::size_t offset, std::size_t count) { kit.play(output + offset, count); },
+	 * 		[&](const Transport::Event& event) { kit.trigger(event.target); });
+	 *
+	 * Events with a period fire again that many ticks later, which is all a
+	 * step sequence needs. Tempo changes move the events still queued, since
+	 * they are placed on the timeline only when they come up. The queue is a
+	 * binary heap in storage reserved by setup(): schedule() never allocates
+	 * and refuses events when it is full.
+	 */
+	class Transport
+	{
+
+	public:
+
+		struct Event
+		{
+			// When it fires, in ticks from the start.
+			std::int64_t tick = 0;
+
+			// Ticks until it fires again, 0 to fire once.
+			std::int64_t period = 0;
+
+			// What it is for: an instrument, a voice, a step. Up to the caller.
+			std::int32_t target = 0;
+
+			double note = 0.0;
+
+			double velocity = 1.0;
+		};
+
+	private:
+
+		struct Entry
+		{
+			Event event;
+
+			// Keeps events on the same tick in the order they were scheduled.
+			std::uint64_t order = 0;
+		};
+
+		// The heap puts the latest entry last, so the root is the earliest.
+		static bool later(const Entry& a, const Entry& b)
+		{
+			return a.event.tick != b.event.tick ? a.event.tick > b.event.tick : a.order > b.order;
+		}
+
+		TempoMap tempo;
+
+		std::vector <Entry> queue;
+
+		std::size_t capacity = 0;
+
+		std::uint64_t order = 0;
+
+		std::uint64_t dropped = 0;
+
+		std::int64_t position = 0;
+
+		bool playing = false;
+
+		void push(const Entry& entry);
+
+	public:
+
+		explicit Transport(std::size_t _capacity = 4096, double bpm = 120.0);
+
+		// Allocates room for '_capacity' queued events. Clears the queue.
+		void setup(std::size_t _capacity);
+
+		// Queues 'event'. False, and the event is dropped, when the queue is full.
+		bool schedule(const Event& event);
+
+		// Empties the queue.
+		void clear();
+
+		void play();
+
+		void stop();
+
+		// Moves the play position. Queued events before it fire at the start of the next block.
+		void locate(std::int64_t sample);
+
+		/**
+		 * Moves on 'frames' samples. Calls render(std::size_t offset,
+		 * std::size_t count) for each stretch between events and
+		 * handle(const Event&) for each event, in time order, starting on the
+		 * sample it falls on. Events handle() schedules in this block fire in
+		 * it too. Stopped, it renders the whole block and stays put.
+		 */
+		template <typename Render, typename Handle>
+		void process(const std::size_t frames, Render&& render, Handle&& handle)
+		{
+			if (!playing)
+			{
+				render(std::size_t(0), frames);
+				return;
+			}
+
+			const std::int64_t end = position + std::int64_t(frames);
+			std::size_t offset = 0;
+			while (!queue.empty())
+			{
+				const std::int64_t at = std::max(tempo.toSample(queue.front().event.tick), position);
+				if (at >= end)
+				{
+					break;
+				}
+				if (at > position)
+				{
+					render(offset, std::size_t(at - position));
+					offset += std::size_t(at - position);
+					position = at;
+				}
+
+				std::pop_heap(queue.begin(), queue.end(), later);
+				Entry entry = queue.back();
+				queue.pop_back();
+				if (entry.event.period > 0)
+				{
+					Entry next = entry;
+					next.event.tick += entry.event.period;
+					// After a locate, repeats the position has passed are skipped rather than fired all at once.
+					if (tempo.toSample(next.event.tick) < position)
+					{
+						const auto now = std::int64_t(std::ceil(tempo.toTick(position)));
+						next.event.tick += (now - next.event.tick + entry.event.period - 1) / entry.event.period *
+										   entry.event.period;
+					}
+					push(next);
+				}
+				handle(static_cast<const Event&>(entry.event));
+			}
+			if (end > position)
+			{
+				render(offset, std::size_t(end - position));
+			}
+			position = end;
+		}
+
+		// Getters
+
+		[[nodiscard]] bool isPlaying() const;
+
+		// In samples from the start.
+		[[nodiscard]] std::int64_t getPosition() const;
+
+		[[nodiscard]] double getTick() const;
+
+		[[nodiscard]] double getBeat() const;
+
+		[[nodiscard]] double getTempo() const;
+
+		[[nodiscard]] std::size_t getNumEvents() const;
+
+		// Events schedule() refused because the queue was full.
+		[[nodiscard]] std::uint64_t getDroppedEvents() const;
+
+		[[nodiscard]] TempoMap& getTempoMap();
+
+		[[nodiscard]] const TempoMap& getTempoMap() const;
+
+		// Setters
+
+		// The tempo from the current position on.
+		void setTempo(double bpm);
+
+	};
+}
+
+#endif //MAXIMILIAN_TRANSPORT_HPP
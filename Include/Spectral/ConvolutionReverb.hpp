@@ -0,0 +1,77 @@
+#ifndef MAXIMILIAN_CONVOLUTIONREVERB_HPP
+#define MAXIMILIAN_CONVOLUTIONREVERB_HPP
+
+#include "Maximilian.hpp"
+#include "Spectral/Convolver.hpp"
+
+#include <array>
+#include <string>
+
+namespace Maximilian
+{
+
+	/**
+	 * Convolution reverb for mono, stereo or true stereo impulse responses.
+	 *
+	 * - Mono: one response, one channel in and out.
+	 * - Stereo: left and right responses, each channel convolved with its own.
+	 * - TrueStereo: four responses (left to left, left to right, right to left,
+	 *   right to right), each output hears both inputs.
+	 *
+	 * Responses come from Clips or straight from a WAV file, where the
+	 * channels are taken in the order above. Loading allocates, keep it off
+	 * the audio thread.
+	 */
+	class ConvolutionReverb
+	{
+
+	public:
+
+		enum class Mode : unsigned char
+		{
+			Mono,
+			Stereo,
+			TrueStereo
+		};
+
+	private:
+
+		Mode mode = Mode::Mono;
+
+		std::array <Convolver, 4> convolvers;
+
+		void setResponse(std::size_t index, const Clip& clip, std::size_t channel);
+
+	public:
+
+		ConvolutionReverb() = default;
+
+		// The Clips' read channels are used as the responses.
+		void load(const Clip& response);
+
+		void load(const Clip& left, const Clip& right);
+
+		void load(const Clip& leftToLeft, const Clip& leftToRight, const Clip& rightToLeft, const Clip& rightToRight);
+
+		// Reads as many channels as the mode needs, a mono file is used for every response.
+		bool load(const std::string& fileName, Mode _mode);
+
+		double play(double input);
+
+		void play(double inputLeft, double inputRight, double& outputLeft, double& outputRight);
+
+		// Planar buffers: input[0..1] and output[0..1], only the first of each in Mono mode.
+		void process(const double* const* input, double* const* output, std::size_t frames);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] Mode getMode() const;
+
+		[[nodiscard]] std::size_t getMissedDeadlines() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_CONVOLUTIONREVERB_HPP
@@ -0,0 +1,97 @@
+#ifndef MAXIMILIAN_CONVOLVER_HPP
+#define MAXIMILIAN_CONVOLVER_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Zero latency convolution with a non-uniformly partitioned impulse response.
+	 *
+	 * The first HEAD_SIZE taps run as a direct form FIR, so the output has no
+	 * delay. The rest of the response is cut into stages of uniformly
+	 * partitioned FFT convolution (overlap-save), each stage using blocks
+	 * eight times longer than the one before:
+	 *
+	 * 	taps [64, 1024)       blocks of 64, on the audio thread
+	 * 	taps [1024, 8192)     blocks of 512, background
+	 * 	taps [8192, 65536)    blocks of 4096, background
+	 * 	...
+	 *
+	 * A stage with blocks of B samples starts 2B taps into the response, so its
+	 * work can run on the shared background worker during the B samples after
+	 * its input block is complete. When a result is not ready at that point
+	 * the audio thread takes the job over itself (or waits for one already
+	 * running) and counts a missed deadline, it never outputs a gap.
+	 *
+	 * setImpulseResponse() allocates and synchronises with the worker; call it
+	 * outside the audio callback. play() and process() don't allocate.
+	 */
+	class Convolver
+	{
+
+	public:
+
+		static constexpr std::size_t HEAD_SIZE = 64;
+
+		// Block size growth from one stage to the next.
+		static constexpr std::size_t STAGE_GROWTH = 8;
+
+		struct Stage;
+
+	private:
+
+		std::vector <double> head;
+
+		std::vector <std::unique_ptr <Stage>> stages;
+
+		// Input history and pending output, both indexed by the running sample count.
+		std::vector <double> history;
+		std::size_t historyMask = 0;
+
+		std::vector <double> pending;
+		std::size_t pendingMask = 0;
+
+		std::uint64_t now = 0;
+
+		std::atomic <std::size_t> missedDeadlines{ 0 };
+
+		void release();
+
+		void boundary(Stage& stage);
+
+	public:
+
+		Convolver();
+
+		~Convolver();
+
+		Convolver(const Convolver&) = delete;
+
+		Convolver& operator=(const Convolver&) = delete;
+
+		void setImpulseResponse(const double* impulseResponse, std::size_t length);
+
+		double play(double input);
+
+		// input and output may be the same buffer.
+		void process(const double* input, double* output, std::size_t frames);
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] std::size_t getLength() const;
+
+		// Background jobs the audio thread had to finish or wait for.
+		[[nodiscard]] std::size_t getMissedDeadlines() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_CONVOLVER_HPP
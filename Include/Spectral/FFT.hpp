@@ -0,0 +1,112 @@
+#ifndef MAXIMILIAN_FFT_HPP
+#define MAXIMILIAN_FFT_HPP
+
+#include <vector>
+#include <memory>
+#include <complex>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	using Complex = std::complex <double>;
+
+	/**
+	 * Immutable tables for a complex transform of one size: its factorisation
+	 * into radices and the twiddle factors of both directions.
+	 *
+	 * Plans are built once per size and shared, get() hands out the cached
+	 * plan. Building a plan allocates and takes a lock, so ask for it (by
+	 * constructing the FFT that uses it) outside the audio callback.
+	 */
+	class FFTPlan
+	{
+
+	private:
+
+		std::size_t size = 0;
+
+		// Pairs of (radix, remaining length) from the outermost stage in.
+		std::vector <std::size_t> factors;
+
+		std::vector <Complex> forwardTwiddles;
+		std::vector <Complex> inverseTwiddles;
+
+		std::size_t largestRadix = 0;
+
+		explicit FFTPlan(std::size_t _size);
+
+	public:
+
+		static std::shared_ptr <const FFTPlan> get(std::size_t size);
+
+		// Getters
+
+		[[nodiscard]] std::size_t getSize() const;
+
+		[[nodiscard]] const std::vector <std::size_t>& getFactors() const;
+
+		[[nodiscard]] const Complex* getTwiddles(bool inverse) const;
+
+		[[nodiscard]] std::size_t getLargestRadix() const;
+
+	};
+
+	/**
+	 * Real input FFT of any even size.
+	 *
+	 * A transform of n real samples runs as a complex transform of n / 2
+	 * points with radix 4, 2, 3 and 5 butterflies (and a generic one for other
+	 * prime factors), then splits the result into the n / 2 + 1 bins of the
+	 * real spectrum. Powers of two are fastest but any even size works.
+	 *
+	 * The forward transform is unscaled and inverse() divides by n, so
+	 * inverse(forward(x)) == x. Every buffer is allocated in the constructor
+	 * and forward() and inverse() never allocate.
+	 */
+	class FFT
+	{
+
+	private:
+
+		std::size_t size = 0;
+
+		std::shared_ptr <const FFTPlan> plan;
+
+		// exp(-i * pi * ((k + 1) / (size / 2) + 1 / 2)), used to split and merge the real spectrum.
+		std::vector <Complex> superTwiddles;
+
+		std::vector <Complex> packed;
+		std::vector <Complex> transformed;
+		std::vector <Complex> scratch;
+
+		void transform(const Complex* input, Complex* output, bool inverse);
+
+		void stage(Complex* output, const Complex* input, std::size_t stride, const std::size_t* factors,
+				const Complex* twiddles, bool inverse);
+
+	public:
+
+		FFT() = default;
+
+		explicit FFT(std::size_t _size);
+
+		// Allocates; call outside the audio callback.
+		void setup(std::size_t _size);
+
+		// size real samples in, size / 2 + 1 bins out.
+		void forward(const double* input, Complex* output);
+
+		// size / 2 + 1 bins in, size real samples out.
+		void inverse(const Complex* input, double* output);
+
+		// Getters
+
+		[[nodiscard]] std::size_t getSize() const;
+
+		[[nodiscard]] std::size_t getNumBins() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_FFT_HPP
@@ -0,0 +1,169 @@
+#ifndef MAXIMILIAN_PHASEVOCODER_HPP
+#define MAXIMILIAN_PHASEVOCODER_HPP
+
+#include "Maximilian.hpp"
+#include "Spectral/FFT.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Phase vocoder analysis of a whole Clip: magnitude, phase and
+	 * instantaneous frequency of every bin of every frame, plus a flag on
+	 * frames that start a transient.
+	 *
+	 * Analyses are cached, get() returns the existing one when the same
+	 * sample data was already analysed with the same sizes, so any number of
+	 * voices can play one clip for the cost of a single analysis. The cache
+	 * is keyed on the clip's SampleData, which an analysis keeps alive, so a
+	 * lookup never touches the audio; a clip that changes its samples takes
+	 * a copy of them first and so gets an analysis of its own. Building one
+	 * allocates and runs every FFT of the clip, do it off the audio thread.
+	 */
+	class PhaseVocoderAnalysis
+	{
+
+	private:
+
+		// What was analysed, held so its address identifies it in the cache.
+		std::shared_ptr <const SampleData> source;
+
+		std::size_t fftSize = 0;
+		std::size_t hopSize = 0;
+		std::size_t bins = 0;
+		std::size_t frames = 0;
+
+		// frames * bins, frame major. Floats halve the footprint of long clips.
+		std::vector <float> magnitudes;
+		std::vector <float> phases;
+		std::vector <float> frequencies;
+
+		std::vector <std::uint8_t> transients;
+
+		PhaseVocoderAnalysis(const Clip& clip, std::size_t _fftSize, std::size_t _hopSize);
+
+		void detectTransients(const std::vector <double>& flux);
+
+	public:
+
+		// Spectral flux above this multiple of the recent average marks a transient.
+		static constexpr double TRANSIENT_THRESHOLD = 2.0;
+
+		static std::shared_ptr <const PhaseVocoderAnalysis>
+		get(const Clip& clip, std::size_t fftSize = 2048, std::size_t hopSize = 512);
+
+		// Getters
+
+		[[nodiscard]] std::size_t getFFTSize() const;
+
+		[[nodiscard]] std::size_t getHopSize() const;
+
+		[[nodiscard]] std::size_t getNumBins() const;
+
+		[[nodiscard]] std::size_t getNumFrames() const;
+
+		[[nodiscard]] const float* getMagnitudes(std::size_t frame) const;
+
+		[[nodiscard]] const float* getPhases(std::size_t frame) const;
+
+		// Radians per sample.
+		[[nodiscard]] const float* getFrequencies(std::size_t frame) const;
+
+		[[nodiscard]] bool isTransient(std::size_t frame) const;
+
+	};
+
+	/**
+	 * Plays a Clip through its phase vocoder analysis, with speed and pitch
+	 * set independently.
+	 *
+	 * 	PhaseVocoder voice;
+	 * 	voice.setClip(loop);      // shares the analysis with other voices of 'loop'
+	 * 	voice.setSpeed(0.8);      // 80% tempo, same pitch
+	 * 	voice.setPitch(1.5);      // a fifth up, same tempo
+	 * 	voice.process(out, frames);
+	 *
+	 * Phases are re-seeded from the analysis at transient frames so attacks
+	 * stay sharp instead of being smeared by phase propagation. Pitch is
+	 * shifted by moving each spectral peak and its neighbourhood together with
+	 * locked phases, which moves the formants along with the partials.
+	 *
+	 * Output starts on the first sample of the clip, the frames overlapping
+	 * earlier samples are run when the position is set.
+	 */
+	class PhaseVocoder
+	{
+
+	private:
+
+		std::shared_ptr <const PhaseVocoderAnalysis> analysis;
+
+		FFT fft;
+
+		std::vector <double> window;
+		std::vector <double> frame;
+		std::vector <Complex> spectrum;
+		std::vector <double> magnitude;
+		std::vector <std::size_t> peaks;
+		// Output phases of the last synthesised frame.
+		std::vector <double> synthesisPhase;
+		std::vector <double> shiftedMagnitude;
+		std::vector <double> shiftedPhase;
+		std::vector <double> overlap;
+		std::vector <double> ready;
+		std::size_t readyRead = 0;
+
+		double synthesisGain = 1.0;
+
+		double position = 0.0;
+		double speed = 1.0;
+		double pitch = 1.0;
+		bool looping = true;
+		bool playing = true;
+
+		std::size_t lastFrame = SIZE_MAX;
+
+		void synthesise();
+
+	public:
+
+		PhaseVocoder() = default;
+
+		// Allocates; call outside the audio callback.
+		void setClip(const Clip& clip, std::size_t fftSize = 2048, std::size_t hopSize = 512);
+
+		double play();
+
+		void process(double* output, std::size_t frames);
+
+		// Back to the start with fresh phases.
+		void trigger();
+
+		// Getters
+
+		[[nodiscard]] double getPosition() const;
+
+		[[nodiscard]] bool isPlaying() const;
+
+		// Setters
+
+		// Playback rate of the material, 1 is the original tempo, 0 freezes.
+		void setSpeed(double _speed);
+
+		// Frequency ratio, 2 is an octave up.
+		void setPitch(double _pitch);
+
+		// Between 0.0 and 1.0.
+		void setPosition(double _position);
+
+		void setLooping(bool _looping);
+
+	};
+}
+
+#endif //MAXIMILIAN_PHASEVOCODER_HPP
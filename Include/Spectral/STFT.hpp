@@ -0,0 +1,147 @@
+#ifndef MAXIMILIAN_STFT_HPP
+#define MAXIMILIAN_STFT_HPP
+
+#include "Spectral/FFT.hpp"
+#include "Spectral/Window.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Short time Fourier transform: windowed analysis every hopSize samples
+	 * and, for the block process, overlap-add resynthesis.
+	 *
+	 * Analysis only, one sample at a time (what maxiFFT used to do):
+	 *
+	 * 	stft.setup(1024, 512, 256);
+	 * 	if (stft.process(sample)) { use stft.getMagnitudes() }
+	 *
+	 * Analysis, spectral processing and resynthesis over blocks:
+	 *
+	 * 	stft.process(input, output, frames, [](Complex* bins, std::size_t numBins) { ... });
+	 *
+	 * The output of the block process is delayed by getLatency() samples.
+	 * Unchanged bins give back the input at any hop the windows overlap at;
+	 * a hop of a quarter window or less keeps the gain even across the frame
+	 * when the bins are changed. setup() allocates; process() never does.
+	 */
+	class STFT
+	{
+
+	private:
+
+		std::size_t fftSize = 0;
+		std::size_t windowSize = 0;
+		std::size_t hopSize = 0;
+
+		FFT fft;
+
+		std::vector <double> window;
+
+		// The last windowSize input samples, written circularly.
+		std::vector <double> inputRing;
+		std::size_t inputWrite = 0;
+		std::size_t hopCount = 0;
+
+		std::vector <double> frame;
+		std::vector <Complex> spectrum;
+		std::vector <double> magnitudes;
+		std::vector <double> phases;
+
+		// Overlap-add accumulator and the finished samples waiting to be output.
+		std::vector <double> overlap;
+		std::vector <double> ready;
+		std::size_t readyRead = 0;
+
+		// Per position within a hop, one over the squared window summed over the frames that overlap there.
+		std::vector <double> synthesisGain;
+
+		// Adds one sample, returns true when a frame is due.
+		inline bool push(double sample)
+		{
+			inputRing[inputWrite] = sample;
+			if (++inputWrite == windowSize)
+			{
+				inputWrite = 0;
+			}
+			if (++hopCount == hopSize)
+			{
+				hopCount = 0;
+				return true;
+			}
+			return false;
+		}
+
+		inline double pop()
+		{
+			return readyRead < hopSize ? ready[readyRead++] : 0.0;
+		}
+
+		void analyse();
+
+		void synthesise();
+
+		void updatePolar();
+
+	public:
+
+		STFT() = default;
+
+		STFT(std::size_t _fftSize, std::size_t _windowSize, std::size_t _hopSize,
+				Window::Type type = Window::Type::Hann);
+
+		// windowSize <= fftSize, frames shorter than the FFT are zero padded.
+		void setup(std::size_t _fftSize, std::size_t _windowSize, std::size_t _hopSize,
+				Window::Type type = Window::Type::Hann);
+
+		// Returns true when a new frame was analysed, magnitudes and phases are then current.
+		bool process(double sample);
+
+		/**
+		 * Analyses 'input', calls spectral(Complex* bins, std::size_t numBins) on
+		 * every frame so it can change the bins, and overlap-adds the result into
+		 * 'output'. input and output may be the same buffer.
+		 */
+		template <typename Processor>
+		void process(const double* input, double* output, std::size_t frames, Processor&& spectral)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				if (push(input[n]))
+				{
+					analyse();
+					spectral(spectrum.data(), spectrum.size());
+					synthesise();
+				}
+				output[n] = pop();
+			}
+		}
+
+		void reset();
+
+		// Getters
+
+		[[nodiscard]] const std::vector <Complex>& getSpectrum() const;
+
+		[[nodiscard]] const std::vector <double>& getMagnitudes() const;
+
+		[[nodiscard]] const std::vector <double>& getPhases() const;
+
+		[[nodiscard]] std::size_t getNumBins() const;
+
+		[[nodiscard]] std::size_t getFFTSize() const;
+
+		[[nodiscard]] std::size_t getWindowSize() const;
+
+		[[nodiscard]] std::size_t getHopSize() const;
+
+		// Delay of the block process output, in samples.
+		[[nodiscard]] std::size_t getLatency() const;
+
+	};
+}
+
+#endif //MAXIMILIAN_STFT_HPP
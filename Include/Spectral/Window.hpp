@@ -0,0 +1,38 @@
+#ifndef MAXIMILIAN_WINDOW_HPP
+#define MAXIMILIAN_WINDOW_HPP
+
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Window functions, written into tables once and reused.
+	 */
+	class Window
+	{
+
+	public:
+
+		enum class Type : unsigned char
+		{
+			Rectangular,
+			Hann,
+			Hamming,
+			Blackman
+		};
+
+		// Fills 'table' with a periodic window of 'size' points, the form that overlap-adds evenly.
+		static void fill(Type type, double* table, std::size_t size);
+
+		// Symmetric Kaiser window, the form used to design FIR filters. Larger beta trades a
+		// wider main lobe for lower side lobes, about 0.1102 * (dB - 8.7) for a stop band of dB.
+		static void fillKaiser(double* table, std::size_t size, double beta);
+
+		// Modified Bessel function of the first kind, order zero.
+		static double besselI0(double x);
+
+	};
+}
+
+#endif //MAXIMILIAN_WINDOW_HPP
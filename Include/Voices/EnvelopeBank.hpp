@@ -0,0 +1,145 @@
+#ifndef MAXIMILIAN_ENVELOPEBANK_HPP
+#define MAXIMILIAN_ENVELOPEBANK_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Many envelopes, one per voice of a polyphonic instrument, rendered a
+	 * block at a time.
+	 *
+	 * An envelope follows a Shape, a list of segments that each go to a
+	 * level in a time, along a straight line or an exponential curve. When an
+	 * envelope enters a segment, the segment's length in samples and the two
+	 * coefficients of its curve are worked out, after which every sample of
+	 * it is level = level * multiplier + offset. Within a block, process()
+	 * runs that for every envelope up to the first segment end among them, a
+	 * loop with no branches across envelopes laid out side by side, which
+	 * the compiler vectorises. Only at segment ends does it look at one
+	 * envelope at a time.
+	 *
+	 * 	EnvelopeBank::Shape pluck = EnvelopeBank::Shape::adsr(5, 200, 0.3, 400);
+	 * 	bank.trigger(voice, pluck);
+	 * 	...
+	 * 	bank.process(levels, frames);   // levels[frame * lanes + voice]
+	 *
+	 * Nothing allocates after setup().
+	 */
+	class EnvelopeBank
+	{
+
+	public:
+
+		enum class Curve : unsigned char
+		{
+			Linear,
+			Exponential     /*!< Fast then slow, within -60 dB of its level at the end. */
+		};
+
+		struct Segment
+		{
+			double level = 0.0;
+
+			// In milliseconds.
+			double time = 0.0;
+
+			Curve curve = Curve::Linear;
+		};
+
+		/**
+		 * The segments an envelope goes through from a trigger. It holds the
+		 * level of the segment at 'sustain' until release(), then goes
+		 * through the segments after it. Shapes are read, not copied, by
+		 * trigger(): keep them alive while envelopes use them.
+		 */
+		struct Shape
+		{
+			static constexpr std::size_t NO_SUSTAIN = std::size_t(-1);
+
+			std::vector <Segment> segments;
+
+			std::size_t sustain = NO_SUSTAIN;
+
+			// Times in milliseconds, 'sustainLevel' from 0 to 1. Exponential decay and release.
+			static Shape adsr(double attack, double decay, double sustainLevel, double release,
+					Curve curve = Curve::Exponential);
+
+			static Shape ar(double attack, double release, Curve curve = Curve::Linear);
+
+			/**
+			 * Straight lines through (time in seconds, level) pairs, the
+			 * format Envelope::ramps() reads: { 0.1, 1, 0.5, 0.2 } rises to 1
+			 * in 0.1 s then falls to 0.2 in 0.5 s. No sustain.
+			 */
+			static Shape ramps(const std::vector <double>& pairs);
+		};
+
+	private:
+
+		static constexpr std::int64_t FOREVER = INT64_MAX / 2;
+
+		// Per envelope, each an array across the envelopes.
+		std::vector <double> levels;
+		std::vector <double> multipliers;
+		std::vector <double> offsets;
+		std::vector <double> targets;
+		std::vector <std::int64_t> remaining;
+		std::vector <std::size_t> segments;
+		std::vector <const Shape*> shapes;
+		std::vector <unsigned char> released;
+
+		// Samples to the first segment end of any envelope.
+		std::int64_t untilNext = FOREVER;
+
+		// Works out the samples and coefficients of the segment an envelope has reached.
+		void enter(std::size_t lane, std::size_t segment);
+
+		// The segment after the current one, or the rest at the end of the shape.
+		void advance(std::size_t lane);
+
+		void updateUntilNext();
+
+	public:
+
+		EnvelopeBank() = default;
+
+		explicit EnvelopeBank(std::size_t lanes);
+
+		// Allocates, call it outside the audio callback. Every envelope at rest at 0.
+		void setup(std::size_t lanes);
+
+		// Starts 'shape' from the envelope's current level, so a retrigger doesn't click.
+		void trigger(std::size_t lane, const Shape& shape);
+
+		// The bank keeps a pointer to the shape, a temporary would be gone before its first segment ends.
+		void trigger(std::size_t lane, Shape&& shape) = delete;
+
+		// Leaves the sustain segment, or goes to it when it hasn't been reached yet.
+		void release(std::size_t lane);
+
+		// At rest at 0 at once.
+		void reset(std::size_t lane);
+
+		// 'frames' samples of every envelope, output[frame * getNumLanes() + lane].
+		void process(double* output, std::size_t frames);
+
+		// Moves on 'frames' samples without writing them, the levels are read with getLevel().
+		void process(std::size_t frames);
+
+		// Getters
+
+		[[nodiscard]] std::size_t getNumLanes() const;
+
+		[[nodiscard]] double getLevel(std::size_t lane) const;
+
+		// False once the shape has ended, or before the first trigger.
+		[[nodiscard]] bool isActive(std::size_t lane) const;
+
+	};
+}
+
+#endif //MAXIMILIAN_ENVELOPEBANK_HPP
@@ -0,0 +1,190 @@
+#ifndef MAXIMILIAN_VOICEALLOCATOR_HPP
+#define MAXIMILIAN_VOICEALLOCATOR_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Maximilian
+{
+
+	/**
+	 * Decides which voice of a polyphonic instrument plays each note.
+	 *
+	 * It only keeps the books; the instrument owns the voices and does the
+	 * processing. Sounding voices are kept in a dense list, getActive(), so a
+	 * block loop touches only those and the cost follows the notes actually
+	 * playing rather than the voice count:
+	 *
+	 * 	const auto& active = allocator.getActive();
+	 * 	for (std::size_t i = active.size(); i-- > 0;)
+	 * 	{
+	 * 		render(active[i]);      // may call allocator.retire(active[i])
+	 * 	}
+	 *
+	 * Walking the list backwards like this stays valid when a voice retires
+	 * on the way, retire() moves the last entry into the freed place.
+	 *
+	 * When every voice is busy, noteOn() steals one: releasing voices before
+	 * held ones, and among those the oldest or the quietest (levels reported
+	 * through setLevel()). A stolen voice comes back in the Stolen state, for
+	 * the instrument to fade out briefly before it calls start() and plays
+	 * the new note on it, so stealing never clicks.
+	 *
+	 * Nothing allocates after setup().
+	 */
+	class VoiceAllocator
+	{
+
+	public:
+
+		enum class Stealing : unsigned char
+		{
+			None,       /*!< Notes beyond the voice count are dropped. */
+			Oldest,     /*!< The voice started longest ago. */
+			Quietest    /*!< The voice with the lowest level. */
+		};
+
+		enum class State : unsigned char
+		{
+			Free,
+			Playing,    /*!< Note held. */
+			Releasing,  /*!< Note off received, sounding until the envelope ends. */
+			Stolen      /*!< Fading out, the new note starts with start(). */
+		};
+
+		static constexpr std::size_t NONE = std::size_t(-1);
+
+	private:
+
+		struct Voice
+		{
+			State state = State::Free;
+
+			double note = 0.0;
+
+			// When the note started, for oldest first stealing.
+			std::uint64_t age = 0;
+
+			double level = 0.0;
+
+			// A note off that arrived while the voice was fading out for it.
+			bool released = false;
+
+			// Index in 'active', while sounding.
+			std::size_t slot = 0;
+		};
+
+		std::vector <Voice> voices;
+
+		std::vector <std::size_t> active;
+
+		std::vector <std::size_t> free;
+
+		std::size_t limit = 0;
+
+		std::uint64_t counter = 0;
+
+		Stealing stealing = Stealing::Oldest;
+
+		// The voice to steal, NONE if there is none.
+		std::size_t victim() const;
+
+	public:
+
+		VoiceAllocator() = default;
+
+		explicit VoiceAllocator(std::size_t capacity, Stealing _stealing = Stealing::Oldest);
+
+		// Allocates; call outside the audio callback. Releases every voice.
+		void setup(std::size_t capacity);
+
+		/**
+		 * The voice to play 'note' on. A free voice is returned Playing; a
+		 * stolen one is returned Stolen. NONE if every voice is busy and
+		 * stealing is off.
+		 */
+		std::size_t noteOn(double note);
+
+		/**
+		 * Moves the voices holding 'note' to Releasing and calls release(voice)
+		 * for each, for the instrument to start their release.
+		 */
+		template <typename Release>
+		void noteOff(const double note, Release&& release)
+		{
+			for (const std::size_t index : active)
+			{
+				Voice& voice = voices[index];
+				if (voice.note != note || voice.released)
+				{
+					continue;
+				}
+				if (voice.state == State::Playing)
+				{
+					voice.state = State::Releasing;
+					release(index);
+				}
+				else if (voice.state == State::Stolen)
+				{
+					voice.released = true;
+				}
+			}
+		}
+
+		// A stolen voice has faded out and starts its new note. Returns Releasing if that note has already ended.
+		State start(std::size_t voice);
+
+		// Marks one voice as releasing, for instruments that release voices themselves.
+		void release(std::size_t voice);
+
+		// The voice has gone silent and is free again.
+		void retire(std::size_t voice);
+
+		// Frees every voice.
+		void reset();
+
+		// Getters
+
+		// Indices of the sounding voices, in no particular order.
+		[[nodiscard]] const std::vector <std::size_t>& getActive() const
+		{
+			return active;
+		}
+
+		[[nodiscard]] std::size_t getNumActive() const;
+
+		[[nodiscard]] std::size_t getCapacity() const;
+
+		[[nodiscard]] std::size_t getLimit() const;
+
+		[[nodiscard]] State getState(std::size_t voice) const;
+
+		[[nodiscard]] double getNote(std::size_t voice) const;
+
+		/**
+		 * Where a sounding voice is in getActive(). retire() moves the last
+		 * entry into the retired voice's place, instruments that store voice
+		 * data by slot, to process it contiguously, mirror that move.
+		 */
+		[[nodiscard]] std::size_t getSlot(std::size_t voice) const;
+
+		[[nodiscard]] Stealing getStealing() const;
+
+		// Setters
+
+		// The current level of a voice, used by Stealing::Quietest.
+		inline void setLevel(const std::size_t voice, const double level)
+		{
+			voices[voice].level = level;
+		}
+
+		// Uses only the first '_limit' voices. Frees every voice.
+		void setLimit(std::size_t _limit);
+
+		void setStealing(Stealing _stealing);
+
+	};
+}
+
+#endif //MAXIMILIAN_VOICEALLOCATOR_HPP
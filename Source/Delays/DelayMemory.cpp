@@ -0,0 +1,168 @@
+#include "Delays/DelayMemory.hpp"
+
+#include <new>
+#include <algorithm>
+
+using namespace Maximilian;
+
+void DelayPool::AlignedDelete::operator()(double* slab) const
+{
+	::operator delete[](slab, std::align_val_t(64));
+}
+
+DelayPool& DelayPool::getDefault()
+{
+	static DelayPool* pool = new DelayPool();
+	return *pool;
+}
+
+std::size_t DelayPool::roundCapacity(const std::size_t minimumCapacity)
+{
+	std::size_t capacity = MINIMUM_CAPACITY;
+	while (capacity < minimumCapacity)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+static std::size_t sizeClass(std::size_t capacity)
+{
+	std::size_t exponent = 0;
+	while ((std::size_t(1) << exponent) < capacity)
+	{
+		++exponent;
+	}
+	return exponent;
+}
+
+double* DelayPool::acquire(const std::size_t capacity)
+{
+	double* block = nullptr;
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+
+		std::vector <double*>& list = freeBlocks[sizeClass(capacity)];
+		if (!list.empty())
+		{
+			block = list.back();
+			list.pop_back();
+		}
+		else
+		{
+			// Blocks are aligned to their own size inside the slab. When the current
+			// slab can't fit the request its remainder is abandoned for a new one.
+			const std::size_t offset = (slabUsed + capacity - 1) & ~(capacity - 1);
+			if (slab == nullptr || offset + capacity > slabSize)
+			{
+				const std::size_t size = std::max(capacity, SLAB_CAPACITY);
+				slabs.emplace_back(static_cast<double*>(::operator new[](size * sizeof(double), std::align_val_t(64))));
+				slab = slabs.back().get();
+				slabSize = size;
+				block = slab;
+				slabUsed = capacity;
+			}
+			else
+			{
+				block = slab + offset;
+				slabUsed = offset + capacity;
+			}
+		}
+	}
+	std::fill(block, block + capacity, 0.0);
+	return block;
+}
+
+void DelayPool::release(double* block, const std::size_t capacity)
+{
+	if (block == nullptr)
+	{ return; }
+	std::lock_guard <std::mutex> lock(mutex);
+	freeBlocks[sizeClass(capacity)].push_back(block);
+}
+
+DelayMemory::DelayMemory(const std::size_t minimumCapacity, DelayPool& _pool) : pool(&_pool)
+{
+	capacity = DelayPool::roundCapacity(minimumCapacity);
+	data = pool->acquire(capacity);
+}
+
+DelayMemory::DelayMemory(const DelayMemory& other) : pool(other.pool), capacity(other.capacity)
+{
+	if (other.data != nullptr)
+	{
+		data = pool->acquire(capacity);
+		std::copy(other.data, other.data + capacity, data);
+	}
+}
+
+DelayMemory::DelayMemory(DelayMemory&& other) noexcept: pool(other.pool), data(other.data), capacity(other.capacity)
+{
+	other.data = nullptr;
+	other.capacity = 0;
+}
+
+DelayMemory& DelayMemory::operator=(const DelayMemory& other)
+{
+	if (this != &other)
+	{
+		DelayMemory copy(other);
+		*this = std::move(copy);
+	}
+	return *this;
+}
+
+DelayMemory& DelayMemory::operator=(DelayMemory&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (data != nullptr)
+		{ pool->release(data, capacity); }
+		pool = other.pool;
+		data = other.data;
+		capacity = other.capacity;
+		other.data = nullptr;
+		other.capacity = 0;
+	}
+	return *this;
+}
+
+DelayMemory::~DelayMemory()
+{
+	if (data != nullptr)
+	{ pool->release(data, capacity); }
+}
+
+void DelayMemory::reserve(const std::size_t minimumCapacity, std::size_t& writeIndex)
+{
+	if (minimumCapacity <= capacity)
+	{ return; }
+
+	if (pool == nullptr)
+	{ pool = &DelayPool::getDefault(); }
+
+	const std::size_t grown = DelayPool::roundCapacity(minimumCapacity);
+	double* block = pool->acquire(grown);
+	if (data != nullptr)
+	{
+		// Oldest sample first, so the newest ends just before the new write index.
+		const std::size_t mask = capacity - 1;
+		for (std::size_t i = 0; i < capacity; ++i)
+		{
+			block[i] = data[(writeIndex + i) & mask];
+		}
+		pool->release(data, capacity);
+		writeIndex = capacity;
+	}
+	else
+	{
+		writeIndex = 0;
+	}
+	data = block;
+	capacity = grown;
+}
+
+void DelayMemory::clear()
+{
+	std::fill(data, data + capacity, 0.0);
+}
@@ -0,0 +1,214 @@
+#include "Delays/MultiTapDelay.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+MultiTapDelay::MultiTapDelay(const std::size_t _maximumDelay, const std::size_t numTaps,
+		const std::size_t numOutputs) : outputs(numOutputs), frame(numOutputs, 0.0)
+{
+	reserve(_maximumDelay);
+	setNumTaps(numTaps);
+}
+
+void MultiTapDelay::reserve(const std::size_t _maximumDelay)
+{
+	// Room for the four point kernel around the longest delay.
+	memory.reserve(_maximumDelay + 4, writeIndex);
+	maximumDelay = memory.getCapacity() - 3.0;
+}
+
+double MultiTapDelay::readTap(const std::size_t tap, double delaySamples)
+{
+	const double minimum = interpolation == Interpolation::Hermite ? 2.0 : 1.0;
+	delaySamples = std::min(std::max(delaySamples, minimum), maximumDelay);
+
+	const std::size_t whole = (std::size_t)delaySamples;
+	const double fraction = delaySamples - whole;
+	const std::size_t mask = memory.getMask();
+	const std::size_t read = writeIndex - whole;
+
+	switch (interpolation)
+	{
+	case Interpolation::Hermite:
+	{
+		const double xm1 = memory[(read + 1) & mask];
+		const double x0 = memory[read & mask];
+		const double x1 = memory[(read - 1) & mask];
+		const double x2 = memory[(read - 2) & mask];
+		const double c1 = 0.5 * (x1 - xm1);
+		const double c2 = xm1 - 2.5 * x0 + 2.0 * x1 - 0.5 * x2;
+		const double c3 = 0.5 * (x2 - xm1) + 1.5 * (x0 - x1);
+		return ((c3 * fraction + c2) * fraction + c1) * fraction + x0;
+	}
+	case Interpolation::AllPass:
+	{
+		const double eta = (1.0 - fraction) / (1.0 + fraction);
+		const double y = eta * memory[read & mask] + memory[(read - 1) & mask] - eta * allPassState[tap];
+		allPassState[tap] = y;
+		return y;
+	}
+	case Interpolation::Linear:
+	default:
+	{
+		const double x0 = memory[read & mask];
+		const double x1 = memory[(read - 1) & mask];
+		return x0 + fraction * (x1 - x0);
+	}
+	}
+}
+
+void MultiTapDelay::tick(const double input, double* output)
+{
+	const std::size_t numTaps = delay.size();
+	double write = input;
+	for (std::size_t t = 0; t < numTaps; ++t)
+	{
+		taps[t] = readTap(t, delay[t]);
+		write += feedback[t] * taps[t];
+	}
+	for (std::size_t o = 0; o < outputs; ++o)
+	{
+		const double* row = &gain[o * numTaps];
+		double sum = 0.0;
+		for (std::size_t t = 0; t < numTaps; ++t)
+		{
+			sum += row[t] * taps[t];
+		}
+		output[o] = sum;
+	}
+	memory[writeIndex] = write;
+	writeIndex = (writeIndex + 1) & memory.getMask();
+}
+
+double MultiTapDelay::play(const double input)
+{
+	primed = true;
+	delay = targetDelay;
+	tick(input, frame.data());
+	return frame[0];
+}
+
+void MultiTapDelay::play(const double input, double* output)
+{
+	primed = true;
+	delay = targetDelay;
+	tick(input, output);
+}
+
+void MultiTapDelay::process(const double* input, double* const* output, const std::size_t frames)
+{
+	if (frames == 0)
+	{ return; }
+
+	// Nothing to glide from until the first block has been heard.
+	if (!primed)
+	{
+		delay = targetDelay;
+		primed = true;
+	}
+
+	const std::size_t numTaps = delay.size();
+	const double step = 1.0 / frames;
+	bool ramping = false;
+	for (std::size_t t = 0; t < numTaps; ++t)
+	{
+		increment[t] = (targetDelay[t] - delay[t]) * step;
+		ramping |= increment[t] != 0.0;
+	}
+
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		if (ramping)
+		{
+			for (std::size_t t = 0; t < numTaps; ++t)
+			{
+				delay[t] += increment[t];
+			}
+		}
+		tick(input[n], frame.data());
+		for (std::size_t o = 0; o < outputs; ++o)
+		{
+			output[o][n] = frame[o];
+		}
+	}
+	delay = targetDelay;
+}
+
+void MultiTapDelay::clear()
+{
+	memory.clear();
+	std::fill(allPassState.begin(), allPassState.end(), 0.0);
+	primed = false;
+}
+
+std::size_t MultiTapDelay::getNumTaps() const
+{
+	return delay.size();
+}
+
+std::size_t MultiTapDelay::getNumOutputs() const
+{
+	return outputs;
+}
+
+double MultiTapDelay::getDelay(const std::size_t tap) const
+{
+	return targetDelay[tap];
+}
+
+void MultiTapDelay::setNumTaps(const std::size_t numTaps)
+{
+	const std::size_t previous = delay.size();
+	std::vector <double> resized(outputs * numTaps, 0.0);
+	for (std::size_t o = 0; o < outputs; ++o)
+	{
+		for (std::size_t t = 0; t < std::min(previous, numTaps); ++t)
+		{
+			resized[o * numTaps + t] = gain[o * previous + t];
+		}
+		// New taps are heard on every output at unity until told otherwise.
+		for (std::size_t t = previous; t < numTaps; ++t)
+		{
+			resized[o * numTaps + t] = 1.0;
+		}
+	}
+	gain.swap(resized);
+	delay.resize(numTaps, 1.0);
+	targetDelay.resize(numTaps, 1.0);
+	increment.resize(numTaps, 0.0);
+	feedback.resize(numTaps, 0.0);
+	allPassState.resize(numTaps, 0.0);
+	taps.resize(numTaps, 0.0);
+	primed = false;
+}
+
+void MultiTapDelay::setNumOutputs(const std::size_t numOutputs)
+{
+	const std::size_t numTaps = delay.size();
+	gain.resize(numOutputs * numTaps, 1.0);
+	frame.resize(numOutputs, 0.0);
+	outputs = numOutputs;
+}
+
+void MultiTapDelay::setInterpolation(const Interpolation _interpolation)
+{
+	interpolation = _interpolation;
+}
+
+void MultiTapDelay::setDelay(const std::size_t tap, const double samples)
+{
+	// Growing would allocate on the audio thread, longer delays stop at what was reserved.
+	targetDelay[tap] = std::min(samples, maximumDelay);
+}
+
+void MultiTapDelay::setGain(const std::size_t output, const std::size_t tap, const double _gain)
+{
+	gain[output * delay.size() + tap] = _gain;
+}
+
+void MultiTapDelay::setFeedback(const std::size_t tap, const double _feedback)
+{
+	feedback[tap] = _feedback;
+}
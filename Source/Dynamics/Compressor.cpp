@@ -0,0 +1,392 @@
+#include "Dynamics/Compressor.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	std::size_t toSamples(const double milliseconds)
+	{
+		return std::size_t(std::llround(std::max(milliseconds, 0.0) * 0.001 * Settings::SAMPLE_RATE));
+	}
+
+	double smoothing(const double milliseconds)
+	{
+		const double samples = milliseconds * 0.001 * Settings::SAMPLE_RATE;
+		return samples > 0.0 ? std::exp(-1.0 / samples) : 0.0;
+	}
+}
+
+void Compressor::RunningSum::setup(const std::size_t maximumLength)
+{
+	ring.assign(std::max <std::size_t>(maximumLength, 1), 0.0);
+	setLength(length);
+}
+
+void Compressor::RunningSum::setLength(const std::size_t _length)
+{
+	length = std::min(std::max <std::size_t>(_length, 1), ring.size());
+	std::fill(ring.begin(), ring.end(), 0.0);
+	sum = 0.0;
+	fresh = 0.0;
+	index = 0;
+}
+
+void Compressor::setup(const std::size_t numChannels, const double longestLookahead, const std::size_t block)
+{
+	maximumBlock = std::max <std::size_t>(block, 1);
+	maximumLookahead = toSamples(longestLookahead);
+
+	// Room for the look-ahead, the true peak filter's delay and the hold that covers it. The detector
+	// only upsamples, so the audio waits for the upsampling filters, not the round trip.
+	Oversampler probe(TRUE_PEAK_FACTOR, 1);
+	const auto filterDelay = std::size_t(std::ceil(probe.getUpsampleLatency())) + TRUE_PEAK_GUARD;
+	std::size_t capacity = 1;
+	while (capacity < maximumLookahead + filterDelay + 1)
+	{
+		capacity <<= 1;
+	}
+	delayMask = capacity - 1;
+
+	channels.assign(std::max <std::size_t>(numChannels, 1), Channel());
+	for (Channel& channel : channels)
+	{
+		channel.delay.assign(capacity, 0.0);
+		channel.peak.setup(maximumLookahead + 2 + 2 * TRUE_PEAK_GUARD);
+		channel.squares.setup(toSamples(1000.0));
+		channel.average.setup(std::max <std::size_t>(maximumLookahead, 1));
+		channel.oversampler.setup(TRUE_PEAK_FACTOR, maximumBlock);
+		channel.level.assign(maximumBlock, 0.0);
+		channel.gain.assign(maximumBlock, 0.0);
+	}
+	oversampled.assign(maximumBlock * TRUE_PEAK_FACTOR, 0.0);
+	inputPointers.assign(channels.size(), nullptr);
+	sidechainPointers.assign(channels.size(), nullptr);
+	outputPointers.assign(channels.size(), nullptr);
+	configure();
+}
+
+void Compressor::configure()
+{
+	attackCoefficient = smoothing(attackTime);
+	releaseCoefficient = smoothing(releaseTime);
+	if (channels.empty())
+	{
+		return;
+	}
+
+	lookahead = std::min(toSamples(lookaheadTime), maximumLookahead);
+	window = std::max <std::size_t>(toSamples(windowTime), 1);
+
+	const bool truePeak = mode == Mode::TruePeakLimiter;
+	const std::size_t filterDelay = std::size_t(std::ceil(channels.front().oversampler.getUpsampleLatency()));
+	latency = lookahead + (truePeak ? filterDelay + TRUE_PEAK_GUARD : 0);
+	for (Channel& channel : channels)
+	{
+		// A peak between samples shows up to a sample late through the filter, so the hold is one longer,
+		// and it is held over the guard on both sides.
+		channel.peak.setWindow(lookahead + (truePeak ? 2 + 2 * TRUE_PEAK_GUARD : 1));
+		channel.squares.setLength(window);
+		channel.average.setLength(lookahead);
+		channel.oversampler.reset();
+		channel.smoothed = mode == Mode::Compressor ? 0.0 : 1.0;
+	}
+}
+
+void Compressor::reset()
+{
+	for (Channel& channel : channels)
+	{
+		std::fill(channel.delay.begin(), channel.delay.end(), 0.0);
+	}
+	writeIndex = 0;
+	configure();
+}
+
+void Compressor::process(const double* const* inputs, double* const* outputs, std::size_t frames,
+		const double* const* sidechain)
+{
+	if (channels.empty())
+	{
+		return;
+	}
+
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		const std::size_t count = std::min(maximumBlock, frames - done);
+		for (std::size_t c = 0; c < channels.size(); ++c)
+		{
+			inputPointers[c] = inputs[c] + done;
+			outputPointers[c] = outputs[c] + done;
+			sidechainPointers[c] = sidechain != nullptr && sidechain[c] != nullptr ? sidechain[c] + done
+																				   : inputPointers[c];
+		}
+		processBlock(inputPointers.data(), outputPointers.data(), count, sidechainPointers.data());
+		done += count;
+	}
+}
+
+void Compressor::process(double* data, const std::size_t frames)
+{
+	double* const channel[1] = { data };
+	process(channel, channel, frames);
+}
+
+void Compressor::processBlock(const double* const* inputs, double* const* outputs, const std::size_t frames,
+		const double* const* sidechain)
+{
+	const std::size_t count = std::min(frames, maximumBlock);
+	const std::size_t numChannels = channels.size();
+
+	// Level: the peak over the look-ahead, or the RMS over the window.
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		const double* __restrict detect = sidechain != nullptr && sidechain[c] != nullptr ? sidechain[c] : inputs[c];
+		double* __restrict level = channel.level.data();
+
+		if (mode == Mode::TruePeakLimiter)
+		{
+			channel.oversampler.upsample(detect, oversampled.data(), count);
+			const double* __restrict fine = oversampled.data();
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				double peak = 0.0;
+				for (std::size_t k = 0; k < TRUE_PEAK_FACTOR; ++k)
+				{
+					peak = std::max(peak, std::fabs(fine[n * TRUE_PEAK_FACTOR + k]));
+				}
+				level[n] = peak;
+			}
+		}
+		else
+		{
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				level[n] = std::fabs(detect[n]);
+			}
+		}
+
+		if (mode == Mode::Compressor && detector == Detector::RMS)
+		{
+			const double scale = 1.0 / double(channel.squares.length);
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				level[n] = std::sqrt(std::max(channel.squares.push(level[n] * level[n]) * scale, 0.0));
+			}
+		}
+		else
+		{
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				level[n] = channel.peak.push(level[n]);
+			}
+		}
+	}
+
+	// Link: each channel moves towards the loudest.
+	if (numChannels > 1 && link > 0.0)
+	{
+		double* __restrict loudest = oversampled.data();
+		std::copy(channels[0].level.begin(), channels[0].level.begin() + count, loudest);
+		for (std::size_t c = 1; c < numChannels; ++c)
+		{
+			const double* __restrict level = channels[c].level.data();
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				loudest[n] = std::max(loudest[n], level[n]);
+			}
+		}
+		for (std::size_t c = 0; c < numChannels; ++c)
+		{
+			double* __restrict level = channels[c].level.data();
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				level[n] += link * (loudest[n] - level[n]);
+			}
+		}
+	}
+
+	// Gain.
+	const double unity = mode == Mode::Compressor ? makeup : 1.0;
+	double lowest = unity;
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		const double* __restrict level = channel.level.data();
+		double* __restrict gain = channel.gain.data();
+
+		if (mode == Mode::Compressor)
+		{
+			// Soft knee in dB, as selects rather than branches.
+			const double slope = 1.0 / std::max(ratio, 1.0) - 1.0;
+			const double width = std::max(knee, 1e-6);
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				const double over = Decibels::fromAmplitude(level[n]) - threshold;
+				const double inKnee = over + 0.5 * width;
+				const double curve = slope * inKnee * inKnee / (2.0 * width);
+				gain[n] = over + over < -width ? 0.0 : (over + over > width ? slope * over : curve);
+			}
+
+			// Attack while the reduction deepens, release while it recovers.
+			double smoothed = channel.smoothed;
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				const double coefficient = gain[n] < smoothed ? attackCoefficient : releaseCoefficient;
+				smoothed = gain[n] + coefficient * (smoothed - gain[n]);
+				gain[n] = smoothed;
+			}
+			channel.smoothed = smoothed;
+
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				gain[n] = Decibels::toAmplitude(gain[n]) * makeup;
+			}
+		}
+		else
+		{
+			const double ceiling = Decibels::toAmplitude(threshold);
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				gain[n] = std::min(1.0, ceiling / std::max(level[n], Decibels::FLOOR));
+			}
+
+			// Down at once, the hold has already started it early; up with the release.
+			double smoothed = channel.smoothed;
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				smoothed = gain[n] < smoothed ? gain[n] : gain[n] + releaseCoefficient * (smoothed - gain[n]);
+				gain[n] = smoothed;
+			}
+			channel.smoothed = smoothed;
+
+			// Averaged over the look-ahead: every value averaged is at or below the gain the peak needs.
+			if (lookahead > 0)
+			{
+				const double scale = 1.0 / double(lookahead);
+				for (std::size_t n = 0; n < count; ++n)
+				{
+					gain[n] = std::min(channel.average.push(gain[n]) * scale, 1.0);
+				}
+			}
+		}
+
+		for (std::size_t n = 0; n < count; ++n)
+		{
+			lowest = std::min(lowest, gain[n]);
+		}
+	}
+	reduction = Decibels::fromAmplitude(lowest / unity);
+
+	// The delayed audio times the gain.
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		double* __restrict delay = channels[c].delay.data();
+		const double* __restrict gain = channels[c].gain.data();
+		const double* input = inputs[c];
+		double* output = outputs[c];
+		std::size_t write = writeIndex;
+		for (std::size_t n = 0; n < count; ++n)
+		{
+			delay[write] = input[n];
+			output[n] = delay[(write - latency) & delayMask] * gain[n];
+			write = (write + 1) & delayMask;
+		}
+	}
+	writeIndex = (writeIndex + count) & delayMask;
+}
+
+std::size_t Compressor::getNumChannels() const
+{
+	return channels.size();
+}
+
+std::size_t Compressor::getLatency() const
+{
+	return latency;
+}
+
+double Compressor::getGainReduction() const
+{
+	return reduction;
+}
+
+Compressor::Mode Compressor::getMode() const
+{
+	return mode;
+}
+
+Compressor& Compressor::setMode(const Mode _mode)
+{
+	mode = _mode;
+	configure();
+	return *this;
+}
+
+Compressor& Compressor::setDetector(const Detector _detector)
+{
+	detector = _detector;
+	return *this;
+}
+
+Compressor& Compressor::setThreshold(const double decibels)
+{
+	threshold = decibels;
+	return *this;
+}
+
+Compressor& Compressor::setRatio(const double _ratio)
+{
+	ratio = std::max(_ratio, 1.0);
+	return *this;
+}
+
+Compressor& Compressor::setKnee(const double decibels)
+{
+	knee = std::max(decibels, 0.0);
+	return *this;
+}
+
+Compressor& Compressor::setAttack(const double milliseconds)
+{
+	attackTime = milliseconds;
+	attackCoefficient = smoothing(attackTime);
+	return *this;
+}
+
+Compressor& Compressor::setRelease(const double milliseconds)
+{
+	releaseTime = milliseconds;
+	releaseCoefficient = smoothing(releaseTime);
+	return *this;
+}
+
+Compressor& Compressor::setLookahead(const double milliseconds)
+{
+	lookaheadTime = milliseconds;
+	configure();
+	return *this;
+}
+
+Compressor& Compressor::setWindow(const double milliseconds)
+{
+	windowTime = milliseconds;
+	configure();
+	return *this;
+}
+
+Compressor& Compressor::setMakeup(const double decibels)
+{
+	makeup = Decibels::toAmplitude(decibels);
+	return *this;
+}
+
+Compressor& Compressor::setLink(const double amount)
+{
+	link = std::min(std::max(amount, 0.0), 1.0);
+	return *this;
+}
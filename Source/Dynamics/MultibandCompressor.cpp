@@ -0,0 +1,348 @@
+#include "Dynamics/MultibandCompressor.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	constexpr std::size_t BANDS = MultibandCompressor::MAX_BANDS;
+
+	double smoothing(const double milliseconds)
+	{
+		const double samples = milliseconds * 0.001 * Settings::SAMPLE_RATE;
+		return samples > 0.0 ? std::exp(-1.0 / samples) : 0.0;
+	}
+}
+
+MultibandCompressor::MultibandCompressor()
+{
+	threshold.fill(-12.0);
+	ratio.fill(4.0);
+	knee.fill(6.0);
+	floor.fill(-60.0);
+	makeup.fill(0.0);
+	windowCoefficient.fill(smoothing(10.0));
+	attackCoefficient.fill(smoothing(5.0));
+	releaseCoefficient.fill(smoothing(100.0));
+	for (std::size_t band = 0; band < BANDS; ++band)
+	{
+		shape(band, Mode::Compressor);
+	}
+}
+
+void MultibandCompressor::setup(const std::size_t numChannels, const std::size_t block)
+{
+	maximumBlock = std::max <std::size_t>(block, 1);
+	channels.assign(std::max <std::size_t>(numChannels, 1), Channel());
+	for (Channel& channel : channels)
+	{
+		channel.crossover = crossover;
+		channel.bands.assign(maximumBlock * BANDS, 0.0);
+		channel.level.assign(maximumBlock * BANDS, 0.0);
+		channel.gain.assign(maximumBlock * BANDS, 0.0);
+	}
+	loudest.assign(maximumBlock * BANDS, 0.0);
+	inputPointers.assign(channels.size(), nullptr);
+	outputPointers.assign(channels.size(), nullptr);
+	reset();
+}
+
+void MultibandCompressor::reset()
+{
+	crossover.reset();
+	for (Channel& channel : channels)
+	{
+		channel.crossover.reset();
+		channel.detected.fill(0.0);
+		channel.smoothed.fill(0.0);
+	}
+	reduction.fill(0.0);
+}
+
+void MultibandCompressor::process(const double* const* inputs, double* const* outputs, const std::size_t frames)
+{
+	if (channels.empty())
+	{
+		return;
+	}
+
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		const std::size_t count = std::min(maximumBlock, frames - done);
+		for (std::size_t c = 0; c < channels.size(); ++c)
+		{
+			inputPointers[c] = inputs[c] + done;
+			outputPointers[c] = outputs[c] + done;
+		}
+		processBlock(inputPointers.data(), outputPointers.data(), count);
+		done += count;
+	}
+}
+
+void MultibandCompressor::process(double* data, const std::size_t frames)
+{
+	double* const channel[1] = { data };
+	process(channel, channel, frames);
+}
+
+void MultibandCompressor::processBlock(const double* const* inputs, double* const* outputs, const std::size_t frames)
+{
+	const std::size_t numChannels = channels.size();
+	const std::size_t values = frames * BANDS;
+
+	// Split and detect, every band of a frame at once.
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		channel.crossover.process(inputs[c], channel.bands.data(), frames);
+
+		const double* __restrict bands = channel.bands.data();
+		double* __restrict level = channel.level.data();
+		Frame detected = channel.detected;
+		if (detector == Detector::Peak)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				for (std::size_t b = 0; b < BANDS; ++b)
+				{
+					detected[b] = std::max(std::fabs(bands[n * BANDS + b]), windowCoefficient[b] * detected[b]);
+					level[n * BANDS + b] = detected[b];
+				}
+			}
+		}
+		else
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				for (std::size_t b = 0; b < BANDS; ++b)
+				{
+					const double square = bands[n * BANDS + b] * bands[n * BANDS + b];
+					detected[b] = square + windowCoefficient[b] * (detected[b] - square);
+					level[n * BANDS + b] = detected[b];
+				}
+			}
+			for (std::size_t i = 0; i < values; ++i)
+			{
+				level[i] = std::sqrt(std::max(level[i], 0.0));
+			}
+		}
+		channel.detected = detected;
+	}
+
+	// Link: each band of each channel moves towards the loudest channel in that band.
+	if (numChannels > 1 && link > 0.0)
+	{
+		double* __restrict peak = loudest.data();
+		std::copy(channels[0].level.begin(), channels[0].level.begin() + values, peak);
+		for (std::size_t c = 1; c < numChannels; ++c)
+		{
+			const double* __restrict level = channels[c].level.data();
+			for (std::size_t i = 0; i < values; ++i)
+			{
+				peak[i] = std::max(peak[i], level[i]);
+			}
+		}
+		for (std::size_t c = 0; c < numChannels; ++c)
+		{
+			double* __restrict level = channels[c].level.data();
+			for (std::size_t i = 0; i < values; ++i)
+			{
+				level[i] += link * (peak[i] - level[i]);
+			}
+		}
+	}
+
+	Frame lowest{ };
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		const double* __restrict level = channel.level.data();
+		double* __restrict gain = channel.gain.data();
+
+		// Gain computer in dB, as selects rather than branches. An expander is a compressor with the level mirrored about the threshold.
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			for (std::size_t b = 0; b < BANDS; ++b)
+			{
+				const double width = knee[b];
+				const double over = direction[b] * (Decibels::fromAmplitude(level[n * BANDS + b]) - threshold[b]);
+				const double inKnee = over + 0.5 * width;
+				const double curve = inKnee * inKnee / (2.0 * width);
+				const double active = over + over < -width ? 0.0 : (over + over > width ? over : curve);
+				gain[n * BANDS + b] = std::max(slope[b] * active, floor[b]);
+			}
+		}
+
+		// Attack while the reduction deepens, release while it recovers.
+		Frame smoothed = channel.smoothed;
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			for (std::size_t b = 0; b < BANDS; ++b)
+			{
+				const double target = gain[n * BANDS + b];
+				const double coefficient = target < smoothed[b] ? attackCoefficient[b] : releaseCoefficient[b];
+				smoothed[b] = target + coefficient * (smoothed[b] - target);
+				gain[n * BANDS + b] = smoothed[b];
+				lowest[b] = std::min(lowest[b], smoothed[b]);
+			}
+		}
+		channel.smoothed = smoothed;
+
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			for (std::size_t b = 0; b < BANDS; ++b)
+			{
+				gain[n * BANDS + b] = Decibels::toAmplitude(gain[n * BANDS + b] + makeup[b]);
+			}
+		}
+
+		// Back together. Bands past the crossover's count are silent, so they add nothing.
+		const double* __restrict bands = channel.bands.data();
+		double* output = outputs[c];
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			double sum = 0.0;
+			for (std::size_t b = 0; b < BANDS; ++b)
+			{
+				sum += bands[n * BANDS + b] * gain[n * BANDS + b];
+			}
+			output[n] = sum;
+		}
+	}
+	reduction = lowest;
+}
+
+void MultibandCompressor::shape(const std::size_t band, const Mode mode)
+{
+	if (mode == Mode::Compressor)
+	{
+		direction[band] = 1.0;
+		slope[band] = 1.0 / ratio[band] - 1.0;
+	}
+	else
+	{
+		direction[band] = -1.0;
+		slope[band] = 1.0 - ratio[band];
+	}
+}
+
+std::size_t MultibandCompressor::clampBand(const std::size_t band) const
+{
+	return std::min(band, BANDS - 1);
+}
+
+std::size_t MultibandCompressor::getNumChannels() const
+{
+	return channels.size();
+}
+
+std::size_t MultibandCompressor::getNumBands() const
+{
+	return crossover.getNumBands();
+}
+
+double MultibandCompressor::getFrequency(const std::size_t crossover) const
+{
+	return this->crossover.getFrequency(crossover);
+}
+
+double MultibandCompressor::getGainReduction(const std::size_t band) const
+{
+	return reduction[clampBand(band)];
+}
+
+MultibandCompressor::Mode MultibandCompressor::getMode(const std::size_t band) const
+{
+	return direction[clampBand(band)] > 0.0 ? Mode::Compressor : Mode::Expander;
+}
+
+MultibandCompressor& MultibandCompressor::setNumBands(const std::size_t numBands)
+{
+	crossover.setNumBands(numBands);
+	for (Channel& channel : channels)
+	{
+		channel.crossover.setNumBands(numBands);
+	}
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setFrequency(const std::size_t crossover, const double frequency)
+{
+	this->crossover.setFrequency(crossover, frequency);
+	for (Channel& channel : channels)
+	{
+		channel.crossover.setFrequency(crossover, frequency);
+	}
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setDetector(const Detector _detector)
+{
+	detector = _detector;
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setLink(const double amount)
+{
+	link = std::clamp(amount, 0.0, 1.0);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setMode(const std::size_t band, const Mode mode)
+{
+	shape(clampBand(band), mode);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setThreshold(const std::size_t band, const double decibels)
+{
+	threshold[clampBand(band)] = decibels;
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setRatio(const std::size_t band, const double _ratio)
+{
+	const std::size_t b = clampBand(band);
+	ratio[b] = std::max(_ratio, 1.0);
+	shape(b, getMode(b));
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setKnee(const std::size_t band, const double decibels)
+{
+	knee[clampBand(band)] = std::max(decibels, 1e-6);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setRange(const std::size_t band, const double decibels)
+{
+	floor[clampBand(band)] = -std::fabs(decibels);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setMakeup(const std::size_t band, const double decibels)
+{
+	makeup[clampBand(band)] = decibels;
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setAttack(const std::size_t band, const double milliseconds)
+{
+	attackCoefficient[clampBand(band)] = smoothing(milliseconds);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setRelease(const std::size_t band, const double milliseconds)
+{
+	releaseCoefficient[clampBand(band)] = smoothing(milliseconds);
+	return *this;
+}
+
+MultibandCompressor& MultibandCompressor::setWindow(const std::size_t band, const double milliseconds)
+{
+	windowCoefficient[clampBand(band)] = smoothing(milliseconds);
+	return *this;
+}
@@ -0,0 +1,43 @@
+#include "Dynamics/RunningMaximum.hpp"
+
+#include <algorithm>
+
+using namespace Maximilian;
+
+RunningMaximum::RunningMaximum(const std::size_t maximumWindow)
+{
+	setup(maximumWindow);
+}
+
+void RunningMaximum::setup(const std::size_t maximumWindow)
+{
+	// A power of two with room for one value more than the window, the one being pushed.
+	std::size_t capacity = 1;
+	while (capacity < maximumWindow + 1)
+	{
+		capacity <<= 1;
+	}
+	values.assign(capacity, 0.0);
+	times.assign(capacity, 0);
+	mask = capacity - 1;
+	window = std::max <std::size_t>(maximumWindow, 1);
+	reset();
+}
+
+void RunningMaximum::reset()
+{
+	head = 0;
+	tail = 0;
+	now = 0;
+}
+
+std::size_t RunningMaximum::getWindow() const
+{
+	return window;
+}
+
+void RunningMaximum::setWindow(const std::size_t _window)
+{
+	window = std::min(std::max <std::size_t>(_window, 1), mask);
+	reset();
+}
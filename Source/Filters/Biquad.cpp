@@ -0,0 +1,172 @@
+#include "Filters/Biquad.hpp"
+
+#include <cmath>
+
+using namespace Maximilian;
+
+BiquadCoefficients
+BiquadDesigner::design(const Type type, const double frequency, const double q, const double gain,
+		const double sampleRate)
+{
+	const double w0 = 2.0 * M_PI * frequency / sampleRate;
+	const double cosw0 = std::cos(w0);
+	const double alpha = std::sin(w0) / (2.0 * q);
+	const double A = std::pow(10.0, gain / 40.0);
+	const double sqrtA2alpha = 2.0 * std::sqrt(A) * alpha;
+
+	double b0, b1, b2, a0, a1, a2;
+
+	switch (type)
+	{
+	case Type::LowPass:
+		b0 = (1.0 - cosw0) / 2.0;
+		b1 = 1.0 - cosw0;
+		b2 = (1.0 - cosw0) / 2.0;
+		a0 = 1.0 + alpha;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha;
+		break;
+	case Type::HighPass:
+		b0 = (1.0 + cosw0) / 2.0;
+		b1 = -(1.0 + cosw0);
+		b2 = (1.0 + cosw0) / 2.0;
+		a0 = 1.0 + alpha;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha;
+		break;
+	case Type::BandPass:
+		b0 = alpha;
+		b1 = 0.0;
+		b2 = -alpha;
+		a0 = 1.0 + alpha;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha;
+		break;
+	case Type::Notch:
+		b0 = 1.0;
+		b1 = -2.0 * cosw0;
+		b2 = 1.0;
+		a0 = 1.0 + alpha;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha;
+		break;
+	case Type::Peaking:
+		b0 = 1.0 + alpha * A;
+		b1 = -2.0 * cosw0;
+		b2 = 1.0 - alpha * A;
+		a0 = 1.0 + alpha / A;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha / A;
+		break;
+	case Type::LowShelf:
+		b0 = A * ((A + 1.0) - (A - 1.0) * cosw0 + sqrtA2alpha);
+		b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw0);
+		b2 = A * ((A + 1.0) - (A - 1.0) * cosw0 - sqrtA2alpha);
+		a0 = (A + 1.0) + (A - 1.0) * cosw0 + sqrtA2alpha;
+		a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw0);
+		a2 = (A + 1.0) + (A - 1.0) * cosw0 - sqrtA2alpha;
+		break;
+	case Type::HighShelf:
+		b0 = A * ((A + 1.0) + (A - 1.0) * cosw0 + sqrtA2alpha);
+		b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw0);
+		b2 = A * ((A + 1.0) + (A - 1.0) * cosw0 - sqrtA2alpha);
+		a0 = (A + 1.0) - (A - 1.0) * cosw0 + sqrtA2alpha;
+		a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw0);
+		a2 = (A + 1.0) - (A - 1.0) * cosw0 - sqrtA2alpha;
+		break;
+	case Type::AllPass:
+	default:
+		b0 = 1.0 - alpha;
+		b1 = -2.0 * cosw0;
+		b2 = 1.0 + alpha;
+		a0 = 1.0 + alpha;
+		a1 = -2.0 * cosw0;
+		a2 = 1.0 - alpha;
+		break;
+	}
+
+	BiquadCoefficients coefficients;
+	coefficients.b0 = b0 / a0;
+	coefficients.b1 = b1 / a0;
+	coefficients.b2 = b2 / a0;
+	coefficients.a1 = a1 / a0;
+	coefficients.a2 = a2 / a0;
+	return coefficients;
+}
+
+double BiquadDesigner::butterworthQ(const std::size_t order, const std::size_t section)
+{
+	// Poles of the analogue prototype sit at angles (2k + 1) * pi / (2 * order).
+	const double angle = (2.0 * section + 1.0) * M_PI / (2.0 * order);
+	return 1.0 / (2.0 * std::sin(angle));
+}
+
+void Biquad::process(const double* input, double* output, const std::size_t frames)
+{
+	const double b0 = coefficients.b0, b1 = coefficients.b1, b2 = coefficients.b2;
+	const double a1 = coefficients.a1, a2 = coefficients.a2;
+	double z1 = s1, z2 = s2;
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		const double x = input[n];
+		const double y = b0 * x + z1;
+		z1 = b1 * x - a1 * y + z2;
+		z2 = b2 * x - a2 * y;
+		output[n] = y;
+	}
+	s1 = z1;
+	s2 = z2;
+}
+
+void Biquad::process(const double* input, double* output, const std::size_t frames,
+		const BiquadCoefficients& target)
+{
+	if (frames == 0 || target == coefficients)
+	{
+		coefficients = target;
+		process(input, output, frames);
+		return;
+	}
+
+	const double step = 1.0 / frames;
+	const double db0 = (target.b0 - coefficients.b0) * step;
+	const double db1 = (target.b1 - coefficients.b1) * step;
+	const double db2 = (target.b2 - coefficients.b2) * step;
+	const double da1 = (target.a1 - coefficients.a1) * step;
+	const double da2 = (target.a2 - coefficients.a2) * step;
+	double b0 = coefficients.b0, b1 = coefficients.b1, b2 = coefficients.b2;
+	double a1 = coefficients.a1, a2 = coefficients.a2;
+	double z1 = s1, z2 = s2;
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		b0 += db0;
+		b1 += db1;
+		b2 += db2;
+		a1 += da1;
+		a2 += da2;
+		const double x = input[n];
+		const double y = b0 * x + z1;
+		z1 = b1 * x - a1 * y + z2;
+		z2 = b2 * x - a2 * y;
+		output[n] = y;
+	}
+	s1 = z1;
+	s2 = z2;
+	coefficients = target;
+}
+
+void Biquad::reset()
+{
+	s1 = 0.0;
+	s2 = 0.0;
+}
+
+const BiquadCoefficients& Biquad::getCoefficients() const
+{
+	return coefficients;
+}
+
+void Biquad::setCoefficients(const BiquadCoefficients& _coefficients)
+{
+	coefficients = _coefficients;
+}
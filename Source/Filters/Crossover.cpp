@@ -0,0 +1,107 @@
+#include "Filters/Crossover.hpp"
+
+#include <algorithm>
+
+using namespace Maximilian;
+
+Crossover::Crossover()
+{
+	design();
+}
+
+Crossover::Crossover(const std::size_t numBands)
+{
+	setNumBands(numBands);
+}
+
+void Crossover::design()
+{
+	using Type = BiquadDesigner::Type;
+
+	const BiquadCoefficients through;
+	BiquadCoefficients silent;
+	silent.b0 = 0.0;
+
+	for (std::size_t stage = 0; stage < STAGES; ++stage)
+	{
+		for (std::size_t band = 0; band < MAX_BANDS; ++band)
+		{
+			const std::size_t crossover = stage / 2;
+			BiquadCoefficients section = through;
+			if (band >= bands)
+			{
+				section = stage == 0 ? silent : through;
+			}
+			else if (crossover + 1 < bands)
+			{
+				const double frequency = frequencies[crossover];
+				if (crossover < band)
+				{
+					section = BiquadDesigner::design(Type::HighPass, frequency);
+				}
+				else if (crossover == band)
+				{
+					section = BiquadDesigner::design(Type::LowPass, frequency);
+				}
+				else if (stage % 2 == 0)
+				{
+					// What the low and high pass of that crossover add up to.
+					section = BiquadDesigner::design(Type::AllPass, frequency);
+				}
+			}
+
+			Lanes& k = coefficients[stage];
+			k.b0[band] = section.b0;
+			k.b1[band] = section.b1;
+			k.b2[band] = section.b2;
+			k.a1[band] = section.a1;
+			k.a2[band] = section.a2;
+		}
+	}
+}
+
+void Crossover::process(const double* input, double* output, const std::size_t frames)
+{
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		Frame split;
+		play(input[n], split);
+		std::copy(split.begin(), split.end(), output + n * MAX_BANDS);
+	}
+}
+
+void Crossover::reset()
+{
+	for (std::size_t stage = 0; stage < STAGES; ++stage)
+	{
+		s1[stage].fill(0.0);
+		s2[stage].fill(0.0);
+	}
+}
+
+std::size_t Crossover::getNumBands() const
+{
+	return bands;
+}
+
+double Crossover::getFrequency(const std::size_t crossover) const
+{
+	return frequencies[std::min(crossover, MAX_BANDS - 2)];
+}
+
+void Crossover::setNumBands(const std::size_t numBands)
+{
+	bands = std::clamp <std::size_t>(numBands, 2, MAX_BANDS);
+	design();
+	reset();
+}
+
+void Crossover::setFrequency(const std::size_t crossover, const double frequency)
+{
+	if (crossover >= MAX_BANDS - 1)
+	{
+		return;
+	}
+	frequencies[crossover] = std::clamp(frequency, 10.0, 0.45 * Settings::SAMPLE_RATE);
+	design();
+}
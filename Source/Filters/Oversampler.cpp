@@ -0,0 +1,238 @@
+#include "Filters/Oversampler.hpp"
+#include "Spectral/Window.hpp"
+
+#include <cmath>
+#include <cassert>
+
+using namespace Maximilian;
+
+namespace
+{
+	// Kaiser beta for about 100 dB of stop band attenuation.
+	constexpr double KAISER_BETA = 10.06;
+}
+
+HalfBand::HalfBand(const std::size_t taps)
+{
+	setup(taps);
+}
+
+void HalfBand::setup(const std::size_t taps)
+{
+	assert(taps >= 2 && taps % 2 == 0);
+
+	// 2 * taps - 1 coefficients with the centre at taps - 1; the side ones sit at
+	// odd distances from it, the even indices of the full kernel.
+	const std::size_t length = 2 * taps - 1;
+	const double centre = double(taps - 1);
+
+	std::vector <double> window(length);
+	Window::fillKaiser(window.data(), length, KAISER_BETA);
+
+	kernel.resize(taps);
+	double sum = 0.0;
+	for (std::size_t j = 0; j < taps; ++j)
+	{
+		const double distance = double(2 * j) - centre;
+		kernel[j] = std::sin(M_PI * distance / 2.0) / (M_PI * distance) * window[2 * j];
+		sum += kernel[j];
+	}
+
+	// The side taps sum to 1/2 so that, with the centre tap, the DC gain is exactly one.
+	for (double& coefficient : kernel)
+	{
+		coefficient *= 0.5 / sum;
+	}
+
+	history.assign(2 * taps, 0.0);
+	delayed.assign(2 * taps, 0.0);
+	position = 0;
+}
+
+inline void HalfBand::push(std::vector <double>& line, const double sample)
+{
+	line[position] = sample;
+	line[position + kernel.size()] = sample;
+}
+
+inline double HalfBand::convolve() const
+{
+	const double* window = history.data() + position;
+	double sum = 0.0;
+	for (std::size_t j = 0; j < kernel.size(); ++j)
+	{
+		sum += kernel[j] * window[j];
+	}
+	return sum;
+}
+
+void HalfBand::upsample(const double* input, double* output, const std::size_t frames)
+{
+	const std::size_t taps = kernel.size();
+	const std::size_t delay = (taps - 2) / 2;
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		position = position == 0 ? taps - 1 : position - 1;
+		push(history, input[n]);
+		output[2 * n] = 2.0 * convolve();
+		output[2 * n + 1] = history[position + delay];
+	}
+}
+
+void HalfBand::downsample(const double* input, double* output, const std::size_t frames)
+{
+	const std::size_t taps = kernel.size();
+	const std::size_t delay = taps / 2 - 1;
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		// The odd samples only pass the centre tap, taps / 2 input pairs late.
+		const double centre = delayed[position + delay];
+		position = position == 0 ? taps - 1 : position - 1;
+		push(history, input[2 * n]);
+		push(delayed, input[2 * n + 1]);
+		output[n] = convolve() + 0.5 * centre;
+	}
+}
+
+void HalfBand::reset()
+{
+	std::fill(history.begin(), history.end(), 0.0);
+	std::fill(delayed.begin(), delayed.end(), 0.0);
+	position = 0;
+}
+
+std::size_t HalfBand::getTaps() const
+{
+	return kernel.size();
+}
+
+std::size_t HalfBand::getLatency() const
+{
+	return kernel.size() - 1;
+}
+
+Oversampler::Oversampler(const std::size_t _factor, const std::size_t _maximumBlock)
+{
+	setup(_factor, _maximumBlock);
+}
+
+void Oversampler::setup(const std::size_t _factor, const std::size_t _maximumBlock)
+{
+	assert(_factor == 1 || _factor == 2 || _factor == 4 || _factor == 8);
+
+	factor = _factor;
+	maximumBlock = std::max <std::size_t>(_maximumBlock, 1);
+
+	stages.clear();
+	for (std::size_t rate = 1, stage = 0; rate < factor; rate *= 2, ++stage)
+	{
+		stages.push_back({ HalfBand(STAGE_TAPS[stage]), HalfBand(STAGE_TAPS[stage]) });
+	}
+
+	front.assign(maximumBlock * factor, 0.0);
+	back.assign(maximumBlock * factor, 0.0);
+}
+
+double* Oversampler::up(const double* input, const std::size_t frames)
+{
+	if (stages.empty())
+	{
+		std::copy(input, input + frames, front.data());
+		return front.data();
+	}
+
+	const double* source = input;
+	double* target = front.data();
+	std::size_t count = frames;
+	for (Stage& stage : stages)
+	{
+		stage.up.upsample(source, target, count);
+		source = target;
+		target = target == front.data() ? back.data() : front.data();
+		count *= 2;
+	}
+	// The last stage wrote the buffer 'target' no longer points at.
+	return target == front.data() ? back.data() : front.data();
+}
+
+void Oversampler::down(double* data, double* output, const std::size_t frames)
+{
+	double* source = data;
+	std::size_t count = frames * factor;
+	for (std::size_t s = stages.size(); s-- > 0;)
+	{
+		count /= 2;
+		double* target = s == 0 ? output : source == front.data() ? back.data() : front.data();
+		stages[s].down.downsample(source, target, count);
+		source = target;
+	}
+	if (stages.empty())
+	{
+		std::copy(data, data + frames, output);
+	}
+}
+
+void Oversampler::upsample(const double* input, double* output, std::size_t frames)
+{
+	while (frames > 0)
+	{
+		const std::size_t chunk = std::min(frames, maximumBlock);
+		const double* data = up(input, chunk);
+		std::copy(data, data + chunk * factor, output);
+		input += chunk;
+		output += chunk * factor;
+		frames -= chunk;
+	}
+}
+
+void Oversampler::downsample(const double* input, double* output, std::size_t frames)
+{
+	while (frames > 0)
+	{
+		const std::size_t chunk = std::min(frames, maximumBlock);
+		std::copy(input, input + chunk * factor, front.data());
+		down(front.data(), output, chunk);
+		input += chunk * factor;
+		output += chunk;
+		frames -= chunk;
+	}
+}
+
+void Oversampler::reset()
+{
+	for (Stage& stage : stages)
+	{
+		stage.up.reset();
+		stage.down.reset();
+	}
+}
+
+std::size_t Oversampler::getFactor() const
+{
+	return factor;
+}
+
+double Oversampler::getLatency() const
+{
+	// Each stage delays by its filter's latency twice, once each way, at twice its input rate.
+	double latency = 0.0;
+	double rate = 1.0;
+	for (const Stage& stage : stages)
+	{
+		latency += double(stage.up.getLatency() + stage.down.getLatency()) / (2.0 * rate);
+		rate *= 2.0;
+	}
+	return latency;
+}
+
+double Oversampler::getUpsampleLatency() const
+{
+	double latency = 0.0;
+	double rate = 1.0;
+	for (const Stage& stage : stages)
+	{
+		latency += double(stage.up.getLatency()) / (2.0 * rate);
+		rate *= 2.0;
+	}
+	return latency;
+}
@@ -0,0 +1,91 @@
+#include "Filters/SincInterpolator.hpp"
+#include "Spectral/Window.hpp"
+
+using namespace Maximilian;
+
+namespace
+{
+	struct Design
+	{
+		std::size_t taps;
+		double beta;
+		// Cutoff as a fraction of Nyquist, leaving room for the transition band.
+		double rolloff;
+	};
+
+	constexpr Design DESIGNS[] = {
+			{ 8,  5.0,  0.80 },
+			{ 16, 7.0,  0.90 },
+			{ 32, 9.0,  0.94 },
+			{ 64, 11.0, 0.97 }
+	};
+}
+
+SincInterpolator::SincInterpolator(const Quality quality)
+{
+	const Design& design = DESIGNS[static_cast<std::size_t>(quality)];
+	taps = design.taps;
+
+	// kernel[i] is the windowed sinc at i / PHASES samples from the centre, out to taps / 2.
+	const double half = double(taps / 2);
+	kernel.resize(taps / 2 * PHASES + 2);
+	const double normal = 1.0 / Window::besselI0(design.beta);
+	for (std::size_t i = 0; i < kernel.size(); ++i)
+	{
+		const double t = double(i) / double(PHASES);
+		if (t >= half)
+		{
+			kernel[i] = 0.0;
+			continue;
+		}
+		const double x = M_PI * design.rolloff * t;
+		const double sinc = i == 0 ? 1.0 : std::sin(x) / x;
+		const double ratio = t / half;
+		kernel[i] = design.rolloff * sinc * Window::besselI0(design.beta * std::sqrt(1.0 - ratio * ratio)) * normal;
+	}
+
+	// Row r holds the coefficients for a fraction of r / PHASES, each row normalised to unity
+	// gain at DC so the interpolation has no ripple between phases.
+	rows.resize((PHASES + 1) * taps);
+	for (std::size_t r = 0; r <= PHASES; ++r)
+	{
+		double* row = rows.data() + r * taps;
+		double sum = 0.0;
+		for (std::size_t j = 0; j < taps; ++j)
+		{
+			const double at = std::fabs(double(j) - half + 1.0 - double(r) / double(PHASES)) * double(PHASES);
+			const std::size_t point = std::size_t(at);
+			row[j] = point + 1 < kernel.size()
+					 ? kernel[point] + (at - double(point)) * (kernel[point + 1] - kernel[point])
+					 : 0.0;
+			sum += row[j];
+		}
+		for (std::size_t j = 0; j < taps; ++j)
+		{
+			row[j] /= sum;
+		}
+	}
+
+	steps.assign(rows.size(), 0.0);
+	for (std::size_t i = 0; i < PHASES * taps; ++i)
+	{
+		steps[i] = rows[i + taps] - rows[i];
+	}
+}
+
+const SincInterpolator& SincInterpolator::get(const Quality quality)
+{
+	// All qualities are built on the first call and kept for the life of the program.
+	static const SincInterpolator* interpolators[] = {
+			new SincInterpolator(Quality::Low),
+			new SincInterpolator(Quality::Medium),
+			new SincInterpolator(Quality::High),
+			new SincInterpolator(Quality::Best)
+	};
+	return *interpolators[static_cast<std::size_t>(quality)];
+}
+
+std::size_t SincInterpolator::getTaps() const
+{
+	return taps;
+}
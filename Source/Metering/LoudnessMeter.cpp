@@ -0,0 +1,502 @@
+#include "Metering/LoudnessMeter.hpp"
+#include "Samples/WavFile.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	// Frames read and metered at a time by measure().
+	constexpr std::size_t CHUNK = 4096;
+
+	// Shortest part of a programme worth a thread of its own, in 100 ms steps.
+	constexpr std::uint64_t MINIMUM_SEGMENT = 300;
+
+	// Audio run through the filters before a segment's own pre-roll, in 100 ms steps.
+	constexpr std::uint64_t WARM_UP = 10;
+
+	/**
+	 * The two stages of the K-weighting, designed for any rate from the
+	 * analogue prototypes behind the 48 kHz coefficients of BS.1770: a high
+	 * shelf of about +4 dB modelling the head, then a high pass.
+	 */
+	BiquadCoefficients shelf(const double rate)
+	{
+		const double frequency = 1681.974450955533;
+		const double gain = 3.999843853973347;
+		const double q = 0.7071752369554196;
+
+		const double k = std::tan(M_PI * frequency / rate);
+		const double vh = std::pow(10.0, gain / 20.0);
+		const double vb = std::pow(vh, 0.4996667741545416);
+		const double a0 = 1.0 + k / q + k * k;
+
+		BiquadCoefficients coefficients;
+		coefficients.b0 = (vh + vb * k / q + k * k) / a0;
+		coefficients.b1 = 2.0 * (k * k - vh) / a0;
+		coefficients.b2 = (vh - vb * k / q + k * k) / a0;
+		coefficients.a1 = 2.0 * (k * k - 1.0) / a0;
+		coefficients.a2 = (1.0 - k / q + k * k) / a0;
+		return coefficients;
+	}
+
+	BiquadCoefficients highPass(const double rate)
+	{
+		const double frequency = 38.13547087602444;
+		const double q = 0.5003270373238773;
+
+		const double k = std::tan(M_PI * frequency / rate);
+		const double a0 = 1.0 + k / q + k * k;
+
+		BiquadCoefficients coefficients;
+		coefficients.b0 = 1.0;
+		coefficients.b1 = -2.0;
+		coefficients.b2 = 1.0;
+		coefficients.a1 = 2.0 * (k * k - 1.0) / a0;
+		coefficients.a2 = (1.0 - k / q + k * k) / a0;
+		return coefficients;
+	}
+}
+
+double LoudnessMeter::toLoudness(const double energy)
+{
+	return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : SILENCE;
+}
+
+void LoudnessMeter::Histogram::setup()
+{
+	counts.assign(BINS, 0);
+	energies.assign(BINS, 0.0);
+	clear();
+}
+
+void LoudnessMeter::Histogram::clear()
+{
+	std::fill(counts.begin(), counts.end(), 0);
+	std::fill(energies.begin(), energies.end(), 0.0);
+	total = 0;
+	energy = 0.0;
+}
+
+void LoudnessMeter::Histogram::add(const double blockEnergy)
+{
+	const double loudness = toLoudness(blockEnergy);
+	if (!(loudness > GATE))
+	{
+		return;
+	}
+	const auto bin = std::min(std::size_t((loudness - GATE) / BIN_WIDTH), BINS - 1);
+	++counts[bin];
+	energies[bin] += blockEnergy;
+	++total;
+	energy += blockEnergy;
+}
+
+void LoudnessMeter::Histogram::merge(const Histogram& other)
+{
+	for (std::size_t bin = 0; bin < BINS; ++bin)
+	{
+		counts[bin] += other.counts[bin];
+		energies[bin] += other.energies[bin];
+	}
+	total += other.total;
+	energy += other.energy;
+}
+
+std::size_t LoudnessMeter::Histogram::firstAbove(const double offset) const
+{
+	// A bin is in when its centre is above the relative gate.
+	const double gate = toLoudness(energy / double(total)) - offset;
+	const double first = std::ceil((gate - GATE) / BIN_WIDTH - 0.5);
+	return first <= 0.0 ? 0 : std::min(std::size_t(first), BINS);
+}
+
+double LoudnessMeter::Histogram::gated(const double offset) const
+{
+	if (total == 0)
+	{
+		return 0.0;
+	}
+	std::uint64_t count = 0;
+	double sum = 0.0;
+	for (std::size_t bin = firstAbove(offset); bin < BINS; ++bin)
+	{
+		count += counts[bin];
+		sum += energies[bin];
+	}
+	return count > 0 ? sum / double(count) : 0.0;
+}
+
+double LoudnessMeter::Histogram::range(const double offset, const double low, const double high) const
+{
+	if (total == 0)
+	{
+		return 0.0;
+	}
+	const std::size_t first = firstAbove(offset);
+	std::uint64_t count = 0;
+	for (std::size_t bin = first; bin < BINS; ++bin)
+	{
+		count += counts[bin];
+	}
+	if (count == 0)
+	{
+		return 0.0;
+	}
+
+	// The values at the two percentiles of the sorted blocks, as bin centres.
+	const auto lowIndex = std::uint64_t(std::llround(double(count - 1) * low));
+	const auto highIndex = std::uint64_t(std::llround(double(count - 1) * high));
+	double lowLoudness = 0.0;
+	double highLoudness = 0.0;
+	std::uint64_t seen = 0;
+	for (std::size_t bin = first; bin < BINS; ++bin)
+	{
+		const std::uint64_t before = seen;
+		seen += counts[bin];
+		const double centre = GATE + (double(bin) + 0.5) * BIN_WIDTH;
+		if (before <= lowIndex && lowIndex < seen)
+		{
+			lowLoudness = centre;
+		}
+		if (before <= highIndex && highIndex < seen)
+		{
+			highLoudness = centre;
+			break;
+		}
+	}
+	return highLoudness - lowLoudness;
+}
+
+void LoudnessMeter::setup(const std::size_t numChannels, const double rate, const std::size_t block)
+{
+	sampleRate = rate > 0.0 ? rate : Settings::SAMPLE_RATE;
+	maximumBlock = std::max <std::size_t>(block, 1);
+	step = std::max <std::size_t>(std::size_t(std::llround(sampleRate * 0.1)), 1);
+
+	channels.assign(numChannels, Channel());
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		channel.shelf.setCoefficients(shelf(sampleRate));
+		channel.highPass.setCoefficients(highPass(sampleRate));
+		channel.oversampler.setup(TRUE_PEAK_FACTOR, maximumBlock);
+		if (numChannels == 5 && c >= 3)
+		{
+			channel.weight = 1.41;
+		}
+		else if (numChannels == 6 && c >= 3)
+		{
+			channel.weight = c == 3 ? 0.0 : 1.41;
+		}
+	}
+	filtered.assign(maximumBlock, 0.0);
+	oversampled.assign(maximumBlock * TRUE_PEAK_FACTOR, 0.0);
+	blocks.setup();
+	shortTerms.setup();
+	reset();
+}
+
+void LoudnessMeter::reset()
+{
+	for (Channel& channel : channels)
+	{
+		channel.shelf.reset();
+		channel.highPass.reset();
+		channel.oversampler.reset();
+	}
+	position = 0;
+	accumulated = 0.0;
+	steps.fill(0.0);
+	stepIndex = 0;
+	stepsDone = 0;
+	momentary = 0.0;
+	shortTerm = 0.0;
+	peak = 0.0;
+	clearGating();
+}
+
+void LoudnessMeter::clearGating()
+{
+	momentaryMaximum = 0.0;
+	shortTermMaximum = 0.0;
+	blocks.clear();
+	shortTerms.clear();
+}
+
+void LoudnessMeter::process(const double* const* inputs, const std::size_t frames)
+{
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		// Never across the end of a 100 ms step.
+		const std::size_t count = std::min({ maximumBlock, frames - done, step - position });
+		double energy = 0.0;
+		for (std::size_t c = 0; c < channels.size(); ++c)
+		{
+			Channel& channel = channels[c];
+			const double* input = inputs[c] + done;
+
+			double* __restrict weighted = filtered.data();
+			channel.shelf.process(input, weighted, count);
+			channel.highPass.process(weighted, weighted, count);
+			double sum = 0.0;
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				sum += weighted[n] * weighted[n];
+			}
+			energy += channel.weight * sum;
+
+			double highest = 0.0;
+			if (truePeak)
+			{
+				channel.oversampler.upsample(input, oversampled.data(), count);
+				const double* __restrict fine = oversampled.data();
+				for (std::size_t n = 0; n < count * TRUE_PEAK_FACTOR; ++n)
+				{
+					highest = std::max(highest, std::fabs(fine[n]));
+				}
+			}
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				highest = std::max(highest, std::fabs(input[n]));
+			}
+			peak = std::max(peak, highest);
+		}
+
+		accumulated += energy;
+		position += count;
+		done += count;
+		if (position == step)
+		{
+			completeStep();
+		}
+	}
+}
+
+void LoudnessMeter::completeStep()
+{
+	steps[stepIndex] = accumulated / double(step);
+	stepIndex = (stepIndex + 1) % SHORT_TERM_STEPS;
+	++stepsDone;
+	accumulated = 0.0;
+	position = 0;
+
+	// Summed afresh every step, so nothing drifts.
+	double sum = 0.0;
+	for (std::size_t i = 1; i <= SHORT_TERM_STEPS; ++i)
+	{
+		sum += steps[(stepIndex + SHORT_TERM_STEPS - i) % SHORT_TERM_STEPS];
+		if (i == MOMENTARY_STEPS && stepsDone >= MOMENTARY_STEPS)
+		{
+			momentary = sum / double(MOMENTARY_STEPS);
+			momentaryMaximum = std::max(momentaryMaximum, momentary);
+			blocks.add(momentary);
+		}
+	}
+	if (stepsDone >= SHORT_TERM_STEPS)
+	{
+		shortTerm = sum / double(SHORT_TERM_STEPS);
+		shortTermMaximum = std::max(shortTermMaximum, shortTerm);
+		shortTerms.add(shortTerm);
+	}
+}
+
+void LoudnessMeter::flushPeak()
+{
+	if (!truePeak)
+	{
+		return;
+	}
+	std::fill(filtered.begin(), filtered.end(), 0.0);
+	for (Channel& channel : channels)
+	{
+		const std::size_t count = std::min(maximumBlock, std::size_t(std::ceil(channel.oversampler.getLatency())) + 1);
+		channel.oversampler.upsample(filtered.data(), oversampled.data(), count);
+		for (std::size_t n = 0; n < count * TRUE_PEAK_FACTOR; ++n)
+		{
+			peak = std::max(peak, std::fabs(oversampled[n]));
+		}
+	}
+}
+
+void LoudnessMeter::merge(const LoudnessMeter& other)
+{
+	blocks.merge(other.blocks);
+	shortTerms.merge(other.shortTerms);
+	momentaryMaximum = std::max(momentaryMaximum, other.momentaryMaximum);
+	shortTermMaximum = std::max(shortTermMaximum, other.shortTermMaximum);
+	peak = std::max(peak, other.peak);
+}
+
+template <typename Reader>
+LoudnessMeter::Measurement LoudnessMeter::measure(const std::size_t numChannels, const double rate,
+		const std::uint64_t frames, const std::size_t threads, const Reader& read)
+{
+	LoudnessMeter total;
+	total.setup(numChannels, rate, CHUNK);
+	if (numChannels == 0 || frames == 0)
+	{
+		return total.getMeasurement();
+	}
+
+	// Segments start on a step, so each thread's steps are the ones a single pass would make.
+	const std::uint64_t step = total.step;
+	const std::uint64_t whole = frames / step;
+	const std::uint64_t wanted = threads > 0 ? threads : std::max(1U, std::thread::hardware_concurrency());
+	const std::uint64_t count = std::max <std::uint64_t>(1, std::min(wanted, whole / MINIMUM_SEGMENT));
+
+	std::vector <LoudnessMeter> meters(count);
+	std::vector <std::thread> workers;
+	for (std::uint64_t k = 0; k < count; ++k)
+	{
+		const std::uint64_t from = whole * k / count * step;
+		const std::uint64_t to = k + 1 == count ? frames : whole * (k + 1) / count * step;
+		const bool last = k + 1 == count;
+		workers.emplace_back([&, k, from, to, last]()
+		{
+			LoudnessMeter& meter = meters[k];
+			meter.setup(numChannels, rate, CHUNK);
+
+			std::vector <std::vector <double>> buffers(numChannels, std::vector <double>(CHUNK));
+			std::vector <const double*> pointers(numChannels);
+			for (std::size_t c = 0; c < numChannels; ++c)
+			{
+				pointers[c] = buffers[c].data();
+			}
+			const auto feed = [&](std::uint64_t start, const std::uint64_t end)
+			{
+				while (start < end)
+				{
+					const auto length = std::size_t(std::min <std::uint64_t>(CHUNK, end - start));
+					for (std::size_t c = 0; c < numChannels; ++c)
+					{
+						read(c, start, length, buffers[c].data());
+					}
+					meter.process(pointers.data(), length);
+					start += length;
+				}
+			};
+
+			// Settle the filters, then fill the 3 s window with the audio before the segment, counting neither.
+			const std::uint64_t context = std::min(from, SHORT_TERM_STEPS * step);
+			const std::uint64_t warmUp = std::min(from - context, WARM_UP * step);
+			feed(from - context - warmUp, from - context);
+			meter.peak = 0.0;
+			feed(from - context, from);
+			meter.clearGating();
+			feed(from, to);
+			if (last)
+			{
+				meter.flushPeak();
+			}
+		});
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	for (const LoudnessMeter& meter : meters)
+	{
+		total.merge(meter);
+	}
+	return total.getMeasurement();
+}
+
+LoudnessMeter::Measurement LoudnessMeter::measure(const SampleData& data, const std::size_t threads)
+{
+	const SampleBuffer& buffer = data.buffer;
+	return measure(buffer.getNumChannels(), double(data.sampleRate), buffer.getNumFrames(), threads,
+			[&buffer](const std::size_t channel, const std::uint64_t start, const std::size_t count, double* output)
+			{
+				buffer.read(channel, std::size_t(start), count, output);
+			});
+}
+
+bool LoudnessMeter::measure(const std::string& fileName, Measurement& result, const std::size_t threads)
+{
+	WavFile wav(fileName);
+	if (!wav.isOpen())
+	{
+		printf("ERROR: Could not measure %s: %s\n", fileName.c_str(), wav.getError().c_str());
+		return false;
+	}
+	wav.advise(WavFile::Access::Sequential);
+	result = measure(wav.getNumChannels(), double(wav.getSampleRate()), wav.getNumFrames(), threads,
+			[&wav](const std::size_t channel, const std::uint64_t start, const std::size_t count, double* output)
+			{
+				thread_local std::vector <float> decoded;
+				decoded.resize(count);
+				wav.read(channel, start, count, decoded.data());
+				std::copy(decoded.begin(), decoded.end(), output);
+			});
+	return true;
+}
+
+std::size_t LoudnessMeter::getNumChannels() const
+{
+	return channels.size();
+}
+
+double LoudnessMeter::getMomentary() const
+{
+	return toLoudness(momentary);
+}
+
+double LoudnessMeter::getShortTerm() const
+{
+	return toLoudness(shortTerm);
+}
+
+double LoudnessMeter::getMomentaryMaximum() const
+{
+	return toLoudness(momentaryMaximum);
+}
+
+double LoudnessMeter::getShortTermMaximum() const
+{
+	return toLoudness(shortTermMaximum);
+}
+
+double LoudnessMeter::getIntegrated() const
+{
+	return toLoudness(blocks.gated(10.0));
+}
+
+double LoudnessMeter::getLoudnessRange() const
+{
+	return shortTerms.range(20.0, 0.10, 0.95);
+}
+
+double LoudnessMeter::getTruePeak() const
+{
+	return peak > 0.0 ? 20.0 * std::log10(peak) : SILENCE;
+}
+
+LoudnessMeter::Measurement LoudnessMeter::getMeasurement() const
+{
+	Measurement measurement;
+	measurement.integrated = getIntegrated();
+	measurement.range = getLoudnessRange();
+	measurement.momentaryMaximum = getMomentaryMaximum();
+	measurement.shortTermMaximum = getShortTermMaximum();
+	measurement.truePeak = getTruePeak();
+	return measurement;
+}
+
+void LoudnessMeter::setWeight(const std::size_t channel, const double weight)
+{
+	if (channel < channels.size())
+	{
+		channels[channel].weight = std::max(weight, 0.0);
+	}
+}
+
+void LoudnessMeter::setTruePeak(const bool enabled)
+{
+	truePeak = enabled;
+}
@@ -0,0 +1,229 @@
+#include "Metering/MeterBank.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	// The per-sample factor that takes a value to 1 % over 'milliseconds', as maxiEnvelopeFollower does.
+	double follower(const double milliseconds)
+	{
+		const double samples = milliseconds * 0.001 * Settings::SAMPLE_RATE;
+		return samples > 0.0 ? std::pow(0.01, 1.0 / samples) : 0.0;
+	}
+}
+
+MeterBank::MeterBank()
+{
+	setPeakDecay(peakRate);
+	setWindow(windowTime);
+	setAttack(100.0);
+	setRelease(100.0);
+}
+
+void MeterBank::setup(const std::size_t numChannels, const std::size_t block)
+{
+	maximumBlock = std::max <std::size_t>(block, 1);
+	channels.assign(numChannels, Channel());
+	for (Channel& channel : channels)
+	{
+		channel.oversampler.setup(TRUE_PEAK_FACTOR, maximumBlock);
+	}
+	envelopes.assign((numChannels + LANES - 1) / LANES, Lanes{ });
+	scratch.assign(maximumBlock * std::max(LANES, TRUE_PEAK_FACTOR), 0.0);
+
+	Snapshot empty;
+	empty.readings.assign(numChannels, Reading());
+	published.fill(empty);
+	frame = 0;
+	reset();
+}
+
+void MeterBank::reset()
+{
+	for (Channel& channel : channels)
+	{
+		channel.oversampler.reset();
+		channel.peak = 0.0;
+		channel.truePeak = 0.0;
+		channel.maximum = 0.0;
+		channel.energy = 0.0;
+		channel.product = 0.0;
+	}
+	for (Lanes& envelope : envelopes)
+	{
+		envelope.fill(0.0);
+	}
+	weight = 0.0;
+}
+
+void MeterBank::process(const double* const* inputs, const std::size_t frames)
+{
+	if (channels.empty())
+	{
+		return;
+	}
+
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		const std::size_t count = std::min(maximumBlock, frames - done);
+		processBlock(inputs, done, count);
+		done += count;
+	}
+	frame += frames;
+	publish();
+}
+
+void MeterBank::processBlock(const double* const* inputs, const std::size_t offset, const std::size_t frames)
+{
+	const std::size_t numChannels = channels.size();
+	const double fall = std::pow(peakDecay, double(frames));
+	const double decay = std::pow(windowDecay, double(frames));
+	weight = decay * weight + double(frames);
+
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		Channel& channel = channels[c];
+		const double* __restrict input = inputs[c] + offset;
+
+		double peak = 0.0;
+		double energy = 0.0;
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			peak = std::max(peak, std::fabs(input[n]));
+			energy += input[n] * input[n];
+		}
+		channel.peak = std::max(peak, channel.peak * fall);
+		channel.energy = decay * channel.energy + energy;
+
+		if (truePeak)
+		{
+			channel.oversampler.upsample(input, scratch.data(), frames);
+			const double* __restrict fine = scratch.data();
+			for (std::size_t n = 0; n < frames * TRUE_PEAK_FACTOR; ++n)
+			{
+				peak = std::max(peak, std::fabs(fine[n]));
+			}
+			channel.truePeak = std::max(peak, channel.truePeak * fall);
+		}
+		channel.maximum = std::max(channel.maximum, peak);
+
+		// The pair's sum of products lives with its first channel.
+		if (c % 2 == 1)
+		{
+			const double* __restrict left = inputs[c - 1] + offset;
+			double product = 0.0;
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				product += left[n] * input[n];
+			}
+			channels[c - 1].product = decay * channels[c - 1].product + product;
+		}
+	}
+
+	// Envelope followers, LANES channels side by side; missing channels of the last group read silence.
+	for (std::size_t group = 0; group < envelopes.size(); ++group)
+	{
+		const std::size_t first = group * LANES;
+		const std::size_t width = std::min(LANES, numChannels - first);
+		double* __restrict block = scratch.data();
+		for (std::size_t lane = 0; lane < LANES; ++lane)
+		{
+			if (lane < width)
+			{
+				const double* input = inputs[first + lane] + offset;
+				for (std::size_t n = 0; n < frames; ++n)
+				{
+					block[n * LANES + lane] = std::fabs(input[n]);
+				}
+			}
+			else
+			{
+				for (std::size_t n = 0; n < frames; ++n)
+				{
+					block[n * LANES + lane] = 0.0;
+				}
+			}
+		}
+
+		Lanes envelope = envelopes[group];
+		for (std::size_t n = 0; n < frames; ++n)
+		{
+			for (std::size_t lane = 0; lane < LANES; ++lane)
+			{
+				const double x = block[n * LANES + lane];
+				const double coefficient = x > envelope[lane] ? attack : release;
+				envelope[lane] = coefficient * (envelope[lane] - x) + x;
+			}
+		}
+		envelopes[group] = envelope;
+	}
+}
+
+void MeterBank::publish()
+{
+	Snapshot& snapshot = published.write();
+	const std::size_t numChannels = channels.size();
+	const double scale = weight > 0.0 ? 1.0 / weight : 0.0;
+	for (std::size_t c = 0; c < numChannels; ++c)
+	{
+		const Channel& channel = channels[c];
+		Reading& reading = snapshot.readings[c];
+		reading.peak = channel.peak;
+		reading.truePeak = truePeak ? channel.truePeak : channel.peak;
+		reading.rms = std::sqrt(std::max(channel.energy * scale, 0.0));
+		reading.envelope = envelopes[c / LANES][c % LANES];
+		reading.maximum = channel.maximum;
+
+		const std::size_t left = c - c % 2;
+		reading.correlation = 0.0;
+		if (left + 1 < numChannels)
+		{
+			const double power = std::sqrt(channels[left].energy * channels[left + 1].energy);
+			reading.correlation = power > 1e-20 ? std::clamp(channels[left].product / power, -1.0, 1.0) : 0.0;
+		}
+	}
+	snapshot.frame = frame;
+	published.publish();
+}
+
+const MeterBank::Snapshot& MeterBank::read()
+{
+	published.update();
+	return published.read();
+}
+
+std::size_t MeterBank::getNumChannels() const
+{
+	return channels.size();
+}
+
+void MeterBank::setPeakDecay(const double decibelsPerSecond)
+{
+	peakRate = std::max(decibelsPerSecond, 0.0);
+	peakDecay = std::pow(10.0, -peakRate / (20.0 * Settings::SAMPLE_RATE));
+}
+
+void MeterBank::setWindow(const double milliseconds)
+{
+	windowTime = std::max(milliseconds, 1.0);
+	windowDecay = std::exp(-1.0 / (windowTime * 0.001 * Settings::SAMPLE_RATE));
+}
+
+void MeterBank::setAttack(const double milliseconds)
+{
+	attack = follower(milliseconds);
+}
+
+void MeterBank::setRelease(const double milliseconds)
+{
+	release = follower(milliseconds);
+}
+
+void MeterBank::setTruePeak(const bool enabled)
+{
+	truePeak = enabled;
+}
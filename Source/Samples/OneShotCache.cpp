@@ -0,0 +1,129 @@
+#include "Samples/OneShotCache.hpp"
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	// Between passes over the requests. A changed sound is synthesised live for at least this long.
+	constexpr std::chrono::milliseconds INTERVAL{ 5 };
+}
+
+OneShotCache::OneShotCache()
+{
+	requests.reserve(MAXIMUM_REQUESTS);
+	serving.reserve(MAXIMUM_REQUESTS);
+	entries.reserve(MAXIMUM_ENTRIES);
+	std::thread([this]()
+	{
+		run();
+	}).detach();
+}
+
+OneShotCache& OneShotCache::get()
+{
+	static auto* cache = new OneShotCache();
+	return *cache;
+}
+
+bool OneShotCache::request(const std::shared_ptr <Slot>& slot, const Renderer renderer, const Parameters& parameters)
+{
+	std::unique_lock <std::mutex> lock(requestMutex, std::try_to_lock);
+	if (!lock.owns_lock() || requests.size() >= MAXIMUM_REQUESTS)
+	{
+		return false;
+	}
+	Request request;
+	request.slot = slot;
+	request.renderer = renderer;
+	request.parameters = parameters;
+	requests.push_back(std::move(request));
+	return true;
+}
+
+void OneShotCache::run()
+{
+	while (true)
+	{
+		{
+			std::lock_guard <std::mutex> lock(requestMutex);
+			serving.swap(requests);
+		}
+
+		for (Request& request : serving)
+		{
+			std::shared_ptr <const SampleData> data = find(request.renderer, request.parameters);
+			std::lock_guard <std::mutex> lock(request.slot->mutex);
+			request.slot->ready = std::move(data);
+			request.slot->parameters = request.parameters;
+			request.slot->fresh.store(true, std::memory_order_release);
+		}
+		// Dropping the slots here, not on the audio thread, which may have let go of them.
+		serving.clear();
+
+		std::this_thread::sleep_for(INTERVAL);
+	}
+}
+
+std::shared_ptr <const SampleData> OneShotCache::find(const Renderer renderer, const Parameters& parameters)
+{
+	std::lock_guard <std::mutex> lock(cacheMutex);
+	++clock;
+	for (Entry& entry : entries)
+	{
+		if (entry.renderer == renderer && entry.parameters == parameters)
+		{
+			entry.used = clock;
+			return entry.data;
+		}
+	}
+
+	if (entries.size() >= MAXIMUM_ENTRIES)
+	{
+		// The least recently used sound only this cache holds. If instruments hold them all, keep growing.
+		auto oldest = entries.end();
+		for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+		{
+			if (entry->data.use_count() == 1 && (oldest == entries.end() || entry->used < oldest->used))
+			{
+				oldest = entry;
+			}
+		}
+		if (oldest != entries.end())
+		{
+			*oldest = std::move(entries.back());
+			entries.pop_back();
+		}
+	}
+
+	Entry entry;
+	entry.renderer = renderer;
+	entry.parameters = parameters;
+	entry.data = renderer(parameters);
+	entry.used = clock;
+	entries.push_back(entry);
+	return entry.data;
+}
+
+std::shared_ptr <const SampleData> OneShotCache::render(const Renderer renderer, const Parameters& parameters)
+{
+	return find(renderer, parameters);
+}
+
+void OneShotCache::clear()
+{
+	std::lock_guard <std::mutex> lock(cacheMutex);
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry)
+	{
+		return entry.data.use_count() == 1;
+	}), entries.end());
+}
+
+std::size_t OneShotCache::getNumEntries()
+{
+	std::lock_guard <std::mutex> lock(cacheMutex);
+	return entries.size();
+}
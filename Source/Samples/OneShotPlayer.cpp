@@ -0,0 +1,126 @@
+#include "Samples/OneShotPlayer.hpp"
+
+using namespace Maximilian;
+
+OneShotPlayer::OneShotPlayer(const OneShotPlayer& other)
+{
+	*this = other;
+}
+
+OneShotPlayer& OneShotPlayer::operator=(const OneShotPlayer& other)
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+	sounds = other.sounds;
+	soundParameters = other.soundParameters;
+	used = other.used;
+	clock = other.clock;
+	requested = false;
+	playing = false;
+	active = false;
+	setEnabled(other.enabled);
+	return *this;
+}
+
+void OneShotPlayer::update()
+{
+	if (!slot->fresh.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	std::unique_lock <std::mutex> lock(slot->mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		return;
+	}
+
+	// In place of the sound played longest ago, which goes to the slot to be released by the cache's thread.
+	std::size_t oldest = 0;
+	for (std::size_t i = 1; i < SOUNDS; ++i)
+	{
+		if (used[i] < used[oldest])
+		{
+			oldest = i;
+		}
+	}
+	sounds[oldest].swap(slot->ready);
+	soundParameters[oldest] = slot->parameters;
+	used[oldest] = ++clock;
+	slot->fresh.store(false, std::memory_order_relaxed);
+	if (soundParameters[oldest] == requestedParameters)
+	{
+		requested = false;
+	}
+}
+
+bool OneShotPlayer::trigger(const OneShotCache::Renderer renderer, const OneShotCache::Parameters& parameters)
+{
+	playing = false;
+	active = false;
+	if (!enabled)
+	{
+		return false;
+	}
+
+	update();
+	for (std::size_t i = 0; i < SOUNDS; ++i)
+	{
+		if (sounds[i] != nullptr && soundParameters[i] == parameters)
+		{
+			samples = sounds[i]->buffer.getFloat(0);
+			frames = sounds[i]->buffer.getNumFrames();
+			position = 0;
+			playing = samples != nullptr && frames > 0;
+			active = true;
+			used[i] = ++clock;
+			return true;
+		}
+	}
+
+	if (!requested || requestedParameters != parameters)
+	{
+		requested = OneShotCache::get().request(slot, renderer, parameters);
+		requestedParameters = parameters;
+	}
+	return false;
+}
+
+void OneShotPlayer::stop()
+{
+	playing = false;
+	active = false;
+}
+
+bool OneShotPlayer::isEnabled() const
+{
+	return enabled;
+}
+
+bool OneShotPlayer::isPlaying() const
+{
+	return playing;
+}
+
+bool OneShotPlayer::isActive() const
+{
+	return active;
+}
+
+void OneShotPlayer::setEnabled(const bool _enabled)
+{
+	enabled = _enabled;
+	playing = false;
+	active = false;
+	if (enabled)
+	{
+		slot = std::make_shared <OneShotCache::Slot>();
+		OneShotCache::get();
+	}
+	else
+	{
+		slot.reset();
+		sounds = {};
+	}
+}
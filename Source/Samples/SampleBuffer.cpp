@@ -0,0 +1,315 @@
+#include "Samples/SampleBuffer.hpp"
+
+#include <new>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	void* allocateAligned(const std::size_t bytes)
+	{
+		void* memory = ::operator new(std::max <std::size_t>(bytes, 1), std::align_val_t(SampleBuffer::ALIGNMENT));
+		std::memset(memory, 0, bytes);
+		return memory;
+	}
+
+	void freeAligned(void* memory)
+	{
+		if (memory != nullptr)
+		{
+			::operator delete(memory, std::align_val_t(SampleBuffer::ALIGNMENT));
+		}
+	}
+}
+
+SampleBuffer::SampleBuffer(const std::size_t _channels, const std::size_t _frames, const Format _format)
+{
+	allocate(_channels, _frames, _format);
+}
+
+SampleBuffer::SampleBuffer(const SampleBuffer& other) : format(other.format), channels(other.channels),
+		frames(other.frames), stride(other.stride)
+{
+	if (other.data != nullptr)
+	{
+		data = allocateAligned(getBytes());
+		std::memcpy(data, other.data, getBytes());
+	}
+}
+
+SampleBuffer::SampleBuffer(SampleBuffer&& other) noexcept
+{
+	swap(other);
+}
+
+SampleBuffer& SampleBuffer::operator=(SampleBuffer other) noexcept
+{
+	swap(other);
+	return *this;
+}
+
+SampleBuffer::~SampleBuffer()
+{
+	release();
+}
+
+void SampleBuffer::swap(SampleBuffer& other) noexcept
+{
+	std::swap(format, other.format);
+	std::swap(channels, other.channels);
+	std::swap(frames, other.frames);
+	std::swap(stride, other.stride);
+	std::swap(data, other.data);
+	std::swap(owner, other.owner);
+}
+
+std::size_t SampleBuffer::getSampleSize() const
+{
+	return format == Format::Float ? sizeof(float) : sizeof(std::int16_t);
+}
+
+void SampleBuffer::allocate(const std::size_t _channels, const std::size_t _frames, const Format _format)
+{
+	release();
+	format = _format;
+	channels = _channels;
+	frames = _frames;
+	const std::size_t perLine = ALIGNMENT / getSampleSize();
+	stride = (frames + perLine - 1) / perLine * perLine;
+	if (channels > 0)
+	{
+		data = allocateAligned(getBytes());
+	}
+}
+
+void SampleBuffer::resize(const std::size_t _frames)
+{
+	SampleBuffer resized(std::max <std::size_t>(channels, 1), _frames, format);
+	const std::size_t kept = std::min(frames, _frames);
+	for (std::size_t c = 0; c < channels; ++c)
+	{
+		std::memcpy(static_cast<char*>(resized.data) + c * resized.stride * getSampleSize(),
+				static_cast<const char*>(data) + c * stride * getSampleSize(), kept * getSampleSize());
+	}
+	swap(resized);
+}
+
+bool SampleBuffer::assignInterleaved(const void* source, const std::size_t _frames, const std::size_t _channels,
+		const unsigned short bitsPerSample, const bool floatingPoint, const Format _format)
+{
+	const unsigned short width = bitsPerSample / 8;
+	const bool supported = floatingPoint ? (bitsPerSample == 32 || bitsPerSample == 64)
+										 : (bitsPerSample % 8 == 0 && width >= 1 && width <= 4);
+	if (!supported || _channels == 0)
+	{
+		return false;
+	}
+
+	allocate(_channels, _frames, _format);
+
+	const auto* bytes = static_cast<const unsigned char*>(source);
+	const std::size_t frameBytes = width * channels;
+	for (std::size_t c = 0; c < channels; ++c)
+	{
+		const unsigned char* sample = bytes + c * width;
+		for (std::size_t i = 0; i < frames; ++i, sample += frameBytes)
+		{
+			set(c, i, float(decodeSample(sample, bitsPerSample, floatingPoint)));
+		}
+	}
+	return true;
+}
+
+void SampleBuffer::adopt(std::shared_ptr <void> _owner, void* samples, const std::size_t _frames,
+		const Format _format)
+{
+	release();
+	owner = std::move(_owner);
+	data = samples;
+	format = _format;
+	channels = 1;
+	frames = _frames;
+	stride = _frames;
+}
+
+void SampleBuffer::release()
+{
+	if (owner == nullptr)
+	{
+		freeAligned(data);
+	}
+	owner.reset();
+	data = nullptr;
+	channels = 0;
+	frames = 0;
+	stride = 0;
+}
+
+void SampleBuffer::clear()
+{
+	if (data != nullptr)
+	{
+		std::memset(data, 0, getBytes());
+	}
+}
+
+void SampleBuffer::read(const std::size_t channel, const std::size_t start, const std::size_t count,
+		double* output) const
+{
+	const std::size_t available = start < frames ? std::min(count, frames - start) : 0;
+	if (format == Format::Float)
+	{
+		const float* plane = getFloat(channel) + start;
+		for (std::size_t i = 0; i < available; ++i)
+		{
+			output[i] = plane[i];
+		}
+	}
+	else
+	{
+		const std::int16_t* plane = getInt16(channel) + start;
+		for (std::size_t i = 0; i < available; ++i)
+		{
+			output[i] = plane[i] * double(INT16_SCALE);
+		}
+	}
+	std::fill(output + available, output + count, 0.0);
+}
+
+void SampleBuffer::read(const std::size_t channel, const std::size_t start, const std::size_t count,
+		float* output) const
+{
+	const std::size_t available = start < frames ? std::min(count, frames - start) : 0;
+	if (format == Format::Float)
+	{
+		std::memcpy(output, getFloat(channel) + start, available * sizeof(float));
+	}
+	else
+	{
+		const std::int16_t* plane = getInt16(channel) + start;
+		for (std::size_t i = 0; i < available; ++i)
+		{
+			output[i] = plane[i] * INT16_SCALE;
+		}
+	}
+	std::fill(output + available, output + count, 0.0f);
+}
+
+void SampleBuffer::write(const std::size_t channel, const std::size_t start, const std::size_t count,
+		const double* input)
+{
+	const std::size_t available = start < frames ? std::min(count, frames - start) : 0;
+	for (std::size_t i = 0; i < available; ++i)
+	{
+		set(channel, start + i, float(input[i]));
+	}
+}
+
+std::int16_t SampleBuffer::toInt16(const float value)
+{
+	return std::int16_t(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+double SampleBuffer::decodeSample(const unsigned char* sample, const unsigned short bitsPerSample,
+		const bool floatingPoint)
+{
+	if (floatingPoint)
+	{
+		if (bitsPerSample == 64)
+		{
+			double value;
+			std::memcpy(&value, sample, sizeof(value));
+			return value;
+		}
+		float value;
+		std::memcpy(&value, sample, sizeof(value));
+		return value;
+	}
+
+	// Little endian, 8 bit unsigned and the wider ones signed.
+	switch (bitsPerSample / 8)
+	{
+	case 1:
+		return (double(sample[0]) - 128.0) / 128.0;
+	case 2:
+		return double(std::int16_t(sample[0] | (sample[1] << 8))) / 32767.0;
+	case 3:
+		return double(std::int32_t((std::uint32_t(sample[0]) << 8) | (std::uint32_t(sample[1]) << 16) |
+								   (std::uint32_t(sample[2]) << 24)) / 256) / 8388607.0;
+	default:
+		return double(std::int32_t(std::uint32_t(sample[0]) | (std::uint32_t(sample[1]) << 8) |
+								   (std::uint32_t(sample[2]) << 16) | (std::uint32_t(sample[3]) << 24))) /
+			   2147483647.0;
+	}
+}
+
+SampleBuffer::Format SampleBuffer::getFormat() const
+{
+	return format;
+}
+
+std::size_t SampleBuffer::getNumChannels() const
+{
+	return channels;
+}
+
+std::size_t SampleBuffer::getNumFrames() const
+{
+	return frames;
+}
+
+std::size_t SampleBuffer::getBytes() const
+{
+	return channels * stride * getSampleSize();
+}
+
+bool SampleBuffer::isEmpty() const
+{
+	return frames == 0 || channels == 0;
+}
+
+bool SampleBuffer::isAdopted() const
+{
+	return owner != nullptr;
+}
+
+const float* SampleBuffer::getFloat(const std::size_t channel) const
+{
+	return format == Format::Float ? static_cast<const float*>(data) + channel * stride : nullptr;
+}
+
+float* SampleBuffer::getFloat(const std::size_t channel)
+{
+	return format == Format::Float ? static_cast<float*>(data) + channel * stride : nullptr;
+}
+
+const std::int16_t* SampleBuffer::getInt16(const std::size_t channel) const
+{
+	return format == Format::Int16 ? static_cast<const std::int16_t*>(data) + channel * stride : nullptr;
+}
+
+std::int16_t* SampleBuffer::getInt16(const std::size_t channel)
+{
+	return format == Format::Int16 ? static_cast<std::int16_t*>(data) + channel * stride : nullptr;
+}
+
+void SampleBuffer::setFormat(const Format _format)
+{
+	if (_format == format)
+	{
+		return;
+	}
+	SampleBuffer converted(channels, frames, _format);
+	for (std::size_t c = 0; c < channels; ++c)
+	{
+		for (std::size_t i = 0; i < frames; ++i)
+		{
+			converted.set(c, i, get(c, i));
+		}
+	}
+	swap(converted);
+}
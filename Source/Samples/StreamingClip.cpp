@@ -0,0 +1,460 @@
+#include "Samples/StreamingClip.hpp"
+#include "Samples/WavFile.hpp"
+#include "Definition/Settings.hpp"
+
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#if defined(_WIN32)
+
+#include <fstream>
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+using namespace Maximilian;
+
+struct StreamingClip::File
+{
+#if defined(_WIN32)
+	std::ifstream stream;
+
+	explicit File(const std::string& path) : stream(path, std::ios::in | std::ios::binary)
+	{
+	}
+
+	bool isOpen() const
+	{
+		return stream.is_open();
+	}
+
+	long long read(void* output, const std::size_t bytes, const std::uint64_t offset)
+	{
+		stream.clear();
+		stream.seekg(std::streamoff(offset), std::ios::beg);
+		stream.read(static_cast<char*>(output), std::streamsize(bytes));
+		return stream.gcount();
+	}
+#else
+	int descriptor = -1;
+
+	explicit File(const std::string& path) : descriptor(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+	{
+	}
+
+	~File()
+	{
+		if (descriptor >= 0)
+		{
+			::close(descriptor);
+		}
+	}
+
+	bool isOpen() const
+	{
+		return descriptor >= 0;
+	}
+
+	long long read(void* output, const std::size_t bytes, const std::uint64_t offset)
+	{
+		ssize_t result;
+		do
+		{
+			result = pread(descriptor, output, bytes, off_t(offset));
+		}
+		while (result < 0 && errno == EINTR);
+		return result;
+	}
+#endif
+};
+
+namespace Maximilian
+{
+
+	/**
+	 * The thread that reads ahead for every open StreamingClip. Clips are
+	 * added and removed at setup, under the mutex the thread holds while it
+	 * services them, so closing a clip waits for any read in progress.
+	 */
+	class StreamPrefetcher
+	{
+
+	private:
+
+		// Between passes over the clips. A trigger waits at most this long to be noticed.
+		static constexpr std::chrono::milliseconds INTERVAL{ 5 };
+
+		std::mutex mutex;
+
+		std::vector <StreamingClip*> clips;
+
+		bool started = false;
+
+		void run()
+		{
+			while (true)
+			{
+				{
+					std::lock_guard <std::mutex> lock(mutex);
+					for (StreamingClip* clip : clips)
+					{
+						clip->service();
+					}
+				}
+				std::this_thread::sleep_for(INTERVAL);
+			}
+		}
+
+	public:
+
+		// Lives for the whole program, like its thread.
+		static StreamPrefetcher& get()
+		{
+			static auto* prefetcher = new StreamPrefetcher();
+			return *prefetcher;
+		}
+
+		void add(StreamingClip* clip)
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			clips.push_back(clip);
+			if (!started)
+			{
+				std::thread([this]()
+				{
+					run();
+				}).detach();
+				started = true;
+			}
+		}
+
+		void remove(StreamingClip* clip)
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			clips.erase(std::remove(clips.begin(), clips.end(), clip), clips.end());
+		}
+
+	};
+}
+
+StreamingClip::StreamingClip() = default;
+
+StreamingClip::~StreamingClip()
+{
+	close();
+}
+
+bool StreamingClip::open(const std::string& fileName, const double headSeconds, const double ringSeconds)
+{
+	close();
+
+	WavFile wav(fileName);
+	if (!wav.isOpen())
+	{
+		printf("ERROR: Could not stream sample %s: %s\n", fileName.c_str(), wav.getError().c_str());
+		return false;
+	}
+
+	auto opened = std::make_unique <File>(fileName);
+	if (!opened->isOpen())
+	{
+		printf("ERROR: Could not stream sample %s\n", fileName.c_str());
+		return false;
+	}
+
+	channels = wav.getNumChannels();
+	bitsPerSample = wav.getBitsPerSample();
+	blockAlign = wav.getBlockAlign();
+	floatingPoint = wav.getEncoding() == WavFile::Encoding::Float;
+	sampleRate = double(wav.getSampleRate());
+	dataOffset = wav.getDataOffset();
+	frames = wav.getNumFrames();
+
+	headFrames = std::min(frames, std::uint64_t(std::max(0.0, headSeconds) * sampleRate));
+	head.allocate(channels, std::size_t(headFrames));
+	for (std::size_t c = 0; c < channels; ++c)
+	{
+		wav.read(c, 0, std::size_t(headFrames), head.getFloat(c));
+	}
+
+	// A power of two, so the slot of a frame is a mask away.
+	capacity = 1;
+	while (capacity < std::uint64_t(std::max(1.0, ringSeconds) * sampleRate) || capacity < 2 * MAXIMUM_READ)
+	{
+		capacity <<= 1;
+	}
+	mask = capacity - 1;
+	ring.allocate(channels, std::size_t(capacity));
+	scratch.resize(MAXIMUM_READ * blockAlign);
+
+	file = std::move(opened);
+	StreamPrefetcher::get().add(this);
+	return true;
+}
+
+void StreamingClip::close()
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+	StreamPrefetcher::get().remove(this);
+	file.reset();
+	head.release();
+	ring.release();
+	frames = 0;
+	headFrames = 0;
+	playing = false;
+	requestedGeneration.store(0);
+	ringGeneration.store(0);
+	servedGeneration = 0;
+	generation = 0;
+}
+
+void StreamingClip::request(const std::uint64_t frame)
+{
+	consumedFrame.store(frame, std::memory_order_relaxed);
+	requestedFrame.store(frame, std::memory_order_relaxed);
+	requestedGeneration.store(++generation, std::memory_order_release);
+}
+
+void StreamingClip::service()
+{
+	const std::uint64_t wanted = requestedGeneration.load(std::memory_order_acquire);
+	if (wanted == 0)
+	{
+		return;
+	}
+	if (wanted != servedGeneration)
+	{
+		servedGeneration = wanted;
+		fillFrame = requestedFrame.load(std::memory_order_relaxed);
+		ringEnd.store(fillFrame, std::memory_order_relaxed);
+		ringGeneration.store(wanted, std::memory_order_release);
+	}
+
+	// Faster playback empties the ring faster, so it reads further ahead.
+	const double speed = std::max(1.0, speedHint.load(std::memory_order_relaxed));
+	const auto readAhead = std::min(capacity, std::max <std::uint64_t>(MAXIMUM_READ,
+			std::uint64_t(READ_AHEAD_SECONDS * sampleRate * speed)));
+
+	while (true)
+	{
+		const std::uint64_t limit = std::min(frames, consumedFrame.load(std::memory_order_acquire) + readAhead);
+		if (fillFrame >= limit)
+		{
+			break;
+		}
+
+		// Up to the end of the ring, so the block lands in contiguous slots.
+		const std::uint64_t slot = fillFrame & mask;
+		const auto count = std::size_t(std::min({ limit - fillFrame, std::uint64_t(MAXIMUM_READ), capacity - slot }));
+		const long long bytes = file->read(scratch.data(), count * blockAlign, dataOffset + fillFrame * blockAlign);
+		if (bytes < blockAlign)
+		{
+			break;
+		}
+		const std::size_t got = std::size_t(bytes) / blockAlign;
+
+		const std::size_t width = bitsPerSample / 8;
+		for (std::size_t c = 0; c < channels; ++c)
+		{
+			float* plane = ring.getFloat(c) + slot;
+			const unsigned char* sample = scratch.data() + c * width;
+			for (std::size_t i = 0; i < got; ++i, sample += blockAlign)
+			{
+				plane[i] = float(SampleBuffer::decodeSample(sample, bitsPerSample, floatingPoint));
+			}
+		}
+
+		fillFrame += got;
+		ringEnd.store(fillFrame, std::memory_order_release);
+		reads.fetch_add(1, std::memory_order_relaxed);
+		bytesRead.fetch_add(std::uint64_t(got) * blockAlign, std::memory_order_relaxed);
+
+		// A new trigger makes the rest of this read ahead useless.
+		if (requestedGeneration.load(std::memory_order_acquire) != wanted)
+		{
+			break;
+		}
+	}
+}
+
+void StreamingClip::trigger()
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+	position = 0.0;
+	playing = true;
+	starved = false;
+	if (frames > headFrames)
+	{
+		request(headFrames);
+	}
+}
+
+void StreamingClip::stop()
+{
+	playing = false;
+}
+
+double StreamingClip::play(double speed)
+{
+	if (!playing)
+	{
+		return 0.0;
+	}
+
+	speed = std::max(0.0, speed);
+	if (speed != lastSpeed)
+	{
+		lastSpeed = speed;
+		speedHint.store(speed, std::memory_order_relaxed);
+	}
+
+	const auto whole = std::uint64_t(position);
+	float a;
+	float b;
+	double output = 0.0;
+	if (fetch(whole, a) && fetch(whole + 1, b))
+	{
+		output = a + (position - double(whole)) * (b - a);
+		starved = false;
+	}
+	else
+	{
+		// Keep time through the gap, so the sample stays in sync once the data arrives.
+		if (!starved)
+		{
+			underruns.fetch_add(1, std::memory_order_relaxed);
+			starved = true;
+		}
+		missedFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	position += speed * sampleRate / Settings::SAMPLE_RATE;
+	if (position >= double(frames))
+	{
+		if (looping)
+		{
+			trigger();
+		}
+		else
+		{
+			playing = false;
+		}
+	}
+	else
+	{
+		consumedFrame.store(std::uint64_t(position), std::memory_order_release);
+	}
+	return output;
+}
+
+void StreamingClip::play(double* buffer, const std::size_t length, const double speed)
+{
+	for (std::size_t n = 0; n < length; ++n)
+	{
+		buffer[n] = play(speed);
+	}
+}
+
+bool StreamingClip::isOpen() const
+{
+	return file != nullptr;
+}
+
+bool StreamingClip::isPlaying() const
+{
+	return playing;
+}
+
+std::size_t StreamingClip::getNumChannels() const
+{
+	return channels;
+}
+
+std::uint64_t StreamingClip::getNumFrames() const
+{
+	return frames;
+}
+
+double StreamingClip::getSampleRate() const
+{
+	return sampleRate;
+}
+
+double StreamingClip::getPosition() const
+{
+	return frames > 0 ? position / double(frames) : 0.0;
+}
+
+std::uint64_t StreamingClip::getBufferedFrames() const
+{
+	const auto whole = std::uint64_t(position);
+	if (ringGeneration.load(std::memory_order_acquire) != generation)
+	{
+		return 0;
+	}
+	const std::uint64_t end = ringEnd.load(std::memory_order_acquire);
+	return end > whole ? end - whole : 0;
+}
+
+std::size_t StreamingClip::getResidentBytes() const
+{
+	return head.getBytes() + ring.getBytes();
+}
+
+StreamingClip::Statistics StreamingClip::getStatistics() const
+{
+	Statistics statistics;
+	statistics.underruns = underruns.load(std::memory_order_relaxed);
+	statistics.missedFrames = missedFrames.load(std::memory_order_relaxed);
+	statistics.reads = reads.load(std::memory_order_relaxed);
+	statistics.bytesRead = bytesRead.load(std::memory_order_relaxed);
+	return statistics;
+}
+
+void StreamingClip::setPosition(const double newPosition)
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+	position = std::clamp(newPosition, 0.0, 1.0) * double(frames);
+	starved = false;
+	const auto whole = std::uint64_t(position);
+	if (frames > headFrames)
+	{
+		request(std::max(whole, headFrames));
+	}
+}
+
+void StreamingClip::setReadChannel(const std::size_t channel)
+{
+	readChannel = std::min(channel, std::size_t(std::max <unsigned short>(channels, 1) - 1));
+}
+
+void StreamingClip::setLooping(const bool _looping)
+{
+	looping = _looping;
+}
+
+void StreamingClip::resetStatistics()
+{
+	underruns.store(0, std::memory_order_relaxed);
+	missedFrames.store(0, std::memory_order_relaxed);
+	reads.store(0, std::memory_order_relaxed);
+	bytesRead.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,418 @@
+#include "Samples/WavFile.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(_WIN32)
+
+#include <fstream>
+#include <vector>
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#endif
+
+using namespace Maximilian;
+
+struct WavFile::Mapping
+{
+	unsigned char* base = nullptr;
+
+	std::size_t size = 0;
+
+#if defined(_WIN32)
+	std::vector <unsigned char> contents;
+#else
+
+	~Mapping()
+	{
+		if (base != nullptr)
+		{
+			munmap(base, size);
+		}
+	}
+
+#endif
+};
+
+namespace
+{
+	bool same(const unsigned char* bytes, const char* id)
+	{
+		return std::memcmp(bytes, id, 4) == 0;
+	}
+
+	std::uint16_t le16(const unsigned char* bytes)
+	{
+		return std::uint16_t(bytes[0] | (bytes[1] << 8));
+	}
+
+	std::uint32_t le32(const unsigned char* bytes)
+	{
+		return std::uint32_t(bytes[0]) | (std::uint32_t(bytes[1]) << 8) | (std::uint32_t(bytes[2]) << 16) |
+			   (std::uint32_t(bytes[3]) << 24);
+	}
+
+	std::uint64_t le64(const unsigned char* bytes)
+	{
+		return std::uint64_t(le32(bytes)) | (std::uint64_t(le32(bytes + 4)) << 32);
+	}
+
+	constexpr unsigned short FORMAT_PCM = 1;
+	constexpr unsigned short FORMAT_FLOAT = 3;
+	constexpr unsigned short FORMAT_EXTENSIBLE = 0xFFFE;
+
+	// RF64 stores this in the 32 bit sizes that live in its ds64 chunk instead.
+	constexpr std::uint32_t SIZE_IN_DS64 = 0xFFFFFFFF;
+}
+
+WavFile::WavFile(const std::string& path)
+{
+	open(path);
+}
+
+bool WavFile::fail(const std::string& message)
+{
+	error = message;
+	mapping.reset();
+	samples = nullptr;
+	dataSize = 0;
+	return false;
+}
+
+bool WavFile::open(const std::string& path)
+{
+	close();
+	error.clear();
+
+	auto opened = std::make_shared <Mapping>();
+
+#if defined(_WIN32)
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return fail("could not open " + path);
+	}
+	opened->contents.resize(std::size_t(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(opened->contents.data()), std::streamsize(opened->contents.size()));
+	opened->base = opened->contents.data();
+	opened->size = opened->contents.size();
+#else
+	const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0)
+	{
+		return fail("could not open " + path);
+	}
+	struct stat status{};
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+	{
+		::close(descriptor);
+		return fail("could not size " + path);
+	}
+	// Private pages: writes made through the buffer stay in memory.
+	void* base = mmap(nullptr, std::size_t(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor);
+	if (base == MAP_FAILED)
+	{
+		return fail("could not map " + path);
+	}
+	opened->base = static_cast<unsigned char*>(base);
+	opened->size = std::size_t(status.st_size);
+#endif
+
+	mapping = std::move(opened);
+	return parse();
+}
+
+void WavFile::close()
+{
+	mapping.reset();
+	samples = nullptr;
+	dataSize = 0;
+	rf64 = false;
+}
+
+bool WavFile::parse()
+{
+	unsigned char* file = mapping->base;
+	const std::uint64_t size = mapping->size;
+
+	if (size < 12)
+	{
+		return fail("too short for a RIFF header");
+	}
+	rf64 = same(file, "RF64") || same(file, "BW64");
+	if ((!same(file, "RIFF") && !rf64) || !same(file + 8, "WAVE"))
+	{
+		return fail("not a WAVE file");
+	}
+
+	std::uint64_t longDataSize = 0;
+	bool formatFound = false;
+	bool dataFound = false;
+
+	std::uint64_t offset = 12;
+	while (offset + 8 <= size)
+	{
+		const unsigned char* chunk = file + offset;
+		const std::uint64_t body = offset + 8;
+		std::uint64_t chunkSize = le32(chunk + 4);
+
+		if (same(chunk, "ds64"))
+		{
+			if (!rf64 || chunkSize < 24 || body + chunkSize > size)
+			{
+				return fail("malformed ds64 chunk");
+			}
+			longDataSize = le64(file + body + 8);
+		}
+		else if (same(chunk, "data") && rf64 && chunkSize == SIZE_IN_DS64)
+		{
+			chunkSize = longDataSize;
+		}
+
+		if (body + chunkSize > size)
+		{
+			if (!same(chunk, "data"))
+			{
+				return fail("chunk runs past the end of the file");
+			}
+			// A recording that was cut short, keep what made it to disk.
+			chunkSize = size - body;
+		}
+
+		if (same(chunk, "fmt "))
+		{
+			if (!parseFormat(file + body, chunkSize))
+			{
+				return false;
+			}
+			formatFound = true;
+		}
+		else if (same(chunk, "data"))
+		{
+			if (!formatFound)
+			{
+				return fail("data chunk before the fmt chunk");
+			}
+			samples = file + body;
+			dataSize = chunkSize - chunkSize % blockAlign;
+			dataFound = true;
+		}
+
+		offset = body + chunkSize + (chunkSize & 1);
+	}
+
+	if (!formatFound || !dataFound)
+	{
+		return fail(formatFound ? "no data chunk" : "no fmt chunk");
+	}
+	return true;
+}
+
+bool WavFile::parseFormat(const unsigned char* chunk, const std::uint64_t size)
+{
+	if (size < 16)
+	{
+		return fail("fmt chunk too short");
+	}
+	formatTag = le16(chunk);
+	channels = le16(chunk + 2);
+	sampleRate = le32(chunk + 4);
+	byteRate = le32(chunk + 8);
+	blockAlign = le16(chunk + 12);
+	bitsPerSample = le16(chunk + 14);
+
+	unsigned short code = formatTag;
+	if (formatTag == FORMAT_EXTENSIBLE)
+	{
+		if (size < 40)
+		{
+			return fail("extensible fmt chunk too short");
+		}
+		// The first two bytes of the sub format GUID are the plain format code.
+		code = le16(chunk + 24);
+	}
+
+	if (code == FORMAT_PCM && bitsPerSample % 8 == 0 && bitsPerSample >= 8 && bitsPerSample <= 32)
+	{
+		encoding = Encoding::Integer;
+	}
+	else if (code == FORMAT_FLOAT && (bitsPerSample == 32 || bitsPerSample == 64))
+	{
+		encoding = Encoding::Float;
+	}
+	else
+	{
+		return fail("unsupported sample format " + std::to_string(code) + " at " + std::to_string(bitsPerSample) +
+					" bits");
+	}
+
+	if (channels == 0 || blockAlign != channels * (bitsPerSample / 8))
+	{
+		return fail("inconsistent channel count and block align");
+	}
+	return true;
+}
+
+void WavFile::advise(const Access access) const
+{
+#if !defined(_WIN32)
+	if (samples == nullptr || dataSize == 0)
+	{
+		return;
+	}
+	// madvise wants a page aligned start.
+	const auto page = std::uintptr_t(sysconf(_SC_PAGESIZE));
+	const auto start = reinterpret_cast<std::uintptr_t>(samples) & ~(page - 1);
+	const std::size_t length = std::size_t(reinterpret_cast<std::uintptr_t>(samples) + dataSize - start);
+
+	int advice = MADV_NORMAL;
+	switch (access)
+	{
+	case Access::Sequential:
+		advice = MADV_SEQUENTIAL;
+		break;
+	case Access::Random:
+		advice = MADV_RANDOM;
+		break;
+	case Access::WillNeed:
+		advice = MADV_WILLNEED;
+		break;
+	case Access::DontNeed:
+		advice = MADV_DONTNEED;
+		break;
+	case Access::Normal:
+	default:
+		break;
+	}
+	madvise(reinterpret_cast<void*>(start), length, advice);
+#else
+	(void)access;
+#endif
+}
+
+bool WavFile::map(SampleBuffer& buffer, const SampleBuffer::Format format) const
+{
+	if (samples == nullptr || channels != 1)
+	{
+		return false;
+	}
+	const bool matches = format == SampleBuffer::Format::Float
+						 ? encoding == Encoding::Float && bitsPerSample == 32
+						 : encoding == Encoding::Integer && bitsPerSample == 16;
+	const std::size_t sampleSize = bitsPerSample / 8;
+	if (!matches || reinterpret_cast<std::uintptr_t>(samples) % sampleSize != 0)
+	{
+		return false;
+	}
+
+	// Playback reads forwards from wherever it is triggered, so get the pages in early.
+	advise(Access::WillNeed);
+	buffer.adopt(std::shared_ptr <void>(mapping, samples), samples, std::size_t(getNumFrames()), format);
+	return true;
+}
+
+bool WavFile::decode(SampleBuffer& buffer, const SampleBuffer::Format format) const
+{
+	if (samples == nullptr)
+	{
+		return false;
+	}
+	advise(Access::Sequential);
+	const bool decoded = buffer.assignInterleaved(samples, std::size_t(getNumFrames()), channels, bitsPerSample,
+			encoding == Encoding::Float, format);
+	// Everything is in the buffer now, the file's pages can go.
+	advise(Access::DontNeed);
+	return decoded;
+}
+
+void WavFile::read(const std::size_t channel, const std::uint64_t start, const std::size_t count,
+		float* output) const
+{
+	const std::uint64_t frames = getNumFrames();
+	const std::size_t available = start < frames ? std::size_t(std::min <std::uint64_t>(count, frames - start)) : 0;
+	const std::size_t width = bitsPerSample / 8;
+	const unsigned char* sample = samples + start * blockAlign + channel * width;
+	for (std::size_t i = 0; i < available; ++i, sample += blockAlign)
+	{
+		output[i] = float(SampleBuffer::decodeSample(sample, bitsPerSample, encoding == Encoding::Float));
+	}
+	std::fill(output + available, output + count, 0.0f);
+}
+
+bool WavFile::isOpen() const
+{
+	return samples != nullptr;
+}
+
+const std::string& WavFile::getError() const
+{
+	return error;
+}
+
+unsigned short WavFile::getFormatTag() const
+{
+	return formatTag;
+}
+
+WavFile::Encoding WavFile::getEncoding() const
+{
+	return encoding;
+}
+
+unsigned short WavFile::getNumChannels() const
+{
+	return channels;
+}
+
+unsigned short WavFile::getBitsPerSample() const
+{
+	return bitsPerSample;
+}
+
+unsigned short WavFile::getBlockAlign() const
+{
+	return blockAlign;
+}
+
+std::uint32_t WavFile::getSampleRate() const
+{
+	return sampleRate;
+}
+
+std::uint32_t WavFile::getByteRate() const
+{
+	return byteRate;
+}
+
+std::uint64_t WavFile::getNumFrames() const
+{
+	return blockAlign > 0 ? dataSize / blockAlign : 0;
+}
+
+std::uint64_t WavFile::getDataSize() const
+{
+	return dataSize;
+}
+
+std::uint64_t WavFile::getDataOffset() const
+{
+	return samples != nullptr ? std::uint64_t(samples - mapping->base) : 0;
+}
+
+const unsigned char* WavFile::getData() const
+{
+	return samples;
+}
+
+bool WavFile::isRF64() const
+{
+	return rf64;
+}
@@ -0,0 +1,101 @@
+#include "Sequencing/TempoMap.hpp"
+#include "Definition/Settings.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	constexpr double MINIMUM_BPM = 1.0;
+}
+
+TempoMap::TempoMap(const double bpm)
+{
+	changes.reserve(RESERVED_CHANGES);
+	reset(bpm);
+}
+
+void TempoMap::reset(const double bpm)
+{
+	sampleRate = Settings::SAMPLE_RATE;
+	changes.clear();
+	Change first;
+	first.bpm = std::max(bpm, MINIMUM_BPM);
+	first.samplesPerTick = sampleRate * 60.0 / (first.bpm * TICKS_PER_BEAT);
+	changes.push_back(first);
+}
+
+void TempoMap::setTempo(std::int64_t tick, const double bpm)
+{
+	tick = std::max <std::int64_t>(tick, 0);
+
+	// Sorted by tick, so everything from the first change at or after 'tick' goes.
+	const auto later = std::lower_bound(changes.begin() + 1, changes.end(), tick,
+			[](const Change& change, const std::int64_t value)
+			{
+				return change.tick < value;
+			});
+	changes.erase(later, changes.end());
+
+	Change change;
+	change.tick = tick;
+	change.bpm = std::max(bpm, MINIMUM_BPM);
+	change.samplesPerTick = sampleRate * 60.0 / (change.bpm * TICKS_PER_BEAT);
+	if (tick == 0)
+	{
+		changes.front() = change;
+		return;
+	}
+	const Change& previous = changes.back();
+	change.sample = previous.sample + double(tick - previous.tick) * previous.samplesPerTick;
+	changes.push_back(change);
+}
+
+const TempoMap::Change& TempoMap::atTick(const std::int64_t tick) const
+{
+	const auto after = std::upper_bound(changes.begin() + 1, changes.end(), tick,
+			[](const std::int64_t value, const Change& change)
+			{
+				return value < change.tick;
+			});
+	return *(after - 1);
+}
+
+const TempoMap::Change& TempoMap::atSample(const double sample) const
+{
+	const auto after = std::upper_bound(changes.begin() + 1, changes.end(), sample,
+			[](const double value, const Change& change)
+			{
+				return value < change.sample;
+			});
+	return *(after - 1);
+}
+
+std::int64_t TempoMap::toSample(const std::int64_t tick) const
+{
+	const Change& change = atTick(tick);
+	return std::llround(change.sample + double(tick - change.tick) * change.samplesPerTick);
+}
+
+double TempoMap::toTick(const std::int64_t sample) const
+{
+	const Change& change = atSample(double(sample));
+	return double(change.tick) + (double(sample) - change.sample) / change.samplesPerTick;
+}
+
+double TempoMap::getTempo(const std::int64_t tick) const
+{
+	return atTick(tick).bpm;
+}
+
+double TempoMap::getSamplesPerTick(const std::int64_t tick) const
+{
+	return atTick(tick).samplesPerTick;
+}
+
+const std::vector <TempoMap::Change>& TempoMap::getChanges() const
+{
+	return changes;
+}
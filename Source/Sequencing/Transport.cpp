@@ -0,0 +1,105 @@
+#include "Sequencing/Transport.hpp"
+
+using namespace Maximilian;
+
+Transport::Transport(const std::size_t _capacity, const double bpm) : tempo(bpm)
+{
+	setup(_capacity);
+}
+
+void Transport::setup(const std::size_t _capacity)
+{
+	capacity = std::max <std::size_t>(_capacity, 1);
+	queue.clear();
+	queue.reserve(capacity);
+}
+
+void Transport::push(const Entry& entry)
+{
+	queue.push_back(entry);
+	std::push_heap(queue.begin(), queue.end(), later);
+}
+
+bool Transport::schedule(const Event& event)
+{
+	if (queue.size() >= capacity)
+	{
+		++dropped;
+		return false;
+	}
+	Entry entry;
+	entry.event = event;
+	entry.order = order++;
+	push(entry);
+	return true;
+}
+
+void Transport::clear()
+{
+	queue.clear();
+}
+
+void Transport::play()
+{
+	playing = true;
+}
+
+void Transport::stop()
+{
+	playing = false;
+}
+
+void Transport::locate(const std::int64_t sample)
+{
+	position = std::max <std::int64_t>(sample, 0);
+}
+
+bool Transport::isPlaying() const
+{
+	return playing;
+}
+
+std::int64_t Transport::getPosition() const
+{
+	return position;
+}
+
+double Transport::getTick() const
+{
+	return tempo.toTick(position);
+}
+
+double Transport::getBeat() const
+{
+	return getTick() / double(TempoMap::TICKS_PER_BEAT);
+}
+
+double Transport::getTempo() const
+{
+	return tempo.getTempo(std::int64_t(std::floor(getTick())));
+}
+
+std::size_t Transport::getNumEvents() const
+{
+	return queue.size();
+}
+
+std::uint64_t Transport::getDroppedEvents() const
+{
+	return dropped;
+}
+
+TempoMap& Transport::getTempoMap()
+{
+	return tempo;
+}
+
+const TempoMap& Transport::getTempoMap() const
+{
+	return tempo;
+}
+
+void Transport::setTempo(const double bpm)
+{
+	tempo.setTempo(std::int64_t(std::ceil(getTick())), bpm);
+}
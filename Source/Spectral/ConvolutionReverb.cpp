@@ -0,0 +1,115 @@
+#include "Spectral/ConvolutionReverb.hpp"
+
+#include <algorithm>
+
+using namespace Maximilian;
+
+void ConvolutionReverb::setResponse(const std::size_t index, const Clip& clip, const std::size_t channel)
+{
+	std::vector <double> response(clip.getData().getNumFrames());
+	clip.getData().read(channel, 0, response.size(), response.data());
+	convolvers[index].setImpulseResponse(response.data(), response.size());
+}
+
+void ConvolutionReverb::load(const Clip& response)
+{
+	mode = Mode::Mono;
+	setResponse(0, response, response.getReadChannel());
+}
+
+void ConvolutionReverb::load(const Clip& left, const Clip& right)
+{
+	mode = Mode::Stereo;
+	setResponse(0, left, left.getReadChannel());
+	setResponse(1, right, right.getReadChannel());
+}
+
+void ConvolutionReverb::load(const Clip& leftToLeft, const Clip& leftToRight, const Clip& rightToLeft,
+		const Clip& rightToRight)
+{
+	mode = Mode::TrueStereo;
+	setResponse(0, leftToLeft, leftToLeft.getReadChannel());
+	setResponse(1, leftToRight, leftToRight.getReadChannel());
+	setResponse(2, rightToLeft, rightToLeft.getReadChannel());
+	setResponse(3, rightToRight, rightToRight.getReadChannel());
+}
+
+bool ConvolutionReverb::load(const std::string& fileName, const Mode _mode)
+{
+	Clip file;
+	if (!file.load(fileName) || file.getData().isEmpty())
+	{
+		return false;
+	}
+
+	mode = _mode;
+	const std::size_t needed = _mode == Mode::Mono ? 1 : _mode == Mode::Stereo ? 2 : 4;
+	const std::size_t channels = file.getData().getNumChannels();
+	for (std::size_t index = 0; index < needed; ++index)
+	{
+		// A file with fewer channels than responses repeats its last one.
+		setResponse(index, file, std::min(index, channels - 1));
+	}
+	return true;
+}
+
+double ConvolutionReverb::play(const double input)
+{
+	return convolvers[0].play(input);
+}
+
+void ConvolutionReverb::play(const double inputLeft, const double inputRight, double& outputLeft,
+		double& outputRight)
+{
+	switch (mode)
+	{
+	case Mode::Mono:
+		outputLeft = convolvers[0].play(inputLeft);
+		outputRight = outputLeft;
+		break;
+	case Mode::Stereo:
+		outputLeft = convolvers[0].play(inputLeft);
+		outputRight = convolvers[1].play(inputRight);
+		break;
+	case Mode::TrueStereo:
+		outputLeft = convolvers[0].play(inputLeft) + convolvers[2].play(inputRight);
+		outputRight = convolvers[1].play(inputLeft) + convolvers[3].play(inputRight);
+		break;
+	}
+}
+
+void ConvolutionReverb::process(const double* const* input, double* const* output, const std::size_t frames)
+{
+	if (mode == Mode::Mono)
+	{
+		convolvers[0].process(input[0], output[0], frames);
+		return;
+	}
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		play(input[0][n], input[1][n], output[0][n], output[1][n]);
+	}
+}
+
+void ConvolutionReverb::reset()
+{
+	for (Convolver& convolver : convolvers)
+	{
+		convolver.reset();
+	}
+}
+
+ConvolutionReverb::Mode ConvolutionReverb::getMode() const
+{
+	return mode;
+}
+
+std::size_t ConvolutionReverb::getMissedDeadlines() const
+{
+	std::size_t missed = 0;
+	for (const Convolver& convolver : convolvers)
+	{
+		missed += convolver.getMissedDeadlines();
+	}
+	return missed;
+}
@@ -0,0 +1,359 @@
+#include "Spectral/Convolver.hpp"
+#include "Spectral/FFT.hpp"
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+using namespace Maximilian;
+
+enum JobState : int
+{
+	Idle,
+	Pending,
+	Running,
+	Done
+};
+
+struct Convolver::Stage
+{
+	std::size_t blockSize = 0;
+	std::size_t offset = 0;
+	std::size_t partitions = 0;
+	bool background = false;
+
+	FFT fft;
+
+	// Spectra of the response partitions and of the last 'partitions' input frames.
+	std::vector <std::vector <Complex>> response;
+	std::vector <std::vector <Complex>> spectra;
+	std::size_t newest = 0;
+
+	std::vector <double> frame;
+	std::vector <Complex> sum;
+	std::vector <double> result;
+
+	// Sample count at the end of the input block being convolved.
+	std::uint64_t blockEnd = 0;
+
+	std::atomic <int> state{ Idle };
+
+	Stage(const double* impulseResponse, std::size_t length, std::size_t _blockSize, std::size_t _offset,
+			bool _background) : blockSize(_blockSize), offset(_offset), background(_background), fft(2 * _blockSize)
+	{
+		const std::size_t bins = fft.getNumBins();
+		partitions = (length - offset + blockSize - 1) / blockSize;
+		response.assign(partitions, std::vector <Complex>(bins));
+		spectra.assign(partitions, std::vector <Complex>(bins));
+		frame.assign(2 * blockSize, 0.0);
+		sum.assign(bins, Complex());
+		result.assign(2 * blockSize, 0.0);
+
+		for (std::size_t p = 0; p < partitions; ++p)
+		{
+			std::fill(frame.begin(), frame.end(), 0.0);
+			const std::size_t begin = offset + p * blockSize;
+			const std::size_t end = std::min(begin + blockSize, length);
+			std::copy(impulseResponse + begin, impulseResponse + end, frame.begin());
+			fft.forward(frame.data(), response[p].data());
+		}
+		std::fill(frame.begin(), frame.end(), 0.0);
+	}
+
+	// Overlap-save: transform the frame, multiply-accumulate against every
+	// partition, and keep the second half of the inverse transform.
+	void run()
+	{
+		newest = newest + 1 == partitions ? 0 : newest + 1;
+		fft.forward(frame.data(), spectra[newest].data());
+
+		std::fill(sum.begin(), sum.end(), Complex());
+		std::size_t input = newest;
+		for (std::size_t p = 0; p < partitions; ++p)
+		{
+			const Complex* x = spectra[input].data();
+			const Complex* h = response[p].data();
+			for (std::size_t k = 0; k < sum.size(); ++k)
+			{
+				sum[k] += x[k] * h[k];
+			}
+			input = input == 0 ? partitions - 1 : input - 1;
+		}
+		fft.inverse(sum.data(), result.data());
+	}
+};
+
+namespace
+{
+	// One thread shared by every Convolver. It holds its lock while running a job,
+	// so unregistering a stage waits for any job on it to finish.
+	class ConvolutionWorker
+	{
+
+	private:
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::vector <Convolver::Stage*> stages;
+		std::thread thread;
+
+		void loop()
+		{
+			std::unique_lock <std::mutex> lock(mutex);
+			while (true)
+			{
+				bool worked = false;
+				for (Convolver::Stage* stage : stages)
+				{
+					int expected = Pending;
+					if (stage->state.compare_exchange_strong(expected, Running, std::memory_order_acquire))
+					{
+						stage->run();
+						stage->state.store(Done, std::memory_order_release);
+						worked = true;
+					}
+				}
+				if (!worked)
+				{
+					// The audio thread notifies without the lock, the timeout covers a missed wake up.
+					wake.wait_for(lock, std::chrono::milliseconds(1));
+				}
+			}
+		}
+
+	public:
+
+		ConvolutionWorker() : thread(&ConvolutionWorker::loop, this)
+		{
+			thread.detach();
+		}
+
+		// Never destroyed, the thread runs for the life of the process.
+		static ConvolutionWorker& getDefault()
+		{
+			static ConvolutionWorker* worker = new ConvolutionWorker();
+			return *worker;
+		}
+
+		void add(Convolver::Stage* stage)
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			// Shortest blocks first, they have the nearest deadlines.
+			auto at = std::upper_bound(stages.begin(), stages.end(), stage,
+					[](const Convolver::Stage* a, const Convolver::Stage* b)
+					{
+						return a->blockSize < b->blockSize;
+					});
+			stages.insert(at, stage);
+		}
+
+		void remove(Convolver::Stage* stage)
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			stages.erase(std::remove(stages.begin(), stages.end(), stage), stages.end());
+		}
+
+		void notify()
+		{
+			wake.notify_one();
+		}
+	};
+}
+
+Convolver::Convolver() = default;
+
+Convolver::~Convolver()
+{
+	release();
+}
+
+void Convolver::release()
+{
+	for (std::unique_ptr <Stage>& stage : stages)
+	{
+		if (stage->background)
+		{
+			ConvolutionWorker::getDefault().remove(stage.get());
+		}
+	}
+	stages.clear();
+}
+
+void Convolver::setImpulseResponse(const double* impulseResponse, const std::size_t length)
+{
+	release();
+
+	head.assign(impulseResponse, impulseResponse + std::min(length, HEAD_SIZE));
+
+	std::size_t blockSize = HEAD_SIZE;
+	std::size_t offset = HEAD_SIZE;
+	std::size_t largest = HEAD_SIZE;
+	bool background = false;
+	while (offset < length)
+	{
+		const std::size_t end = std::min(length, 2 * blockSize * STAGE_GROWTH);
+		stages.emplace_back(new Stage(impulseResponse, end, blockSize, offset, background));
+		largest = blockSize;
+		offset = end;
+		blockSize *= STAGE_GROWTH;
+		background = true;
+	}
+
+	std::size_t size = 1;
+	while (size < 2 * largest)
+	{
+		size <<= 1;
+	}
+	history.assign(size, 0.0);
+	historyMask = size - 1;
+
+	// Results land up to offset + blockSize <= 4 * largest samples ahead.
+	size = 1;
+	while (size < 4 * largest + HEAD_SIZE)
+	{
+		size <<= 1;
+	}
+	pending.assign(size, 0.0);
+	pendingMask = size - 1;
+
+	now = 0;
+
+	for (std::unique_ptr <Stage>& stage : stages)
+	{
+		if (stage->background)
+		{
+			ConvolutionWorker::getDefault().add(stage.get());
+		}
+	}
+}
+
+void Convolver::boundary(Stage& stage)
+{
+	const std::size_t blockSize = stage.blockSize;
+
+	if (stage.background && stage.state.load(std::memory_order_acquire) != Idle)
+	{
+		// The previous block is due now.
+		int expected = Pending;
+		if (stage.state.compare_exchange_strong(expected, Running, std::memory_order_acquire))
+		{
+			stage.run();
+			stage.state.store(Done, std::memory_order_release);
+			missedDeadlines.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if (expected == Running)
+		{
+			missedDeadlines.fetch_add(1, std::memory_order_relaxed);
+			while (stage.state.load(std::memory_order_acquire) != Done)
+			{
+				std::this_thread::yield();
+			}
+		}
+		const std::uint64_t at = stage.blockEnd - blockSize + stage.offset;
+		for (std::size_t i = 0; i < blockSize; ++i)
+		{
+			pending[(at + i) & pendingMask] += stage.result[blockSize + i];
+		}
+		stage.state.store(Idle, std::memory_order_relaxed);
+	}
+
+	const std::uint64_t start = now - 2 * blockSize;
+	for (std::size_t i = 0; i < 2 * blockSize; ++i)
+	{
+		stage.frame[i] = history[(start + i) & historyMask];
+	}
+	stage.blockEnd = now;
+
+	if (stage.background)
+	{
+		stage.state.store(Pending, std::memory_order_release);
+		ConvolutionWorker::getDefault().notify();
+	}
+	else
+	{
+		stage.run();
+		const std::uint64_t at = now - blockSize + stage.offset;
+		for (std::size_t i = 0; i < blockSize; ++i)
+		{
+			pending[(at + i) & pendingMask] += stage.result[blockSize + i];
+		}
+	}
+}
+
+double Convolver::play(const double input)
+{
+	if (history.empty())
+	{
+		return 0.0;
+	}
+
+	history[now & historyMask] = input;
+
+	double output = 0.0;
+	for (std::size_t k = 0; k < head.size(); ++k)
+	{
+		output += head[k] * history[(now - k) & historyMask];
+	}
+
+	double& late = pending[now & pendingMask];
+	output += late;
+	late = 0.0;
+
+	++now;
+	for (std::unique_ptr <Stage>& stage : stages)
+	{
+		if ((now & (stage->blockSize - 1)) == 0)
+		{
+			boundary(*stage);
+		}
+	}
+	return output;
+}
+
+void Convolver::process(const double* input, double* output, const std::size_t frames)
+{
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		output[n] = play(input[n]);
+	}
+}
+
+void Convolver::reset()
+{
+	for (std::unique_ptr <Stage>& stage : stages)
+	{
+		// Withdraw a queued job, or let a running one finish before clearing what it works on.
+		int expected = Pending;
+		if (!stage->state.compare_exchange_strong(expected, Idle) && expected == Running)
+		{
+			while (stage->state.load(std::memory_order_acquire) != Done)
+			{
+				std::this_thread::yield();
+			}
+		}
+		stage->state.store(Idle);
+		for (std::vector <Complex>& spectrum : stage->spectra)
+		{
+			std::fill(spectrum.begin(), spectrum.end(), Complex());
+		}
+	}
+	std::fill(history.begin(), history.end(), 0.0);
+	std::fill(pending.begin(), pending.end(), 0.0);
+}
+
+std::size_t Convolver::getLength() const
+{
+	if (stages.empty())
+	{
+		return head.size();
+	}
+	const Stage& last = *stages.back();
+	return last.offset + last.partitions * last.blockSize;
+}
+
+std::size_t Convolver::getMissedDeadlines() const
+{
+	return missedDeadlines.load(std::memory_order_relaxed);
+}
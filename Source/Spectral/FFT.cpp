@@ -0,0 +1,362 @@
+#include "Spectral/FFT.hpp"
+
+#include <map>
+#include <cmath>
+#include <mutex>
+#include <cassert>
+
+using namespace Maximilian;
+
+FFTPlan::FFTPlan(const std::size_t _size) : size(_size)
+{
+	// Radix 4 first, then 2, then odd primes, as in KISS FFT. Each stage is stored
+	// as (radix, length left after it).
+	std::size_t n = size;
+	std::size_t radix = 4;
+	while (n > 1)
+	{
+		while (n % radix != 0)
+		{
+			switch (radix)
+			{
+			case 4:
+				radix = 2;
+				break;
+			case 2:
+				radix = 3;
+				break;
+			default:
+				radix += 2;
+				break;
+			}
+			if (radix * radix > n)
+			{
+				radix = n;
+			}
+		}
+		n /= radix;
+		factors.push_back(radix);
+		factors.push_back(n);
+		largestRadix = std::max(largestRadix, radix);
+	}
+
+	forwardTwiddles.resize(size);
+	inverseTwiddles.resize(size);
+	for (std::size_t k = 0; k < size; ++k)
+	{
+		const double phase = -2.0 * M_PI * double(k) / double(size);
+		forwardTwiddles[k] = std::polar(1.0, phase);
+		inverseTwiddles[k] = std::conj(forwardTwiddles[k]);
+	}
+}
+
+std::shared_ptr <const FFTPlan> FFTPlan::get(const std::size_t size)
+{
+	static std::mutex mutex;
+	static std::map <std::size_t, std::shared_ptr <const FFTPlan>> cache;
+
+	std::lock_guard <std::mutex> lock(mutex);
+	std::shared_ptr <const FFTPlan>& plan = cache[size];
+	if (!plan)
+	{
+		plan.reset(new FFTPlan(size));
+	}
+	return plan;
+}
+
+std::size_t FFTPlan::getSize() const
+{
+	return size;
+}
+
+const std::vector <std::size_t>& FFTPlan::getFactors() const
+{
+	return factors;
+}
+
+const Complex* FFTPlan::getTwiddles(const bool inverse) const
+{
+	return inverse ? inverseTwiddles.data() : forwardTwiddles.data();
+}
+
+std::size_t FFTPlan::getLargestRadix() const
+{
+	return largestRadix;
+}
+
+// Butterflies. 'output' holds 'radix' interleaved sub-transforms of length m, twiddles
+// advance by 'stride' per element. Written on scalar real and imaginary parts so the
+// compiler can keep them in registers and vectorise the independent multiplies.
+
+static void butterfly2(Complex* output, const std::size_t stride, const Complex* twiddles, const std::size_t m)
+{
+	Complex* a = output;
+	Complex* b = output + m;
+	const Complex* tw = twiddles;
+	for (std::size_t k = 0; k < m; ++k)
+	{
+		const Complex t = b[k] * *tw;
+		tw += stride;
+		b[k] = a[k] - t;
+		a[k] += t;
+	}
+}
+
+static void butterfly3(Complex* output, const std::size_t stride, const Complex* twiddles, const std::size_t m)
+{
+	const double epi3 = twiddles[stride * m].imag();
+	const Complex* tw1 = twiddles;
+	const Complex* tw2 = twiddles;
+	for (std::size_t k = 0; k < m; ++k)
+	{
+		Complex* f = output + k;
+		const Complex s1 = f[m] * *tw1;
+		const Complex s2 = f[2 * m] * *tw2;
+		tw1 += stride;
+		tw2 += 2 * stride;
+		const Complex s3 = s1 + s2;
+		const Complex s0 = (s1 - s2) * epi3;
+		Complex fm = f[0] - s3 * 0.5;
+		f[0] += s3;
+		f[2 * m] = Complex(fm.real() + s0.imag(), fm.imag() - s0.real());
+		fm = Complex(fm.real() - s0.imag(), fm.imag() + s0.real());
+		f[m] = fm;
+	}
+}
+
+static void
+butterfly4(Complex* output, const std::size_t stride, const Complex* twiddles, const std::size_t m, const bool inverse)
+{
+	const Complex* tw1 = twiddles;
+	const Complex* tw2 = twiddles;
+	const Complex* tw3 = twiddles;
+	for (std::size_t k = 0; k < m; ++k)
+	{
+		Complex* f = output + k;
+		const Complex s0 = f[m] * *tw1;
+		const Complex s1 = f[2 * m] * *tw2;
+		const Complex s2 = f[3 * m] * *tw3;
+		tw1 += stride;
+		tw2 += 2 * stride;
+		tw3 += 3 * stride;
+		const Complex s5 = f[0] - s1;
+		const Complex f0 = f[0] + s1;
+		const Complex s3 = s0 + s2;
+		const Complex s4 = s0 - s2;
+		f[2 * m] = f0 - s3;
+		f[0] = f0 + s3;
+		if (inverse)
+		{
+			f[m] = Complex(s5.real() - s4.imag(), s5.imag() + s4.real());
+			f[3 * m] = Complex(s5.real() + s4.imag(), s5.imag() - s4.real());
+		}
+		else
+		{
+			f[m] = Complex(s5.real() + s4.imag(), s5.imag() - s4.real());
+			f[3 * m] = Complex(s5.real() - s4.imag(), s5.imag() + s4.real());
+		}
+	}
+}
+
+static void butterfly5(Complex* output, const std::size_t stride, const Complex* twiddles, const std::size_t m)
+{
+	const Complex ya = twiddles[stride * m];
+	const Complex yb = twiddles[stride * 2 * m];
+	for (std::size_t u = 0; u < m; ++u)
+	{
+		Complex* f = output + u;
+		const Complex s0 = f[0];
+		const Complex s1 = f[m] * twiddles[u * stride];
+		const Complex s2 = f[2 * m] * twiddles[2 * u * stride];
+		const Complex s3 = f[3 * m] * twiddles[3 * u * stride];
+		const Complex s4 = f[4 * m] * twiddles[4 * u * stride];
+
+		const Complex s7 = s1 + s4;
+		const Complex s10 = s1 - s4;
+		const Complex s8 = s2 + s3;
+		const Complex s9 = s2 - s3;
+
+		f[0] = s0 + s7 + s8;
+
+		const Complex s5(s0.real() + s7.real() * ya.real() + s8.real() * yb.real(),
+				s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real());
+		const Complex s6(s10.imag() * ya.imag() + s9.imag() * yb.imag(),
+				-s10.real() * ya.imag() - s9.real() * yb.imag());
+		f[m] = s5 - s6;
+		f[4 * m] = s5 + s6;
+
+		const Complex s11(s0.real() + s7.real() * yb.real() + s8.real() * ya.real(),
+				s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real());
+		const Complex s12(-s10.imag() * yb.imag() + s9.imag() * ya.imag(),
+				s10.real() * yb.imag() - s9.real() * ya.imag());
+		f[2 * m] = s11 + s12;
+		f[3 * m] = s11 - s12;
+	}
+}
+
+static void butterflyGeneric(Complex* output, const std::size_t stride, const Complex* twiddles, const std::size_t m,
+		const std::size_t radix, const std::size_t size, Complex* scratch)
+{
+	for (std::size_t u = 0; u < m; ++u)
+	{
+		std::size_t k = u;
+		for (std::size_t q = 0; q < radix; ++q, k += m)
+		{
+			scratch[q] = output[k];
+		}
+		k = u;
+		for (std::size_t q = 0; q < radix; ++q, k += m)
+		{
+			std::size_t twiddle = 0;
+			Complex sum = scratch[0];
+			for (std::size_t j = 1; j < radix; ++j)
+			{
+				twiddle += stride * k;
+				if (twiddle >= size)
+				{
+					twiddle -= size;
+				}
+				sum += scratch[j] * twiddles[twiddle];
+			}
+			output[k] = sum;
+		}
+	}
+}
+
+FFT::FFT(const std::size_t _size)
+{
+	setup(_size);
+}
+
+void FFT::setup(const std::size_t _size)
+{
+	assert(_size >= 2 && _size % 2 == 0);
+	size = _size;
+	const std::size_t half = size / 2;
+	plan = FFTPlan::get(half);
+
+	superTwiddles.resize(half / 2 + 1);
+	for (std::size_t k = 0; k < superTwiddles.size(); ++k)
+	{
+		const double phase = -M_PI * (double(k + 1) / double(half) + 0.5);
+		superTwiddles[k] = std::polar(1.0, phase);
+	}
+
+	packed.assign(half, Complex());
+	transformed.assign(half, Complex());
+	scratch.assign(std::max <std::size_t>(plan->getLargestRadix(), 1), Complex());
+}
+
+void FFT::stage(Complex* output, const Complex* input, const std::size_t stride, const std::size_t* factors,
+		const Complex* twiddles, const bool inverse)
+{
+	const std::size_t radix = factors[0];
+	const std::size_t m = factors[1];
+	Complex* const begin = output;
+	Complex* const end = output + radix * m;
+
+	if (m == 1)
+	{
+		for (; output != end; ++output, input += stride)
+		{
+			*output = *input;
+		}
+	}
+	else
+	{
+		for (; output != end; output += m, input += stride)
+		{
+			stage(output, input, stride * radix, factors + 2, twiddles, inverse);
+		}
+	}
+
+	switch (radix)
+	{
+	case 2:
+		butterfly2(begin, stride, twiddles, m);
+		break;
+	case 3:
+		butterfly3(begin, stride, twiddles, m);
+		break;
+	case 4:
+		butterfly4(begin, stride, twiddles, m, inverse);
+		break;
+	case 5:
+		butterfly5(begin, stride, twiddles, m);
+		break;
+	default:
+		butterflyGeneric(begin, stride, twiddles, m, radix, plan->getSize(), scratch.data());
+		break;
+	}
+}
+
+void FFT::transform(const Complex* input, Complex* output, const bool inverse)
+{
+	if (plan->getSize() == 1)
+	{
+		output[0] = input[0];
+		return;
+	}
+	stage(output, input, 1, plan->getFactors().data(), plan->getTwiddles(inverse), inverse);
+}
+
+void FFT::forward(const double* input, Complex* output)
+{
+	const std::size_t half = size / 2;
+
+	// Even samples in the real part, odd in the imaginary part.
+	for (std::size_t k = 0; k < half; ++k)
+	{
+		packed[k] = Complex(input[2 * k], input[2 * k + 1]);
+	}
+	transform(packed.data(), transformed.data(), false);
+
+	const Complex dc = transformed[0];
+	output[0] = Complex(dc.real() + dc.imag(), 0.0);
+	output[half] = Complex(dc.real() - dc.imag(), 0.0);
+
+	for (std::size_t k = 1; k <= half / 2; ++k)
+	{
+		const Complex fpk = transformed[k];
+		const Complex fpnk = std::conj(transformed[half - k]);
+		const Complex f1k = fpk + fpnk;
+		const Complex f2k = fpk - fpnk;
+		const Complex tw = f2k * superTwiddles[k - 1];
+		output[k] = (f1k + tw) * 0.5;
+		output[half - k] = std::conj(f1k - tw) * 0.5;
+	}
+}
+
+void FFT::inverse(const Complex* input, double* output)
+{
+	const std::size_t half = size / 2;
+
+	packed[0] = Complex(input[0].real() + input[half].real(), input[0].real() - input[half].real());
+	for (std::size_t k = 1; k <= half / 2; ++k)
+	{
+		const Complex fk = input[k];
+		const Complex fnkc = std::conj(input[half - k]);
+		const Complex fek = fk + fnkc;
+		const Complex fok = (fk - fnkc) * std::conj(superTwiddles[k - 1]);
+		packed[k] = fek + fok;
+		packed[half - k] = std::conj(fek - fok);
+	}
+	transform(packed.data(), transformed.data(), true);
+
+	const double scale = 1.0 / double(size);
+	for (std::size_t k = 0; k < half; ++k)
+	{
+		output[2 * k] = transformed[k].real() * scale;
+		output[2 * k + 1] = transformed[k].imag() * scale;
+	}
+}
+
+std::size_t FFT::getSize() const
+{
+	return size;
+}
+
+std::size_t FFT::getNumBins() const
+{
+	return size / 2 + 1;
+}
@@ -0,0 +1,460 @@
+#include "Spectral/PhaseVocoder.hpp"
+#include "Spectral/Window.hpp"
+
+#include <map>
+#include <cmath>
+#include <mutex>
+#include <tuple>
+#include <cassert>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	constexpr double TWO_PI = 2.0 * M_PI;
+
+	// Frames of recent spectral flux a new frame is compared against.
+	constexpr std::size_t FLUX_HISTORY = 8;
+
+	double wrapPhase(const double phase)
+	{
+		return std::remainder(phase, TWO_PI);
+	}
+}
+
+PhaseVocoderAnalysis::PhaseVocoderAnalysis(const Clip& clip, const std::size_t _fftSize,
+		const std::size_t _hopSize) : source(clip.getSampleData()), fftSize(_fftSize), hopSize(_hopSize)
+{
+	assert(fftSize % hopSize == 0 && fftSize / hopSize >= 2);
+
+	FFT fft(fftSize);
+	bins = fft.getNumBins();
+
+	// Frame t starts at (t - preroll) * hop, so every sample is covered by
+	// fftSize / hop frames, the first ones included.
+	const SampleBuffer& data = clip.getData();
+	const std::size_t length = data.getNumFrames();
+	const std::size_t preroll = fftSize / hopSize - 1;
+	frames = (length + hopSize - 1) / hopSize + preroll;
+
+	magnitudes.resize(frames * bins);
+	phases.resize(frames * bins);
+	frequencies.resize(frames * bins);
+	transients.assign(frames, 0);
+
+	std::vector <double> window(fftSize);
+	Window::fill(Window::Type::Hann, window.data(), fftSize);
+
+	std::vector <double> frame(fftSize);
+	std::vector <Complex> spectrum(bins);
+	std::vector <double> flux(frames, 0.0);
+
+	for (std::size_t t = 0; t < frames; ++t)
+	{
+		const long start = long(t * hopSize) - long(preroll * hopSize);
+		const std::size_t skipped = start < 0 ? std::size_t(-start) : 0;
+		std::fill(frame.begin(), frame.begin() + std::min(skipped, fftSize), 0.0);
+		if (skipped < fftSize)
+		{
+			data.read(clip.getReadChannel(), std::size_t(start + long(skipped)), fftSize - skipped,
+					frame.data() + skipped);
+		}
+		for (std::size_t n = 0; n < fftSize; ++n)
+		{
+			frame[n] *= window[n];
+		}
+		fft.forward(frame.data(), spectrum.data());
+
+		float* magnitude = magnitudes.data() + t * bins;
+		float* phase = phases.data() + t * bins;
+		float* frequency = frequencies.data() + t * bins;
+		for (std::size_t k = 0; k < bins; ++k)
+		{
+			const double binFrequency = TWO_PI * double(k) / double(fftSize);
+			magnitude[k] = float(std::abs(spectrum[k]));
+			phase[k] = float(std::arg(spectrum[k]));
+
+			if (t == 0)
+			{
+				frequency[k] = float(binFrequency);
+				continue;
+			}
+
+			// The deviation from the phase advance expected of the bin centre,
+			// wrapped to its principal value, gives the true frequency.
+			const double previousPhase = phases[(t - 1) * bins + k];
+			const double deviation = wrapPhase(phase[k] - previousPhase - binFrequency * double(hopSize));
+			frequency[k] = float(binFrequency + deviation / double(hopSize));
+
+			const double rise = double(magnitude[k]) - double(magnitudes[(t - 1) * bins + k]);
+			if (rise > 0.0)
+			{
+				flux[t] += rise;
+			}
+		}
+	}
+
+	detectTransients(flux);
+}
+
+void PhaseVocoderAnalysis::detectTransients(const std::vector <double>& flux)
+{
+	const double loudest = frames > 0 ? *std::max_element(flux.begin(), flux.end()) : 0.0;
+	// Ignore the flux of near silence, which is all relative noise.
+	const double floor = loudest * 1e-3;
+
+	for (std::size_t t = 1; t < frames; ++t)
+	{
+		const std::size_t first = t > FLUX_HISTORY ? t - FLUX_HISTORY : 0;
+		double average = 0.0;
+		for (std::size_t h = first; h < t; ++h)
+		{
+			average += flux[h];
+		}
+		average /= double(t - first);
+
+		const bool peak = t + 1 >= frames || flux[t] >= flux[t + 1];
+		if (peak && flux[t] > floor && flux[t] > TRANSIENT_THRESHOLD * average && !transients[t - 1])
+		{
+			transients[t] = 1;
+		}
+	}
+}
+
+std::shared_ptr <const PhaseVocoderAnalysis>
+PhaseVocoderAnalysis::get(const Clip& clip, const std::size_t fftSize, const std::size_t hopSize)
+{
+	using Key = std::tuple <const SampleData*, int, std::size_t, std::size_t>;
+
+	static std::mutex mutex;
+	static std::map <Key, std::weak_ptr <const PhaseVocoderAnalysis>> cache;
+
+	// A live analysis holds its sample data, so no other data can be at that address while the entry is live.
+	const Key key{ clip.getSampleData().get(), clip.getReadChannel(), fftSize, hopSize };
+
+	std::lock_guard <std::mutex> lock(mutex);
+
+	auto found = cache.find(key);
+	if (found != cache.end())
+	{
+		if (auto shared = found->second.lock())
+		{
+			return shared;
+		}
+	}
+
+	// Drop the entries of analyses nobody holds any more.
+	for (auto entry = cache.begin(); entry != cache.end();)
+	{
+		entry = entry->second.expired() ? cache.erase(entry) : std::next(entry);
+	}
+
+	std::shared_ptr <const PhaseVocoderAnalysis> analysis(new PhaseVocoderAnalysis(clip, fftSize, hopSize));
+	cache[key] = analysis;
+	return analysis;
+}
+
+std::size_t PhaseVocoderAnalysis::getFFTSize() const
+{
+	return fftSize;
+}
+
+std::size_t PhaseVocoderAnalysis::getHopSize() const
+{
+	return hopSize;
+}
+
+std::size_t PhaseVocoderAnalysis::getNumBins() const
+{
+	return bins;
+}
+
+std::size_t PhaseVocoderAnalysis::getNumFrames() const
+{
+	return frames;
+}
+
+const float* PhaseVocoderAnalysis::getMagnitudes(const std::size_t frame) const
+{
+	return magnitudes.data() + frame * bins;
+}
+
+const float* PhaseVocoderAnalysis::getPhases(const std::size_t frame) const
+{
+	return phases.data() + frame * bins;
+}
+
+const float* PhaseVocoderAnalysis::getFrequencies(const std::size_t frame) const
+{
+	return frequencies.data() + frame * bins;
+}
+
+bool PhaseVocoderAnalysis::isTransient(const std::size_t frame) const
+{
+	return transients[frame] != 0;
+}
+
+void PhaseVocoder::setClip(const Clip& clip, const std::size_t fftSize, const std::size_t hopSize)
+{
+	analysis = PhaseVocoderAnalysis::get(clip, fftSize, hopSize);
+
+	fft.setup(fftSize);
+	const std::size_t bins = fft.getNumBins();
+
+	window.resize(fftSize);
+	Window::fill(Window::Type::Hann, window.data(), fftSize);
+
+	frame.assign(fftSize, 0.0);
+	spectrum.assign(bins, Complex());
+	magnitude.assign(bins, 0.0);
+	peaks.assign(bins, 0);
+	synthesisPhase.assign(bins, 0.0);
+	shiftedMagnitude.assign(bins, 0.0);
+	shiftedPhase.assign(bins, 0.0);
+	overlap.assign(fftSize, 0.0);
+	ready.assign(hopSize, 0.0);
+
+	double energy = 0.0;
+	for (double w : window)
+	{
+		energy += w * w;
+	}
+	synthesisGain = double(hopSize) / energy;
+
+	trigger();
+}
+
+void PhaseVocoder::synthesise()
+{
+	const std::size_t hopSize = ready.size();
+	const std::size_t frames = analysis->getNumFrames();
+	const std::size_t preroll = frame.size() / hopSize - 1;
+	// Frames of the clip body, the range playback loops over.
+	const double body = double(frames - preroll);
+
+	// Position is where the output block starts in the clip. The frame read
+	// is the one whose centre lands on the centre of this output frame, half
+	// a window on at 'speed', so the stretch keeps everything where it was.
+	const double centre = double(frame.size()) / double(2 * hopSize);
+	double read = position + centre * (speed - 1.0);
+	if (looping)
+	{
+		if (read >= double(preroll) + body)
+		{
+			read -= body;
+		}
+		else if (speed < 0.0 && read < double(preroll))
+		{
+			read += body;
+		}
+	}
+
+	// Before the clip (in the pre-roll of a fast start) or past it there is nothing to add.
+	if (playing && frames > preroll && read >= 0.0 && read <= double(frames - 1))
+	{
+		const std::size_t bins = spectrum.size();
+		const std::size_t current = std::size_t(read);
+		const std::size_t next = std::min(current + 1, frames - 1);
+		const double fraction = read - double(current);
+
+		// Seed phases from the analysis on the first frame, after a jump, and
+		// whenever playback has crossed the onset of a transient.
+		bool reseed = lastFrame == SIZE_MAX || current < lastFrame;
+		for (std::size_t t = lastFrame + 1; !reseed && t <= current; ++t)
+		{
+			reseed = analysis->isTransient(t);
+		}
+		lastFrame = current;
+
+		const float* magnitudeA = analysis->getMagnitudes(current);
+		const float* magnitudeB = analysis->getMagnitudes(next);
+		const float* frequencyA = analysis->getFrequencies(current);
+		const float* frequencyB = analysis->getFrequencies(next);
+		const float* phase = analysis->getPhases(fraction < 0.5 ? current : next);
+
+		std::size_t numPeaks = 0;
+		for (std::size_t k = 0; k < bins; ++k)
+		{
+			magnitude[k] = magnitudeA[k] + fraction * (magnitudeB[k] - magnitudeA[k]);
+		}
+		for (std::size_t k = 1; k + 1 < bins; ++k)
+		{
+			if (magnitude[k] > magnitude[k - 1] && magnitude[k] >= magnitude[k + 1])
+			{
+				peaks[numPeaks++] = k;
+			}
+		}
+
+		// Bins nobody moves into keep turning at their own centre frequency.
+		std::fill(shiftedMagnitude.begin(), shiftedMagnitude.end(), 0.0);
+		for (std::size_t k = 0; k < bins; ++k)
+		{
+			shiftedPhase[k] = synthesisPhase[k] + TWO_PI * double(k) / double(frame.size()) * double(hopSize);
+		}
+
+		// Each peak moves with the bins around it (up to halfway to its
+		// neighbours) as one block. Only the peak's phase is propagated, the
+		// others keep their analysed offset from it, so the shape of the
+		// partial survives the shift and the stretch.
+		for (std::size_t p = 0; p < numPeaks; ++p)
+		{
+			const std::size_t peak = peaks[p];
+			const std::size_t low = p == 0 ? 0 : (peaks[p - 1] + peak + 1) / 2;
+			const std::size_t high = p + 1 == numPeaks ? bins : (peak + peaks[p + 1] + 1) / 2;
+
+			const std::size_t target = std::size_t(double(peak) * pitch + 0.5);
+			if (target >= bins)
+			{
+				break;
+			}
+
+			double peakPhase = phase[peak];
+			if (!reseed)
+			{
+				const double frequency = frequencyA[peak] + fraction * (frequencyB[peak] - frequencyA[peak]);
+				peakPhase = synthesisPhase[target] + frequency * pitch * double(hopSize);
+			}
+
+			for (std::size_t k = low; k < high; ++k)
+			{
+				const std::ptrdiff_t shifted = std::ptrdiff_t(k) + std::ptrdiff_t(target) - std::ptrdiff_t(peak);
+				if (shifted < 0 || shifted >= std::ptrdiff_t(bins))
+				{
+					continue;
+				}
+				shiftedMagnitude[shifted] += magnitude[k];
+				shiftedPhase[shifted] = peakPhase + phase[k] - phase[peak];
+			}
+		}
+
+		for (std::size_t k = 0; k < bins; ++k)
+		{
+			synthesisPhase[k] = wrapPhase(shiftedPhase[k]);
+			spectrum[k] = std::polar(shiftedMagnitude[k], synthesisPhase[k]);
+		}
+
+		fft.inverse(spectrum.data(), frame.data());
+		for (std::size_t n = 0; n < frame.size(); ++n)
+		{
+			overlap[n] += frame[n] * window[n] * synthesisGain;
+		}
+	}
+
+	if (playing && frames > preroll)
+	{
+		position += speed;
+		if (looping)
+		{
+			if (position >= double(preroll) + body)
+			{
+				position -= body;
+			}
+			else if (speed < 0.0 && position < double(preroll))
+			{
+				position += body;
+			}
+		}
+		else
+		{
+			const double after = position + centre * (speed - 1.0);
+			if (speed >= 0.0 ? after > double(frames - 1) : after < 0.0)
+			{
+				playing = false;
+			}
+		}
+	}
+
+	std::copy(overlap.begin(), overlap.begin() + hopSize, ready.begin());
+	std::copy(overlap.begin() + hopSize, overlap.end(), overlap.begin());
+	std::fill(overlap.end() - hopSize, overlap.end(), 0.0);
+	readyRead = 0;
+}
+
+double PhaseVocoder::play()
+{
+	if (readyRead == ready.size())
+	{
+		synthesise();
+	}
+	return ready[readyRead++];
+}
+
+void PhaseVocoder::process(double* output, std::size_t frames)
+{
+	while (frames > 0)
+	{
+		if (readyRead == ready.size())
+		{
+			synthesise();
+		}
+		const std::size_t chunk = std::min(frames, ready.size() - readyRead);
+		std::copy(ready.begin() + readyRead, ready.begin() + readyRead + chunk, output);
+		readyRead += chunk;
+		output += chunk;
+		frames -= chunk;
+	}
+}
+
+void PhaseVocoder::trigger()
+{
+	setPosition(0.0);
+}
+
+double PhaseVocoder::getPosition() const
+{
+	if (!analysis || analysis->getNumFrames() == 0)
+	{
+		return 0.0;
+	}
+	const double preroll = double(frame.size() / ready.size() - 1);
+	const double body = double(analysis->getNumFrames()) - preroll;
+	return std::clamp((position - preroll) / body, 0.0, 1.0);
+}
+
+bool PhaseVocoder::isPlaying() const
+{
+	return playing;
+}
+
+void PhaseVocoder::setSpeed(const double _speed)
+{
+	speed = _speed;
+}
+
+void PhaseVocoder::setPitch(const double _pitch)
+{
+	pitch = std::max(_pitch, 0.0);
+}
+
+void PhaseVocoder::setPosition(const double _position)
+{
+	if (!analysis)
+	{
+		return;
+	}
+
+	const std::size_t hopSize = ready.size();
+	const std::size_t preroll = frame.size() / hopSize - 1;
+	const double body = double(analysis->getNumFrames() - preroll);
+
+	std::fill(overlap.begin(), overlap.end(), 0.0);
+	std::fill(synthesisPhase.begin(), synthesisPhase.end(), 0.0);
+	position = double(preroll) + std::clamp(_position, 0.0, 1.0) * body - double(preroll) * speed;
+	playing = true;
+	lastFrame = SIZE_MAX;
+
+	// Run the frames that only overlap output before the new position, as
+	// far back as playback at 'speed' would have read them, so the next
+	// output sample is the one at the position, without latency.
+	for (std::size_t t = 0; t < preroll; ++t)
+	{
+		synthesise();
+	}
+	readyRead = hopSize;
+}
+
+void PhaseVocoder::setLooping(const bool _looping)
+{
+	looping = _looping;
+}
@@ -0,0 +1,156 @@
+#include "Spectral/STFT.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+using namespace Maximilian;
+
+STFT::STFT(const std::size_t _fftSize, const std::size_t _windowSize, const std::size_t _hopSize,
+		const Window::Type type)
+{
+	setup(_fftSize, _windowSize, _hopSize, type);
+}
+
+void STFT::setup(const std::size_t _fftSize, const std::size_t _windowSize, const std::size_t _hopSize,
+		const Window::Type type)
+{
+	assert(_windowSize <= _fftSize && _hopSize > 0 && _hopSize <= _windowSize);
+
+	fftSize = _fftSize;
+	windowSize = _windowSize;
+	hopSize = _hopSize;
+
+	fft.setup(fftSize);
+
+	window.resize(windowSize);
+	Window::fill(type, window.data(), windowSize);
+
+	inputRing.assign(windowSize, 0.0);
+	frame.assign(fftSize, 0.0);
+	spectrum.assign(fft.getNumBins(), Complex());
+	magnitudes.assign(fft.getNumBins(), 0.0);
+	phases.assign(fft.getNumBins(), 0.0);
+	overlap.assign(windowSize, 0.0);
+	ready.assign(hopSize, 0.0);
+
+	// The window is applied on the way in and on the way out, so each output sample
+	// is the sum of w^2 over the frames that overlap it, which only averages
+	// sum(w^2) / hop and ripples at the hop rate unless w^2 overlap-adds to a
+	// constant. Dividing each position by its own sum restores unity gain at any hop.
+	synthesisGain.assign(hopSize, 0.0);
+	for (std::size_t n = 0; n < windowSize; ++n)
+	{
+		synthesisGain[n % hopSize] += window[n] * window[n];
+	}
+	for (double& gain : synthesisGain)
+	{
+		gain = gain > 1e-9 ? 1.0 / gain : 0.0;
+	}
+
+	reset();
+}
+
+void STFT::reset()
+{
+	std::fill(inputRing.begin(), inputRing.end(), 0.0);
+	std::fill(overlap.begin(), overlap.end(), 0.0);
+	std::fill(ready.begin(), ready.end(), 0.0);
+	inputWrite = 0;
+	hopCount = 0;
+	readyRead = hopSize;
+}
+
+void STFT::analyse()
+{
+	// Oldest sample first: the ring's write position is the oldest entry.
+	const std::size_t head = windowSize - inputWrite;
+	for (std::size_t n = 0; n < head; ++n)
+	{
+		frame[n] = inputRing[inputWrite + n] * window[n];
+	}
+	for (std::size_t n = head; n < windowSize; ++n)
+	{
+		frame[n] = inputRing[n - head] * window[n];
+	}
+	std::fill(frame.begin() + windowSize, frame.end(), 0.0);
+	fft.forward(frame.data(), spectrum.data());
+}
+
+void STFT::synthesise()
+{
+	fft.inverse(spectrum.data(), frame.data());
+	for (std::size_t n = 0; n < windowSize; ++n)
+	{
+		overlap[n] += frame[n] * window[n];
+	}
+
+	// The oldest hop samples will get no more contributions.
+	for (std::size_t n = 0; n < hopSize; ++n)
+	{
+		ready[n] = overlap[n] * synthesisGain[n];
+	}
+	std::copy(overlap.begin() + hopSize, overlap.end(), overlap.begin());
+	std::fill(overlap.end() - hopSize, overlap.end(), 0.0);
+	readyRead = 0;
+}
+
+void STFT::updatePolar()
+{
+	for (std::size_t k = 0; k < spectrum.size(); ++k)
+	{
+		magnitudes[k] = std::abs(spectrum[k]);
+		phases[k] = std::arg(spectrum[k]);
+	}
+}
+
+bool STFT::process(const double sample)
+{
+	if (!push(sample))
+	{
+		return false;
+	}
+	analyse();
+	updatePolar();
+	return true;
+}
+
+const std::vector <Complex>& STFT::getSpectrum() const
+{
+	return spectrum;
+}
+
+const std::vector <double>& STFT::getMagnitudes() const
+{
+	return magnitudes;
+}
+
+const std::vector <double>& STFT::getPhases() const
+{
+	return phases;
+}
+
+std::size_t STFT::getNumBins() const
+{
+	return spectrum.size();
+}
+
+std::size_t STFT::getFFTSize() const
+{
+	return fftSize;
+}
+
+std::size_t STFT::getWindowSize() const
+{
+	return windowSize;
+}
+
+std::size_t STFT::getHopSize() const
+{
+	return hopSize;
+}
+
+std::size_t STFT::getLatency() const
+{
+	return windowSize - 1;
+}
@@ -0,0 +1,55 @@
+#include "Spectral/Window.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+void Window::fill(const Type type, double* table, const std::size_t size)
+{
+	for (std::size_t n = 0; n < size; ++n)
+	{
+		const double phase = 2.0 * M_PI * double(n) / double(size);
+		switch (type)
+		{
+		case Type::Hann:
+			table[n] = 0.5 - 0.5 * std::cos(phase);
+			break;
+		case Type::Hamming:
+			table[n] = 0.54 - 0.46 * std::cos(phase);
+			break;
+		case Type::Blackman:
+			table[n] = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+			break;
+		case Type::Rectangular:
+		default:
+			table[n] = 1.0;
+			break;
+		}
+	}
+}
+
+void Window::fillKaiser(double* table, const std::size_t size, const double beta)
+{
+	const double normal = 1.0 / besselI0(beta);
+	const double middle = double(size - 1) / 2.0;
+	for (std::size_t n = 0; n < size; ++n)
+	{
+		const double x = middle > 0.0 ? (double(n) - middle) / middle : 0.0;
+		table[n] = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - x * x))) * normal;
+	}
+}
+
+double Window::besselI0(const double x)
+{
+	// Power series, converges quickly for the arguments windows use.
+	const double half = x / 2.0;
+	double term = 1.0;
+	double sum = 1.0;
+	for (int k = 1; k < 64 && term > sum * 1e-17; ++k)
+	{
+		term *= (half / k) * (half / k);
+		sum += term;
+	}
+	return sum;
+}
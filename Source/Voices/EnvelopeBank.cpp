@@ -0,0 +1,284 @@
+#include "Voices/EnvelopeBank.hpp"
+#include "Definition/Settings.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Maximilian;
+
+namespace
+{
+	// What is left of the distance at the end of an exponential segment, -60 dB.
+	constexpr double EXPONENTIAL_REMAINDER = 0.001;
+}
+
+EnvelopeBank::Shape EnvelopeBank::Shape::adsr(const double attack, const double decay, const double sustainLevel,
+		const double release, const Curve curve)
+{
+	Shape shape;
+	shape.segments = {
+			{ 1.0, attack, Curve::Linear },
+			{ sustainLevel, decay, curve },
+			{ sustainLevel, 0.0, Curve::Linear },
+			{ 0.0, release, curve }};
+	shape.sustain = 2;
+	return shape;
+}
+
+EnvelopeBank::Shape EnvelopeBank::Shape::ar(const double attack, const double release, const Curve curve)
+{
+	Shape shape;
+	shape.segments = {
+			{ 1.0, attack, curve },
+			{ 0.0, release, curve }};
+	return shape;
+}
+
+EnvelopeBank::Shape EnvelopeBank::Shape::ramps(const std::vector <double>& pairs)
+{
+	Shape shape;
+	for (std::size_t i = 0; i + 1 < pairs.size(); i += 2)
+	{
+		shape.segments.push_back({ pairs[i + 1], pairs[i] * 1000.0, Curve::Linear });
+	}
+	return shape;
+}
+
+EnvelopeBank::EnvelopeBank(const std::size_t lanes)
+{
+	setup(lanes);
+}
+
+void EnvelopeBank::setup(const std::size_t lanes)
+{
+	levels.assign(lanes, 0.0);
+	multipliers.assign(lanes, 1.0);
+	offsets.assign(lanes, 0.0);
+	targets.assign(lanes, 0.0);
+	remaining.assign(lanes, FOREVER);
+	segments.assign(lanes, 0);
+	shapes.assign(lanes, nullptr);
+	released.assign(lanes, 0);
+	untilNext = FOREVER;
+}
+
+void EnvelopeBank::enter(const std::size_t lane, const std::size_t segment)
+{
+	const Shape& shape = *shapes[lane];
+	segments[lane] = segment;
+	const Segment& next = shape.segments[segment];
+	targets[lane] = next.level;
+
+	// The sustain holds until release().
+	if (segment == shape.sustain && !released[lane])
+	{
+		levels[lane] = next.level;
+		multipliers[lane] = 1.0;
+		offsets[lane] = 0.0;
+		remaining[lane] = FOREVER;
+		return;
+	}
+
+	const auto samples = std::int64_t(std::llround(std::max(next.time, 0.0) * 0.001 * Settings::SAMPLE_RATE));
+	remaining[lane] = samples;
+	if (samples == 0)
+	{
+		return;
+	}
+	if (next.curve == Curve::Exponential)
+	{
+		const double multiplier = std::pow(EXPONENTIAL_REMAINDER, 1.0 / double(samples));
+		multipliers[lane] = multiplier;
+		offsets[lane] = next.level * (1.0 - multiplier);
+	}
+	else
+	{
+		multipliers[lane] = 1.0;
+		offsets[lane] = (next.level - levels[lane]) / double(samples);
+	}
+}
+
+void EnvelopeBank::advance(const std::size_t lane)
+{
+	// Segments end exactly on their level, whatever the rounding on the way.
+	levels[lane] = targets[lane];
+
+	const Shape* shape = shapes[lane];
+	std::size_t segment = segments[lane] + 1;
+	while (shape != nullptr && segment < shape->segments.size())
+	{
+		enter(lane, segment);
+		if (remaining[lane] > 0)
+		{
+			return;
+		}
+		levels[lane] = targets[lane];
+		++segment;
+	}
+
+	// At rest on the last level.
+	shapes[lane] = nullptr;
+	multipliers[lane] = 1.0;
+	offsets[lane] = 0.0;
+	remaining[lane] = FOREVER;
+}
+
+void EnvelopeBank::updateUntilNext()
+{
+	untilNext = FOREVER;
+	for (const std::int64_t samples : remaining)
+	{
+		untilNext = std::min(untilNext, samples);
+	}
+}
+
+void EnvelopeBank::trigger(const std::size_t lane, const Shape& shape)
+{
+	shapes[lane] = &shape;
+	released[lane] = 0;
+	if (shape.segments.empty())
+	{
+		reset(lane);
+		return;
+	}
+	enter(lane, 0);
+	if (remaining[lane] == 0)
+	{
+		advance(lane);
+	}
+	updateUntilNext();
+}
+
+void EnvelopeBank::release(const std::size_t lane)
+{
+	const Shape* shape = shapes[lane];
+	if (shape == nullptr || released[lane])
+	{
+		return;
+	}
+	released[lane] = 1;
+	if (shape->sustain == Shape::NO_SUSTAIN)
+	{
+		return;
+	}
+	// From the level it has reached, not the sustain level.
+	segments[lane] = shape->sustain;
+	targets[lane] = levels[lane];
+	advance(lane);
+	updateUntilNext();
+}
+
+void EnvelopeBank::reset(const std::size_t lane)
+{
+	shapes[lane] = nullptr;
+	levels[lane] = 0.0;
+	targets[lane] = 0.0;
+	multipliers[lane] = 1.0;
+	offsets[lane] = 0.0;
+	remaining[lane] = FOREVER;
+	updateUntilNext();
+}
+
+void EnvelopeBank::process(double* output, const std::size_t frames)
+{
+	const std::size_t lanes = levels.size();
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		const auto run = std::size_t(std::min <std::int64_t>(untilNext, std::int64_t(frames - done)));
+
+		double* __restrict level = levels.data();
+		const double* __restrict multiplier = multipliers.data();
+		const double* __restrict offset = offsets.data();
+		for (std::size_t n = 0; n < run; ++n)
+		{
+			double* __restrict frame = output + (done + n) * lanes;
+			for (std::size_t lane = 0; lane < lanes; ++lane)
+			{
+				level[lane] = level[lane] * multiplier[lane] + offset[lane];
+				frame[lane] = level[lane];
+			}
+		}
+		done += run;
+
+		std::int64_t* __restrict left = remaining.data();
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			left[lane] -= std::int64_t(run);
+		}
+		untilNext -= std::int64_t(run);
+		if (untilNext > 0)
+		{
+			continue;
+		}
+
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (remaining[lane] == 0)
+			{
+				advance(lane);
+			}
+		}
+		// The sample that ended a segment shows its exact level.
+		if (done > 0)
+		{
+			std::copy(levels.begin(), levels.end(), output + (done - 1) * lanes);
+		}
+		updateUntilNext();
+	}
+}
+
+void EnvelopeBank::process(const std::size_t frames)
+{
+	const std::size_t lanes = levels.size();
+	std::size_t done = 0;
+	while (done < frames)
+	{
+		const auto run = std::size_t(std::min <std::int64_t>(untilNext, std::int64_t(frames - done)));
+
+		// The closed form of 'run' steps of the recurrence, for straight lines and curves alike.
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			const double multiplier = multipliers[lane];
+			if (multiplier == 1.0)
+			{
+				levels[lane] += offsets[lane] * double(run);
+			}
+			else
+			{
+				const double target = offsets[lane] / (1.0 - multiplier);
+				levels[lane] = target + (levels[lane] - target) * std::pow(multiplier, double(run));
+			}
+			remaining[lane] -= std::int64_t(run);
+		}
+		done += run;
+		untilNext -= std::int64_t(run);
+		if (untilNext > 0)
+		{
+			continue;
+		}
+		for (std::size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (remaining[lane] == 0)
+			{
+				advance(lane);
+			}
+		}
+		updateUntilNext();
+	}
+}
+
+std::size_t EnvelopeBank::getNumLanes() const
+{
+	return levels.size();
+}
+
+double EnvelopeBank::getLevel(const std::size_t lane) const
+{
+	return levels[lane];
+}
+
+bool EnvelopeBank::isActive(const std::size_t lane) const
+{
+	return shapes[lane] != nullptr;
+}
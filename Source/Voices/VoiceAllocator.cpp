@@ -0,0 +1,191 @@
+#include "Voices/VoiceAllocator.hpp"
+
+#include <algorithm>
+
+using namespace Maximilian;
+
+VoiceAllocator::VoiceAllocator(const std::size_t capacity, const Stealing _stealing) : stealing(_stealing)
+{
+	setup(capacity);
+}
+
+void VoiceAllocator::setup(const std::size_t capacity)
+{
+	voices.assign(capacity, Voice());
+	active.clear();
+	active.reserve(capacity);
+	free.clear();
+	free.reserve(capacity);
+	limit = capacity;
+	reset();
+}
+
+std::size_t VoiceAllocator::victim() const
+{
+	std::size_t chosen = NONE;
+	for (const std::size_t index : active)
+	{
+		const Voice& voice = voices[index];
+		if (voice.state == State::Stolen)
+		{
+			continue;
+		}
+		if (chosen == NONE)
+		{
+			chosen = index;
+			continue;
+		}
+
+		// Voices already on their way out go first.
+		const Voice& best = voices[chosen];
+		const bool releasing = voice.state == State::Releasing;
+		const bool bestReleasing = best.state == State::Releasing;
+		if (releasing != bestReleasing)
+		{
+			if (releasing)
+			{
+				chosen = index;
+			}
+			continue;
+		}
+
+		const bool better = stealing == Stealing::Quietest ? voice.level < best.level : voice.age < best.age;
+		if (better)
+		{
+			chosen = index;
+		}
+	}
+	return chosen;
+}
+
+std::size_t VoiceAllocator::noteOn(const double note)
+{
+	std::size_t index = NONE;
+	if (!free.empty())
+	{
+		index = free.back();
+		free.pop_back();
+		voices[index].slot = active.size();
+		active.push_back(index);
+		voices[index].state = State::Playing;
+	}
+	else if (stealing != Stealing::None)
+	{
+		index = victim();
+		if (index == NONE)
+		{
+			return NONE;
+		}
+		voices[index].state = State::Stolen;
+	}
+	else
+	{
+		return NONE;
+	}
+
+	Voice& voice = voices[index];
+	voice.note = note;
+	voice.age = counter++;
+	voice.released = false;
+	return index;
+}
+
+VoiceAllocator::State VoiceAllocator::start(const std::size_t voice)
+{
+	Voice& stolen = voices[voice];
+	stolen.state = stolen.released ? State::Releasing : State::Playing;
+	stolen.released = false;
+	return stolen.state;
+}
+
+void VoiceAllocator::release(const std::size_t voice)
+{
+	if (voices[voice].state == State::Playing)
+	{
+		voices[voice].state = State::Releasing;
+	}
+	else if (voices[voice].state == State::Stolen)
+	{
+		voices[voice].released = true;
+	}
+}
+
+void VoiceAllocator::retire(const std::size_t voice)
+{
+	Voice& retired = voices[voice];
+	if (retired.state == State::Free)
+	{
+		return;
+	}
+
+	// The last entry takes the retired one's place.
+	const std::size_t last = active.back();
+	active[retired.slot] = last;
+	voices[last].slot = retired.slot;
+	active.pop_back();
+
+	retired.state = State::Free;
+	retired.level = 0.0;
+	free.push_back(voice);
+}
+
+void VoiceAllocator::reset()
+{
+	for (Voice& voice : voices)
+	{
+		voice = Voice();
+	}
+	active.clear();
+	free.clear();
+	// Lowest indices handed out first.
+	for (std::size_t i = limit; i-- > 0;)
+	{
+		free.push_back(i);
+	}
+}
+
+std::size_t VoiceAllocator::getNumActive() const
+{
+	return active.size();
+}
+
+std::size_t VoiceAllocator::getCapacity() const
+{
+	return voices.size();
+}
+
+std::size_t VoiceAllocator::getLimit() const
+{
+	return limit;
+}
+
+VoiceAllocator::State VoiceAllocator::getState(const std::size_t voice) const
+{
+	return voices[voice].state;
+}
+
+double VoiceAllocator::getNote(const std::size_t voice) const
+{
+	return voices[voice].note;
+}
+
+std::size_t VoiceAllocator::getSlot(const std::size_t voice) const
+{
+	return voices[voice].slot;
+}
+
+VoiceAllocator::Stealing VoiceAllocator::getStealing() const
+{
+	return stealing;
+}
+
+void VoiceAllocator::setLimit(const std::size_t _limit)
+{
+	limit = std::min(_limit, voices.size());
+	reset();
+}
+
+void VoiceAllocator::setStealing(const Stealing _stealing)
+{
+	stealing = _stealing;
+}
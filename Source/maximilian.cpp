@@ -32,6 +32,10 @@
  */
 
 #include "Maximilian.hpp"
+#include "Samples/WavFile.hpp"
+#include "Spectral/Window.hpp"
+
+#include <type_traits>
 
 using namespace Maximilian;
 
@@ -609,7 +613,7 @@ double Envelope::ramp(double startVal, double endVal, double duration)
 }
 
 
-double Envelope::ramps(std::vector <double> rampsArray)
+double Envelope::ramps(const std::vector <double>& rampsArray)
 {
 
 	if (trig not_eq 0)
@@ -797,14 +801,31 @@ double Envelope::adsr(double attack, double decay, double sustain, double releas
 	return phase;
 }
 
+DelayLine::DelayLine(std::size_t maximumDelay)
+{
+	reserve(maximumDelay);
+}
+
+void DelayLine::reserve(std::size_t maximumDelay)
+{
+	memory.reserve(maximumDelay + 1, writeIndex);
+}
+
 double DelayLine::dl(double input, int size, double feedback)
 {
+	if (size < 1)
+	{ size = 1; }
+	// Growing would allocate on the audio thread, play the longest delay reserved instead.
+	if ((std::size_t)size >= memory.getCapacity())
+	{ size = int(memory.getCapacity() - 1); }
 	if (phase >= size)
 	{
 		phase = 0;
 	}
-	output = memory[phase];
-	memory[phase] = (memory[phase] * feedback) + (input * feedback) * 0.5;
+	const std::size_t mask = memory.getMask();
+	output = memory[(writeIndex - size) & mask];
+	memory[writeIndex] = (output * feedback) + (input * feedback) * 0.5;
+	writeIndex = (writeIndex + 1) & mask;
 	phase += 1;
 	return (output);
 
@@ -812,37 +833,51 @@ double DelayLine::dl(double input, int size, double feedback)
 
 double DelayLine::dl(double input, int size, double feedback, int position)
 {
+	if (size < 1)
+	{ size = 1; }
+	// Growing would allocate on the audio thread, play the longest delay reserved instead.
+	if ((std::size_t)size >= memory.getCapacity())
+	{ size = int(memory.getCapacity() - 1); }
 	if (phase >= size)
 	{ phase = 0; }
-	if (position >= size)
+	if (position >= size || position < 0)
 	{ position = 0; }
-	output = memory[position];
-	memory[phase] = (memory[phase] * feedback) + (input * feedback) * chandiv;
+	// position indexes a ring of 'size' slots, the slot being written now is 'phase'.
+	int age = phase - position;
+	if (age <= 0)
+	{ age += size; }
+	const std::size_t mask = memory.getMask();
+	output = memory[(writeIndex - age) & mask];
+	memory[writeIndex] = (memory[(writeIndex - size) & mask] * feedback) + (input * feedback) * chandiv;
+	writeIndex = (writeIndex + 1) & mask;
 	phase += 1;
 	return (output);
 
 }
 
+FractionalDelay::FractionalDelay(std::size_t maximumDelay)
+{
+	reserve(maximumDelay);
+}
+
+void FractionalDelay::reserve(std::size_t maximumDelay)
+{
+	memory.reserve(maximumDelay + 2, writePointer);
+}
+
 double FractionalDelay::dl(double sig, double delayTime, double feedback)
 {
-	// Set delay time
-	delayTime = fmin(fabs(delayTime), DELAY_SIZE);
+	// Set delay time, no longer than the line was reserved for
+	delayTime = fmin(fmin(fabs(delayTime), DELAY_SIZE), double(memory.getCapacity() - 2));
 	int32_t delay = delayTime; // Truncated
 	double fractAmount = delayTime - delay; // Fractional remainder
 	double truncAmount = 1.0f - fractAmount; // Inverse fractional remainder
 
-	// Update read pointer
-	readPointer = writePointer - delay;
-	if (readPointer < 0)
-	{
-		readPointer += DELAY_SIZE;
-	}
+	const std::size_t mask = memory.getMask();
 
-	int readPointerFractPart = readPointer - 1;
-	if (readPointerFractPart < 0)
-	{
-		readPointerFractPart += DELAY_SIZE;
-	}
+	// Read pointers, the second one sample further back for the fractional part
+	const std::size_t readPointer = (writePointer - delay) & mask;
+	const std::size_t readPointerFractPart = (readPointer - 1) & mask;
 
 	// Get interpolated sample
 	double y = memory[readPointer] * truncAmount + memory[readPointerFractPart] * fractAmount;
@@ -851,14 +886,136 @@ double FractionalDelay::dl(double sig, double delayTime, double feedback)
 	memory[writePointer] = y * feedback + sig;
 
 	// Increment write pointer
-	if (++writePointer >= DELAY_SIZE)
+	writePointer = (writePointer + 1) & mask;
+	return y;
+
+}
+
+
+// The block modulation effects share this shape: the LFO is evaluated once per control period,
+// the delay glides linearly to the new value over the period and is read fractionally.
+template <std::size_t Channels>
+static void flangeBlock(Flanger& flanger, ModulatedDelay <Channels>& line, const double* const* input,
+		double* const* output, std::size_t frames, unsigned int delay, double feedback, double speed, double depth)
+{
+	std::size_t n = 0;
+	while (n < frames)
 	{
-		writePointer -= DELAY_SIZE;
+		if (flanger.controlCountdown == 0)
+		{
+			const double lfoVal = flanger.lfo.triangle(speed * Flanger::CONTROL_PERIOD);
+			const double target = delay + (lfoVal * depth * delay) + 1;
+			if (flanger.currentDelay < 0)
+			{ flanger.currentDelay = target; }
+			flanger.delayStep = (target - flanger.currentDelay) / Flanger::CONTROL_PERIOD;
+			flanger.controlCountdown = Flanger::CONTROL_PERIOD;
+		}
+		const std::size_t run = std::min(flanger.controlCountdown, frames - n);
+		for (std::size_t i = n; i < n + run; ++i)
+		{
+			flanger.currentDelay += flanger.delayStep;
+			std::array <double, Channels> x, w;
+			for (std::size_t c = 0; c < Channels; ++c)
+			{ x[c] = input[c][i]; }
+			const std::array <double, Channels> y = line.read(flanger.currentDelay);
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				w[c] = (y[c] * feedback) + (x[c] * feedback) * 0.5;
+				output[c][i] = (y[c] * (1 - fabs(y[c])) + x[c]) / 2.0;
+			}
+			line.write(w);
+		}
+		flanger.controlCountdown -= run;
+		n += run;
 	}
-	return y;
+}
+
+void Flanger::setup(std::size_t maximumDelay)
+{
+	dl.reserve(maximumDelay);
+	line.reserve(maximumDelay);
+	lines.reserve(maximumDelay);
+}
+
+void Flanger::flange(const double* input, double* output, std::size_t frames, unsigned int delay, double feedback,
+		double speed, double depth)
+{
+	flangeBlock(*this, line, &input, &output, frames, delay, feedback, speed, depth);
+}
+
+void Flanger::flange(const double* const* input, double* const* output, std::size_t frames, unsigned int delay,
+		double feedback, double speed, double depth)
+{
+	flangeBlock(*this, lines, input, output, frames, delay, feedback, speed, depth);
+}
+
+template <std::size_t Channels>
+static void chorusBlock(Chorus& chorus, ModulatedDelay <Channels>& line, const double* const* input,
+		double* const* output, std::size_t frames, unsigned int delay, double feedback, double speed, double depth)
+{
+	// Noise filtered at a decimated rate has CONTROL_PERIOD times the bandwidth relative to the
+	// filter, this keeps its level where the per sample version had it. lores never went below 10Hz.
+	const double noiseScale = 1.0 / sqrt(double(Chorus::CONTROL_PERIOD));
+	const double cutoff = fmax(speed, 10.0) * Chorus::CONTROL_PERIOD;
+
+	std::size_t n = 0;
+	while (n < frames)
+	{
+		if (chorus.controlCountdown == 0)
+		{
+			double lfoVal = chorus.lfo.noise() * noiseScale;
+			lfoVal = chorus.lopass.lores(lfoVal, cutoff, 1.0) * 2.0;
+			const double target[2] = { delay + (lfoVal * depth * delay) + 1,
+									   (delay + (lfoVal * depth * delay * 1.02) + 1) * 0.98 };
+			for (int voice = 0; voice < 2; ++voice)
+			{
+				if (chorus.currentDelay[voice] < 0)
+				{ chorus.currentDelay[voice] = target[voice]; }
+				chorus.delayStep[voice] = (target[voice] - chorus.currentDelay[voice]) / Chorus::CONTROL_PERIOD;
+			}
+			chorus.controlCountdown = Chorus::CONTROL_PERIOD;
+		}
+		const std::size_t run = std::min(chorus.controlCountdown, frames - n);
+		for (std::size_t i = n; i < n + run; ++i)
+		{
+			chorus.currentDelay[0] += chorus.delayStep[0];
+			chorus.currentDelay[1] += chorus.delayStep[1];
+			std::array <double, Channels> x, w;
+			for (std::size_t c = 0; c < Channels; ++c)
+			{ x[c] = input[c][i]; }
+			const std::array <double, Channels> y1 = line.read(chorus.currentDelay[0]);
+			const std::array <double, Channels> y2 = line.read(chorus.currentDelay[1]);
+			for (std::size_t c = 0; c < Channels; ++c)
+			{
+				w[c] = (y1[c] * feedback + y2[c] * feedback * 0.99) * 0.5 + (x[c] * feedback) * 0.5;
+				output[c][i] = (y1[c] * (1.0 - fabs(y1[c])) + y2[c] * (1.0 - fabs(y2[c])) + x[c]) / 3.0;
+			}
+			line.write(w);
+		}
+		chorus.controlCountdown -= run;
+		n += run;
+	}
+}
+
+void Chorus::setup(std::size_t maximumDelay)
+{
+	dl.reserve(maximumDelay);
+	dl2.reserve(maximumDelay);
+	line.reserve(maximumDelay);
+	lines.reserve(maximumDelay);
+}
 
+void Chorus::chorus(const double* input, double* output, std::size_t frames, unsigned int delay, double feedback,
+		double speed, double depth)
+{
+	chorusBlock(*this, line, &input, &output, frames, delay, feedback, speed, depth);
 }
 
+void Chorus::chorus(const double* const* input, double* const* output, std::size_t frames, unsigned int delay,
+		double feedback, double speed, double depth)
+{
+	chorusBlock(*this, lines, input, output, frames, delay, feedback, speed, depth);
+}
 
 //I particularly like these. cutoff between 0 and 1
 double Filter::lopass(double input, double cutoff)
@@ -876,9 +1033,14 @@ double Filter::hipass(double input, double cutoff)
 	return (output);
 }
 
-//awesome. cuttof is freq in hz. res is between 1 and whatever. Watch out!
-double Filter::lores(double input, double cutoff1, double resonance)
+// The resonant coefficients only depend on cutoff and resonance, so they are
+// recomputed when either changes rather than on every sample.
+void Filter::updateResonant(double cutoff1, double resonance)
 {
+	if (cutoff1 == resonantCutoff && resonance == resonantQ)
+	{ return; }
+	resonantCutoff = cutoff1;
+	resonantQ = resonance;
 	cutoff = cutoff1;
 	if (cutoff < 10)
 	{ cutoff = 10; }
@@ -888,7 +1050,31 @@ double Filter::lores(double input, double cutoff1, double resonance)
 	{ resonance = 1.; }
 	z = cos(TWOPI * cutoff / Settings::SAMPLE_RATE);
 	c = 2 - 2 * z;
-	double r = (sqrt(2.0) * sqrt(-pow((z - 1.0), 3.0)) + resonance * (z - 1)) / (resonance * (z - 1));
+	const double zm1 = z - 1.0;
+	r = (sqrt(2.0) * sqrt(-(zm1 * zm1 * zm1)) + resonance * zm1) / (resonance * zm1);
+}
+
+void Filter::updateBandpass(double cutoff1, double resonance)
+{
+	if (cutoff1 == bandCutoff && resonance == bandQ)
+	{ return; }
+	bandCutoff = cutoff1;
+	bandQ = resonance;
+	cutoff = cutoff1;
+	if (cutoff > (Maximilian::Settings::SAMPLE_RATE * 0.5))
+	{ cutoff = (Maximilian::Settings::SAMPLE_RATE * 0.5); }
+	if (resonance >= 1.)
+	{ resonance = 0.999999; }
+	z = cos(TWOPI * cutoff / Settings::SAMPLE_RATE);
+	inputs[0] = (1 - resonance) * (sqrt(resonance * (resonance - 4.0 * z * z + 2.0) + 1));
+	inputs[1] = 2 * z * resonance;
+	inputs[2] = resonance * resonance;
+}
+
+//awesome. cuttof is freq in hz. res is between 1 and whatever. Watch out!
+double Filter::lores(double input, double cutoff1, double resonance)
+{
+	updateResonant(cutoff1, resonance);
 	x = x + (input - y) * c;
 	y = y + x;
 	x = x * r;
@@ -899,16 +1085,7 @@ double Filter::lores(double input, double cutoff1, double resonance)
 //working hires filter
 double Filter::hires(double input, double cutoff1, double resonance)
 {
-	cutoff = cutoff1;
-	if (cutoff < 10)
-	{ cutoff = 10; }
-	if (cutoff > (Settings::SAMPLE_RATE))
-	{ cutoff = (Maximilian::Settings::SAMPLE_RATE); }
-	if (resonance < 1.)
-	{ resonance = 1.; }
-	z = cos(TWOPI * cutoff / Settings::SAMPLE_RATE);
-	c = 2 - 2 * z;
-	double r = (sqrt(2.0) * sqrt(-pow((z - 1.0), 3.0)) + resonance * (z - 1)) / (resonance * (z - 1));
+	updateResonant(cutoff1, resonance);
 	x = x + (input - y) * c;
 	y = y + x;
 	x = x * r;
@@ -919,22 +1096,79 @@ double Filter::hires(double input, double cutoff1, double resonance)
 //This works a bit. Needs attention.
 double Filter::bandpass(double input, double cutoff1, double resonance)
 {
-	cutoff = cutoff1;
-	if (cutoff > (Maximilian::Settings::SAMPLE_RATE * 0.5))
-	{ cutoff = (Maximilian::Settings::SAMPLE_RATE * 0.5); }
-	if (resonance >= 1.)
-	{ resonance = 0.999999; }
-	z = cos(TWOPI * cutoff / Settings::SAMPLE_RATE);
-	inputs[0] = (1 - resonance) * (sqrt(resonance * (resonance - 4.0 * pow(z, 2.0) + 2.0) + 1));
-	inputs[1] = 2 * z * resonance;
-	inputs[2] = pow((resonance * -1), 2);
-
+	updateBandpass(cutoff1, resonance);
 	output = inputs[0] * input + inputs[1] * outputs[1] + inputs[2] * outputs[2];
 	outputs[2] = outputs[1];
 	outputs[1] = output;
 	return (output);
 }
 
+void Filter::process(Mode mode, const double* input, double* output, std::size_t frames, double cutoff1,
+		double resonance)
+{
+	if (frames == 0)
+	{ return; }
+
+	const double step = 1.0 / frames;
+
+	if (mode == Mode::BandPass)
+	{
+		const bool first = bandCutoff < 0;
+		double a0 = inputs[0], a1 = inputs[1], a2 = inputs[2];
+		updateBandpass(cutoff1, resonance);
+		if (first)
+		{
+			a0 = inputs[0];
+			a1 = inputs[1];
+			a2 = inputs[2];
+		}
+		const double da0 = (inputs[0] - a0) * step;
+		const double da1 = (inputs[1] - a1) * step;
+		const double da2 = (inputs[2] - a2) * step;
+		double y1 = outputs[1], y2 = outputs[2];
+		for (std::size_t i = 0; i < frames; ++i)
+		{
+			a0 += da0;
+			a1 += da1;
+			a2 += da2;
+			const double out = a0 * input[i] + a1 * y1 + a2 * y2;
+			y2 = y1;
+			y1 = out;
+			output[i] = out;
+		}
+		outputs[1] = y1;
+		outputs[2] = y2;
+		this->output = y1;
+		return;
+	}
+
+	const bool first = resonantCutoff < 0;
+	double cc = c, rr = r;
+	updateResonant(cutoff1, resonance);
+	if (first)
+	{
+		cc = c;
+		rr = r;
+	}
+	const double dc = (c - cc) * step;
+	const double dr = (r - rr) * step;
+	double xs = x, ys = y;
+	const bool high = mode == Mode::HiRes;
+	for (std::size_t i = 0; i < frames; ++i)
+	{
+		cc += dc;
+		rr += dr;
+		const double in = input[i];
+		xs = xs + (in - ys) * cc;
+		ys = ys + xs;
+		xs = xs * rr;
+		output[i] = high ? in - ys : ys;
+	}
+	x = xs;
+	y = ys;
+	this->output = output[frames - 1];
+}
+
 //stereo bus
 double* Mixer::stereo(double input, double two[2], double x)
 {
@@ -1007,23 +1241,25 @@ bool Clip::loadOgg(string fileName, int channel)
 	readChannel=channel;
     int channelx;
 //    cout << fileName << endl;
-    free(temp);
-    myDataSize = stb_vorbis_decode_filename(const_cast<char*>(fileName.c_str()), &channelx, &temp);
+    short* decoded = nullptr;
+    myDataSize = stb_vorbis_decode_filename(const_cast<char*>(fileName.c_str()), &channelx, &decoded);
     result = myDataSize > 0;
     printf("\nchannels = %d\nlength = %d",channelx,myDataSize);
     printf("\n");
     myChannels=(short)channelx;
-    length=myDataSize;
     mySampleRate=44100;
 
-    if (myChannels>1) {
-        int position=0;
-        int channel=readChannel;
-        for (int i=channel;i<myDataSize*2;i+=myChannels) {
-            temp[position]=temp[i];
-            position++;
+    if (result) {
+        auto loaded = std::make_shared<SampleData>();
+        loaded->sampleRate = mySampleRate;
+        result = loaded->buffer.assignInterleaved(decoded, myDataSize, channelx, 16, false, storage);
+        if (result) {
+            editable = loaded.get();
+            sample = std::move(loaded);
+            useSample();
         }
     }
+    free(decoded);
 	return result; // this should probably be something more descriptive
 #else
 	assert(false); // called but VORBIS not defined!
@@ -1031,102 +1267,142 @@ bool Clip::loadOgg(string fileName, int channel)
 	return 0;
 }
 
-//This sets the playback position to the start of a sample
-void Clip::trigger()
+namespace
 {
-	position = 0;
-	recordPosition = 0;
+	//what a clip plays before anything is loaded, shared by all of them
+	const std::shared_ptr <const SampleData>& emptySample()
+	{
+		static const auto empty = std::make_shared <const SampleData>();
+		return empty;
+	}
 }
 
-//This is the main read function.
-bool Clip::read()
+Clip::Clip() : position(0), recordPosition(0), sample(emptySample()), myChannels(1),
+		mySampleRate(Settings::SAMPLE_RATE)
 {
-	bool result;
-	ifstream inFile(myPath.c_str(), ios::in | ios::binary);
-	result = inFile.is_open();
-	if (result)
-	{
-		bool datafound = false;
-		inFile.seekg(4, ios::beg);
-		inFile.read((char*)&myChunkSize, 4); // read the ChunkSize
-
-		inFile.seekg(16, ios::beg);
-		inFile.read((char*)&mySubChunk1Size, 4); // read the SubChunk1Size
+}
 
-		//inFile.seekg(20, ios::beg);
-		inFile.read((char*)&myFormat, sizeof(short)); // read the file format.  This should be 1 for PCM
+SampleData& Clip::edit()
+{
+	if (editable == nullptr || sample.use_count() > 1)
+	{
+		auto copy = std::make_shared <SampleData>(*sample);
+		editable = copy.get();
+		sample = std::move(copy);
+	}
+	return *editable;
+}
 
-		//inFile.seekg(22, ios::beg);
-		inFile.read((char*)&myChannels, sizeof(short)); // read the # of channels (1 or 2)
+void Clip::prepareRecord()
+{
+	//a mapped file would be copied page by page by the kernel as the recording reaches it
+	if (sample->buffer.isAdopted())
+	{
+		editable = nullptr;
+	}
+	edit();
+}
 
-		//inFile.seekg(24, ios::beg);
-		inFile.read((char*)&mySampleRate, sizeof(int)); // read the samplerate
+void Clip::useSample()
+{
+	length = long(sample->buffer.getNumFrames());
+	myChannels = short(std::max <std::size_t>(sample->buffer.getNumChannels(), 1));
+	mySampleRate = sample->sampleRate;
+	myDataSize = int(length * 2 * myChannels);
+	setReadChannel(readChannel);
+	if (position >= length)
+	{
+		position = 0;
+	}
+}
 
-		//inFile.seekg(28, ios::beg);
-		inFile.read((char*)&myByteRate, sizeof(int)); // read the byterate
+std::shared_ptr <const SampleData> Clip::getSampleData() const
+{
+	return sample;
+}
 
-		//inFile.seekg(32, ios::beg);
-		inFile.read((char*)&myBlockAlign, sizeof(short)); // read the blockalign
+void Clip::setSampleData(std::shared_ptr <const SampleData> data)
+{
+	sample = data != nullptr ? std::move(data) : emptySample();
+	editable = nullptr;
+	useSample();
+}
 
-		//inFile.seekg(34, ios::beg);
-		inFile.read((char*)&myBitsPerSample, sizeof(short)); // read the bitspersample
+void Clip::swapSampleData(std::shared_ptr <const SampleData> data)
+{
+	std::shared_ptr <const SampleData> replaced;
+	{
+		std::lock_guard <std::mutex> lock(swapMutex);
+		replaced = std::move(pending);
+		pending = data != nullptr ? std::move(data) : emptySample();
+		swapPending.store(true, std::memory_order_release);
+	}
+	//'replaced' is released here, on the caller's thread
+}
 
-		//ignore any extra chunks
-		char chunkID[5] = "";
-		chunkID[4] = 0;
-		int filePos = 20 + mySubChunk1Size;
-		while (!datafound && !inFile.eof())
-		{
-			inFile.seekg(filePos, ios::beg);
-			inFile.read((char*)&chunkID, sizeof(char) * 4);
-			inFile.seekg(filePos + 4, ios::beg);
-			inFile.read((char*)&myDataSize, sizeof(int)); // read the size of the data
-			filePos += 8;
-			if (strcmp(chunkID, "data") == 0)
-			{
-				datafound = true;
-			}
-			else
-			{
-				filePos += myDataSize;
-			}
-		}
+void Clip::update()
+{
+	if (!swapPending.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	//the other side only holds the lock to exchange two pointers, if it has it now try next time
+	std::unique_lock <std::mutex> lock(swapMutex, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		return;
+	}
+	sample.swap(pending);
+	swapPending.store(false, std::memory_order_relaxed);
+	lock.unlock();
+	editable = nullptr;
+	useSample();
+}
 
-		// read the data chunk
-		char* myData = (char*)malloc(myDataSize * sizeof(char));
-		inFile.seekg(filePos, ios::beg);
-		inFile.read(myData, myDataSize);
-		length = myDataSize * (0.5 / myChannels);
-		inFile.close(); // close the input file
+//This sets the playback position to the start of a sample
+void Clip::trigger()
+{
+	update();
+	position = 0;
+	recordPosition = 0;
+}
 
-		cout << "Ch: " << myChannels << ", len: " << length << endl;
-		if (myChannels > 1)
-		{
-			int position = 0;
-			int channel = readChannel * 2;
-			for (int i = channel; i < myDataSize; i += (myChannels * 2))
-			{
-				myData[position] = myData[i];
-				myData[position + 1] = myData[i + 1];
-				position += 2;
-			}
-		}
-		free(temp);
-		temp = (short*)malloc(myDataSize * sizeof(char));
-		memcpy(temp, myData, myDataSize * sizeof(char));
+//This is the main read function.
+bool Clip::read()
+{
+	//the file is mapped, not read: mono files already in the storage format are used in place
+	WavFile file(myPath);
+	if (!file.isOpen())
+	{
+		printf("ERROR: Could not load sample %s: %s\n", myPath.c_str(), file.getError().c_str());
+		return false;
+	}
 
-		free(myData);
+	myChunkSize = int(std::min <std::uint64_t>(file.getDataSize() + 36, INT32_MAX));
+	mySubChunk1Size = 16;
+	myFormat = short(file.getEncoding() == WavFile::Encoding::Float ? 3 : 1);
+	myChannels = short(file.getNumChannels());
+	mySampleRate = int(file.getSampleRate());
+	myByteRate = int(file.getByteRate());
+	myBlockAlign = short(file.getBlockAlign());
+	myBitsPerSample = short(file.getBitsPerSample());
 
-	}
-	else
+	auto loaded = std::make_shared <SampleData>();
+	loaded->sampleRate = mySampleRate;
+	const bool result = file.map(loaded->buffer, storage) || file.decode(loaded->buffer, storage);
+	if (result)
 	{
-//		cout << "ERROR: Could not load sample: " <<myPath << endl; //This line seems to be hated by windows
-		printf("ERROR: Could not load sample.");
-
+		//writing to a mapped file would fault its pages in, prepareRecord() copies it first
+		editable = loaded->buffer.isAdopted() ? nullptr : loaded.get();
+		sample = std::move(loaded);
+		useSample();
+		myDataSize = int(std::min <std::uint64_t>(file.getDataSize(), INT32_MAX));
 	}
 
+	//build the interpolation tables now rather than in the audio callback
+	SincInterpolator::get(interpolation);
 
-	return result; // this should probably be something more descriptive
+	return result;
 }
 
 //This plays back at the correct speed. Always loops.
@@ -1135,7 +1411,7 @@ double Clip::play()
 	position++;
 	if ((long)position >= length)
 	{ position = 0; }
-	output = (double)temp[(long)position] / 32767.0;
+	output = at((long)position);
 	return output;
 }
 
@@ -1152,7 +1428,7 @@ double Clip::playLoop(double start, double end)
 	{ position = length * start; }
 	if ((long)position >= length * end)
 	{ position = length * start; }
-	output = (double)temp[(long)position] / 32767.0;
+	output = at((long)position);
 	return output;
 }
 
@@ -1161,7 +1437,7 @@ double Clip::playUntil(double end)
 	position++;
 	if ((long)position < length * end)
 	{
-		output = (double)temp[(long)position] / 32767.0;
+		output = at((long)position);
 	}
 	else
 	{
@@ -1177,7 +1453,7 @@ double Clip::playOnce()
 	position++;
 	if ((long)position < length)
 	{
-		output = (double)temp[(long)position] / 32767.0;
+		output = at((long)position);
 	}
 	else
 	{
@@ -1194,8 +1470,8 @@ double Clip::playOnce(double speed)
 	double remainder = position - (long)position;
 	if ((long)position < length)
 	{
-		output = (double)((1 - remainder) * temp[1 + (long)position] + remainder * temp[2 + (long)position]) /
-				 32767;//linear interpolation
+		output = (double)((1 - remainder) * at(1 + (long)position) +
+						  remainder * at(2 + (long)position));//linear interpolation
 	}
 	else
 	{
@@ -1234,7 +1510,7 @@ double Clip::play(double speed)
 			b = length - 1;
 		}
 
-		output = (double)((1 - remainder) * temp[a] + remainder * temp[b]) / 32767;//linear interpolation
+		output = (double)((1 - remainder) * at(a) + remainder * at(b));//linear interpolation
 	}
 	else
 	{
@@ -1258,7 +1534,7 @@ double Clip::play(double speed)
 		{
 			b = 0;
 		}
-		output = (double)((-1 - remainder) * temp[a] + remainder * temp[b]) / 32767;//linear interpolation
+		output = (double)((-1 - remainder) * at(a) + remainder * at(b));//linear interpolation
 	}
 	return (output);
 }
@@ -1307,8 +1583,8 @@ double Clip::play(double frequency, double start, double end, double& pos)
 			b = length - 1;
 		}
 
-		output = (double)((1 - remainder) * temp[a] +
-						  remainder * temp[b]) / 32767;//linear interpolation
+		output = (double)((1 - remainder) * at(a) +
+						  remainder * at(b));//linear interpolation
 	}
 	else
 	{
@@ -1334,8 +1610,8 @@ double Clip::play(double frequency, double start, double end, double& pos)
 		{
 			b = 0;
 		}
-		output = (double)((-1 - remainder) * temp[a] +
-						  remainder * temp[b]) / 32767;//linear interpolation
+		output = (double)((-1 - remainder) * at(a) +
+						  remainder * at(b));//linear interpolation
 
 	}
 
@@ -1360,39 +1636,39 @@ double Clip::play4(double frequency, double start, double end)
 		remainder = position - floor(position);
 		if (position > 0)
 		{
-			a = temp[(int)(floor(position)) - 1];
+			a = at((int)(floor(position)) - 1);
 
 		}
 		else
 		{
-			a = temp[0];
+			a = at(0);
 
 		}
 
-		b = temp[(long)position];
+		b = at((long)position);
 		if (position < end - 2)
 		{
-			c = temp[(long)position + 1];
+			c = at((long)position + 1);
 
 		}
 		else
 		{
-			c = temp[0];
+			c = at(0);
 
 		}
 		if (position < end - 3)
 		{
-			d = temp[(long)position + 2];
+			d = at((long)position + 2);
 
 		}
 		else
 		{
-			d = temp[0];
+			d = at(0);
 		}
 		a1 = 0.5f * (c - a);
 		a2 = a - 2.5 * b + 2.f * c - 0.5f * d;
 		a3 = 0.5f * (d - a) + 1.5f * (b - c);
-		output = (double)(((a3 * remainder + a2) * remainder + a1) * remainder + b) / 32767;
+		output = (double)(((a3 * remainder + a2) * remainder + a1) * remainder + b);
 
 	}
 	else
@@ -1404,39 +1680,39 @@ double Clip::play4(double frequency, double start, double end)
 		remainder = position - floor(position);
 		if (position > start && position < end - 1)
 		{
-			a = temp[(long)position + 1];
+			a = at((long)position + 1);
 
 		}
 		else
 		{
-			a = temp[0];
+			a = at(0);
 
 		}
 
-		b = temp[(long)position];
+		b = at((long)position);
 		if (position > start)
 		{
-			c = temp[(long)position - 1];
+			c = at((long)position - 1);
 
 		}
 		else
 		{
-			c = temp[0];
+			c = at(0);
 
 		}
 		if (position > start + 1)
 		{
-			d = temp[(long)position - 2];
+			d = at((long)position - 2);
 
 		}
 		else
 		{
-			d = temp[0];
+			d = at(0);
 		}
 		a1 = 0.5f * (c - a);
 		a2 = a - 2.5 * b + 2.f * c - 0.5f * d;
 		a3 = 0.5f * (d - a) + 1.5f * (b - c);
-		output = (double)(((a3 * remainder + a2) * -remainder + a1) * -remainder + b) / 32767;
+		output = (double)(((a3 * remainder + a2) * -remainder + a1) * -remainder + b);
 
 	}
 
@@ -1444,6 +1720,76 @@ double Clip::play4(double frequency, double start, double end)
 }
 
 
+double Clip::getSincIncrement(const double speed) const
+{
+	return speed * double(mySampleRate) / double(Settings::SAMPLE_RATE);
+}
+
+//Windowed sinc playback of the whole clip, looping. Speed is a ratio, 1.0 the original pitch
+double Clip::playSinc(const double speed)
+{
+	const double increment = getSincIncrement(speed);
+	output = sample->buffer.visit(readChannel, [&](const auto* samples, const double scale)
+	{
+		return SincInterpolator::get(interpolation).interpolate(samples, length, position, increment) * scale;
+	});
+	position += increment;
+	if (position >= length || position < 0)
+	{
+		position -= length * floor(position / length);
+	}
+	return output;
+}
+
+//As play(frequency, start, end) with start and end in samples, plays that chunk 'frequency' times a second
+double Clip::playSinc(const double frequency, const double start, double end)
+{
+	if (end >= length)
+	{ end = length - 1; }
+	const double increment = (end - start) * frequency / Settings::SAMPLE_RATE;
+	if (position < start || position >= end)
+	{
+		position = frequency >= 0 ? start : end;
+	}
+	sample->buffer.visit(readChannel, [&](const auto* samples, const double scale)
+	{
+		SincInterpolator::get(interpolation).process(samples, length, position, increment, &output, 1, start, end,
+				scale);
+	});
+	return output;
+}
+
+void Clip::playSinc(double* buffer, const std::size_t frames, const double speed)
+{
+	sample->buffer.visit(readChannel, [&](const auto* samples, const double scale)
+	{
+		SincInterpolator::get(interpolation).process(samples, length, position, getSincIncrement(speed), buffer,
+				frames, 0.0, double(length), scale);
+	});
+}
+
+void Clip::setInterpolation(const SincInterpolator::Quality quality)
+{
+	interpolation = quality;
+	// Builds the tables here rather than on the first sample played.
+	SincInterpolator::get(interpolation);
+}
+
+void Clip::setReadChannel(const int channel)
+{
+	const int channels = int(sample->buffer.getNumChannels());
+	readChannel = channels > 0 ? std::min(std::max(channel, 0), channels - 1) : 0;
+}
+
+void Clip::setStorage(const SampleBuffer::Format format)
+{
+	storage = format;
+	if (sample->buffer.getFormat() != format)
+	{
+		edit().buffer.setFormat(format);
+	}
+}
+
 //You don't need to worry about this stuff.
 double Clip::bufferPlay(unsigned char& bufferin, long length)
 {
@@ -1692,20 +2038,15 @@ double Clip::bufferPlay4(unsigned char& bufferin, double frequency, double start
 
 long Clip::getLength()
 {
-	return (length = myDataSize * 0.5);
+	return (length = long(sample->buffer.getNumFrames()));
 }
 
 void Clip::setLength(unsigned long numSamples)
 {
 	cout << "Length: " << numSamples << endl;
-	short* newData = (short*)malloc(sizeof(short) * numSamples);
-	if (NULL not_eq temp)
-	{
-		unsigned long copyLength = min((unsigned long)length, numSamples);
-		memcpy(newData, temp, sizeof(short) * copyLength);
-	}
-	temp = newData;
-	myDataSize = int(numSamples * 2);
+	SampleBuffer& data = edit().buffer;
+	data.resize(numSamples);
+	myDataSize = int(numSamples * 2 * data.getNumChannels());
 	length = numSamples;
 	position = 0;
 	recordPosition = 0;
@@ -1713,7 +2054,7 @@ void Clip::setLength(unsigned long numSamples)
 
 void Clip::clear()
 {
-	memset(temp, 0, myDataSize);
+	edit().buffer.clear();
 }
 
 void Clip::reset()
@@ -1723,23 +2064,34 @@ void Clip::reset()
 
 void Clip::normalise(float maxLevel)
 {
-	short maxValue = 0;
-	for (int i = 0; i < length; i++)
+	SampleBuffer& data = edit().buffer;
+	float maxValue = 0;
+	for (std::size_t c = 0; c < data.getNumChannels(); c++)
 	{
-		if (abs(temp[i]) > maxValue)
+		for (long i = 0; i < length; i++)
 		{
-			maxValue = abs(temp[i]);
+			maxValue = max(maxValue, fabsf(data.get(c, i)));
 		}
 	}
-	float scale = 32767.0 * maxLevel / (float)maxValue;
-	for (int i = 0; i < length; i++)
+	if (maxValue == 0)
+	{
+		return;
+	}
+	float scale = maxLevel / maxValue;
+	for (std::size_t c = 0; c < data.getNumChannels(); c++)
 	{
-		temp[i] = round(scale * (float)temp[i]);
+		for (long i = 0; i < length; i++)
+		{
+			data.set(c, i, scale * data.get(c, i));
+		}
 	}
 }
 
 void Clip::autoTrim(float alpha, float threshold, bool trimStart, bool trimEnd)
 {
+	//threshold is on the 16 bit scale, detection runs on the read channel
+	SampleBuffer& data = edit().buffer;
+	threshold /= 32767.0f;
 
 	int startMarker = 0;
 	if (trimStart)
@@ -1747,7 +2099,7 @@ void Clip::autoTrim(float alpha, float threshold, bool trimStart, bool trimEnd)
 		Maximilian::LaggingExponential <float> startLag(alpha, 0);
 		while (startMarker < length)
 		{
-			startLag.addSample(abs(temp[startMarker]));
+			startLag.addSample(fabsf(data.get(readChannel, startMarker)));
 			if (startLag.value() > threshold)
 			{
 				break;
@@ -1762,7 +2114,7 @@ void Clip::autoTrim(float alpha, float threshold, bool trimStart, bool trimEnd)
 		Maximilian::LaggingExponential <float> endLag(alpha, 0);
 		while (endMarker > 0)
 		{
-			endLag.addSample(abs(temp[endMarker]));
+			endLag.addSample(fabsf(data.get(readChannel, endMarker)));
 			if (endLag.value() > threshold)
 			{
 				break;
@@ -1776,24 +2128,29 @@ void Clip::autoTrim(float alpha, float threshold, bool trimStart, bool trimEnd)
 	int newLength = endMarker - startMarker;
 	if (newLength > 0)
 	{
-		short* newData = (short*)malloc(sizeof(short) * newLength);
-		for (int i = 0; i < newLength; i++)
+		SampleBuffer trimmed(data.getNumChannels(), newLength, data.getFormat());
+		for (std::size_t c = 0; c < data.getNumChannels(); c++)
 		{
-			newData[i] = temp[i + startMarker];
+			for (int i = 0; i < newLength; i++)
+			{
+				trimmed.set(c, i, data.get(c, i + startMarker));
+			}
 		}
-		free(temp);
-		temp = newData;
-		myDataSize = newLength * 2;
+		data = std::move(trimmed);
+		myDataSize = int(newLength * 2 * data.getNumChannels());
 		length = newLength;
 		position = 0;
 		recordPosition = 0;
 		//envelope the start
 		int fadeSize = int(min((long)100, length));
-		for (int i = 0; i < fadeSize; i++)
+		for (std::size_t c = 0; c < data.getNumChannels(); c++)
 		{
-			float factor = i / (float)fadeSize;
-			temp[i] = round(temp[i] * factor);
-			temp[length - 1 - i] = round(temp[length - 1 - i] * factor);
+			for (int i = 0; i < fadeSize; i++)
+			{
+				float factor = i / (float)fadeSize;
+				data.set(c, i, data.get(c, i) * factor);
+				data.set(c, length - 1 - i, data.get(c, length - 1 - i) * factor);
+			}
 		}
 	}
 }
@@ -2252,6 +2609,112 @@ double pitchRatios[256] = { 0.0006517771980725, 0.0006905338959768, 0.0007315951
 							1366.8762207031250000, 1448.1549072265625000, 1534.2666015625000000,
 							1625.4989013671875000 };
 
+namespace
+{
+	//a cached hit ends once its envelope has released below this
+	constexpr double HIT_SILENCE = 0.0001;
+	constexpr double MAXIMUM_HIT_SECONDS = 4.0;
+
+	//an envelope at rest, as if its last hit had ended
+	void silence(Env& envelope)
+	{
+		envelope.amplitude = 0;
+		envelope.output = 0;
+		envelope.holdcount = envelope.holdtime;
+		envelope.attackphase = 0;
+		envelope.decayphase = 0;
+		envelope.sustainphase = 0;
+		envelope.holdphase = 0;
+		envelope.releasephase = 1;
+	}
+
+	//the settings that shape a hit of any of the drums, the key it is cached under. The kick and
+	//snare keep their filter settings in the drum, the hats in their StateVariableFilter
+	template <typename Drum>
+	OneShotCache::Parameters hitParameters(const Drum& drum)
+	{
+		constexpr bool variableFilter = std::is_same_v <decltype(drum.filter), StateVariableFilter>;
+		OneShotCache::Parameters parameters{};
+		parameters[0] = drum.pitch;
+		parameters[1] = drum.envelope.attack;
+		parameters[2] = drum.envelope.decay;
+		parameters[3] = drum.envelope.sustain;
+		parameters[4] = drum.envelope.release;
+		parameters[5] = double(drum.envelope.holdtime);
+		parameters[6] = drum.useDistortion;
+		parameters[7] = drum.useDistortion ? drum.distortion : 0;
+		parameters[8] = drum.useFilter;
+		if (drum.useFilter)
+		{
+			if constexpr (variableFilter)
+			{
+				parameters[9] = drum.filter.getCutoff();
+				parameters[10] = drum.filter.getResonance();
+			}
+			else
+			{
+				parameters[9] = drum.cutoff;
+				parameters[10] = drum.resonance;
+			}
+		}
+		return parameters;
+	}
+
+	template <typename Drum>
+	void setHitParameters(Drum& drum, const OneShotCache::Parameters& parameters)
+	{
+		drum.pitch = parameters[0];
+		drum.envelope.attack = parameters[1];
+		drum.envelope.decay = parameters[2];
+		drum.envelope.sustain = parameters[3];
+		drum.envelope.release = parameters[4];
+		drum.envelope.holdtime = long(parameters[5]);
+		drum.useDistortion = parameters[6] != 0;
+		drum.distortion = parameters[7];
+		drum.useFilter = parameters[8] != 0;
+		if constexpr (std::is_same_v <decltype(drum.filter), StateVariableFilter>)
+		{
+			drum.filter.setCutoff(parameters[9] > 0 ? parameters[9] : 1000)
+					.setResonance(parameters[10] > 0 ? parameters[10] : 1);
+		}
+		else
+		{
+			drum.cutoff = parameters[9];
+			drum.resonance = parameters[10];
+		}
+	}
+
+	//one hit of a drum with these parameters, from silence, with the gain and limiter left for playback.
+	//The OneShotCache::Renderer of every drum
+	template <typename Drum>
+	std::shared_ptr <const SampleData> renderHit(const OneShotCache::Parameters& parameters)
+	{
+		Drum drum;
+		setHitParameters(drum, parameters);
+		drum.gain = 1;
+		drum.useLimiter = false;
+		silence(drum.envelope);
+		drum.envelope.trigger = 1;
+
+		const auto maximum = std::size_t(MAXIMUM_HIT_SECONDS * Settings::SAMPLE_RATE);
+		std::vector <double> hit;
+		hit.reserve(maximum);
+		while (hit.size() < maximum)
+		{
+			hit.push_back(drum.play());
+			if (drum.envelope.releasephase == 1 && drum.envelope.amplitude < HIT_SILENCE)
+			{
+				break;
+			}
+		}
+
+		auto data = std::make_shared <SampleData>();
+		data->buffer.allocate(1, hit.size());
+		data->buffer.write(0, 0, hit.size(), hit.data());
+		return data;
+	}
+}
+
 Maximilian::maxiKick::maxiKick()
 {
 
@@ -2268,6 +2731,12 @@ Maximilian::maxiKick::maxiKick()
 double maxiKick::play()
 {
 
+	if (oneShot.isActive())
+	{
+		output = oneShot.play();
+		return useLimiter ? std::min(std::max(output * gain, -1.0), 1.0) : output * gain;
+	}
+
 	envOut = envelope.adsr(1., envelope.trigger);
 
 	if (inverse)
@@ -2346,10 +2815,22 @@ void maxiKick::setPitch(double newPitch)
 void maxiKick::trigger()
 {
 
+	//inverted envelopes never end, so those hits are always synthesised
+	if (!inverse && oneShot.trigger(&renderHit <maxiKick>, hitParameters(*this)))
+	{
+		return;
+	}
 	envelope.trigger = 1;
 
 }
 
+void maxiKick::setCached(bool cached)
+{
+
+	oneShot.setEnabled(cached);
+
+}
+
 Maximilian::maxiSnare::maxiSnare()
 {
 
@@ -2366,6 +2847,12 @@ Maximilian::maxiSnare::maxiSnare()
 double maxiSnare::play()
 {
 
+	if (oneShot.isActive())
+	{
+		output = oneShot.play();
+		return useLimiter ? std::min(std::max(output * gain, -1.0), 1.0) : output * gain;
+	}
+
 	envOut = envelope.adsr(1., envelope.trigger);
 
 	if (inverse)
@@ -2445,10 +2932,21 @@ void maxiSnare::setPitch(double newPitch)
 void maxiSnare::trigger()
 {
 
+	if (!inverse && oneShot.trigger(&renderHit <maxiSnare>, hitParameters(*this)))
+	{
+		return;
+	}
 	envelope.trigger = 1;
 
 }
 
+void maxiSnare::setCached(bool cached)
+{
+
+	oneShot.setEnabled(cached);
+
+}
+
 Maximilian::maxiHats::maxiHats()
 {
 
@@ -2467,6 +2965,12 @@ Maximilian::maxiHats::maxiHats()
 double maxiHats::play()
 {
 
+	if (oneShot.isActive())
+	{
+		output = oneShot.play();
+		return useLimiter ? std::min(std::max(output * gain, -1.0), 1.0) : output * gain;
+	}
+
 	envOut = envelope.adsr(1., envelope.trigger);
 
 	if (inverse)
@@ -2546,10 +3050,21 @@ void maxiHats::setPitch(double newPitch)
 void maxiHats::trigger()
 {
 
+	if (!inverse && oneShot.trigger(&renderHit <maxiHats>, hitParameters(*this)))
+	{
+		return;
+	}
 	envelope.trigger = 1;
 
 }
 
+void maxiHats::setCached(bool cached)
+{
+
+	oneShot.setEnabled(cached);
+
+}
+
 
 Maximilian::maxiClock::maxiClock()
 {
@@ -2559,7 +3074,10 @@ Maximilian::maxiClock::maxiClock()
 	lastCount = 0;
 	bpm = 120;
 	ticks = 1;
+	bps = 0;
+	untilTick = 0;
 	maxiClock::setTempo(bpm);
+	untilTick = Settings::SAMPLE_RATE / bps;
 
 }
 
@@ -2567,15 +3085,13 @@ Maximilian::maxiClock::maxiClock()
 void maxiClock::ticker()
 {
 
-	tick = false;
-	currentCount = floor(timer.phasor(bps));//this sets up a metronome that ticks n times a second
-
-	if (lastCount not_eq currentCount)
-	{//if we have a new timer int this sample,
-
-		tick = true;
+	//a countdown rather than a phasor, so a sample without a tick costs a subtraction
+	untilTick -= 1.0;
+	tick = untilTick <= 0.0;
+	if (tick)
+	{
+		untilTick += Settings::SAMPLE_RATE / bps;
 		playHead++;//iterate the playhead
-
 	}
 
 }
@@ -2584,8 +3100,15 @@ void maxiClock::ticker()
 void maxiClock::setTempo(double bpmIn)
 {
 
+	const double period = Settings::SAMPLE_RATE / bps;
 	bpm = bpmIn;
 	bps = (bpm / 60.) * ticks;
+
+	//the tick in progress keeps the part it has played
+	if (untilTick > 0.0 && period > 0.0)
+	{
+		untilTick *= (Settings::SAMPLE_RATE / bps) / period;
+	}
 }
 
 
@@ -2597,11 +3120,857 @@ void maxiClock::setTicksPerBeat(int ticksPerBeat)
 
 }
 
+namespace
+{
+	//the attack aims past full scale so it gets there in a finite time, the release aims below
+	//silence for the same reason
+	constexpr double ATTACK_OVERSHOOT = 1.3;
+	constexpr double RELEASE_FLOOR = -0.001;
+
+	//per sample rate that covers 'ratio' of the distance to the target in 'ms'
+	double envelopeRate(double ms, double ratio)
+	{
+		return ms > 0 ? pow(ratio, 1.0 / (ms * 0.001 * Settings::SAMPLE_RATE)) : 0.0;
+	}
+
+	inline double polyBlep(double t, double dt)
+	{
+		const double early = t / dt;
+		const double late = (t - 1.0) / dt;
+		return t < dt ? early + early - early * early - 1.0 : (t > 1.0 - dt ? late * late + late + late + 1.0 : 0.0);
+	}
+}
+
+maxiSynth::maxiSynth(std::size_t voices)
+{
+	setAmpEnvelope(10, 200, 0.7, 300);
+	setModEnvelope(5, 300, 0.2, 300);
+	setLFO(0, 5);
+	setLFO(1, 0.3);
+	modulation[size_t(Source::Envelope)][size_t(Target::Cutoff)] = 2;
+	modulation[size_t(Source::KeyTrack)][size_t(Target::Cutoff)] = 0.5;
+	setup(voices);
+}
+
+void maxiSynth::setup(std::size_t voices)
+{
+	const std::size_t capacity = std::min(std::max <std::size_t>(voices, 1), MAXIMUM_VOICES);
+	allocator.setup(capacity);
+	for (std::vector <double>* lane : { &notes, &velocities, &phases0, &phases1, &increments0, &increments1, &widths,
+										&filter1, &filter2, &a1, &a2, &a3, &levels, &targets, &rates, &modLevels,
+										&modTargets, &modRates, &gains, &pansLeft, &pansRight, &fades, &fadeSteps,
+										&pendingNotes, &pendingVelocities, &oscillator0, &oscillator1, &voiceOutput })
+	{
+		lane->assign(capacity, 0.0);
+	}
+	seeds.assign(capacity, 0);
+	stages.assign(capacity, Stage::Release);
+	modStages.assign(capacity, Stage::Release);
+	countdown = 0;
+}
+
+void maxiSynth::move(std::size_t from, std::size_t to)
+{
+	for (std::vector <double>* lane : { &notes, &velocities, &phases0, &phases1, &increments0, &increments1, &widths,
+										&filter1, &filter2, &a1, &a2, &a3, &levels, &targets, &rates, &modLevels,
+										&modTargets, &modRates, &gains, &pansLeft, &pansRight, &fades, &fadeSteps,
+										&pendingNotes, &pendingVelocities })
+	{
+		(*lane)[to] = (*lane)[from];
+	}
+	seeds[to] = seeds[from];
+	stages[to] = stages[from];
+	modStages[to] = modStages[from];
+}
+
+void maxiSynth::start(std::size_t slot, double note, double velocity)
+{
+	notes[slot] = note;
+	velocities[slot] = std::min(std::max(velocity / 127.0, 0.0), 1.0);
+	phases0[slot] = 0;
+	phases1[slot] = 0;
+	noiseSeed = noiseSeed * 1664525u + 1013904223u;
+	seeds[slot] = noiseSeed;
+	filter1[slot] = 0;
+	filter2[slot] = 0;
+	levels[slot] = 0;
+	modLevels[slot] = 0;
+	stages[slot] = Stage::Attack;
+	modStages[slot] = Stage::Attack;
+	fades[slot] = 1;
+	fadeSteps[slot] = 0;
+	control(slot);
+}
+
+void maxiSynth::noteOn(double note, double velocity)
+{
+	const std::size_t voice = allocator.noteOn(note);
+	if (voice == VoiceAllocator::NONE)
+	{
+		return;
+	}
+	const std::size_t slot = allocator.getSlot(voice);
+	if (allocator.getState(voice) == VoiceAllocator::State::Stolen)
+	{
+		//fades out first, control() starts the note after
+		pendingNotes[slot] = note;
+		pendingVelocities[slot] = velocity;
+		fadeSteps[slot] = 1.0 / (STEAL_FADE_MS * 0.001 * Settings::SAMPLE_RATE);
+	}
+	else
+	{
+		start(slot, note, velocity);
+	}
+}
+
+void maxiSynth::noteOff(double note)
+{
+	allocator.noteOff(note, [this](std::size_t voice)
+	{
+		const std::size_t slot = allocator.getSlot(voice);
+		stages[slot] = Stage::Release;
+		modStages[slot] = Stage::Release;
+		control(slot);
+	});
+}
+
+void maxiSynth::allNotesOff()
+{
+	for (const std::size_t voice : allocator.getActive())
+	{
+		const bool playing = allocator.getState(voice) == VoiceAllocator::State::Playing;
+		allocator.release(voice);
+		if (playing)
+		{
+			const std::size_t slot = allocator.getSlot(voice);
+			stages[slot] = Stage::Release;
+			modStages[slot] = Stage::Release;
+			control(slot);
+		}
+	}
+}
+
+void maxiSynth::control(std::size_t slot)
+{
+	const double sources[SOURCES] = { lfos[0].value, lfos[1].value, modLevels[slot], velocities[slot],
+									  (notes[slot] - 60.0) / 12.0, modWheel };
+	double amounts[TARGETS] = {};
+	for (std::size_t source = 0; source < SOURCES; ++source)
+	{
+		for (std::size_t target = 0; target < TARGETS; ++target)
+		{
+			amounts[target] += modulation[source][target] * sources[source];
+		}
+	}
+
+	const double pitch = notes[slot] + pitchBend + amounts[size_t(Target::Pitch)];
+	increments0[slot] = std::min(440.0 * exp2((pitch - 69.0) / 12.0) / Settings::SAMPLE_RATE, 0.45);
+	increments1[slot] = std::min(440.0 * exp2((pitch + detune - 69.0) / 12.0) / Settings::SAMPLE_RATE, 0.45);
+	widths[slot] = std::min(std::max(pulseWidth + amounts[size_t(Target::PulseWidth)], 0.05), 0.95);
+
+	//topology preserving state variable lowpass (Simper)
+	const double frequency = std::min(std::max(cutoff * exp2(amounts[size_t(Target::Cutoff)]), 20.0),
+			0.45 * Settings::SAMPLE_RATE);
+	const double g = tan(PI * frequency / Settings::SAMPLE_RATE);
+	const double k = 1.0 / std::max(resonance + amounts[size_t(Target::Resonance)], 0.5);
+	a1[slot] = 1.0 / (1.0 + g * (g + k));
+	a2[slot] = g * a1[slot];
+	a3[slot] = g * a2[slot];
+
+	gains[slot] = velocities[slot] * std::max(1.0 + amounts[size_t(Target::Amplitude)], 0.0);
+	const double angle = (std::min(std::max(pan + amounts[size_t(Target::Pan)], -1.0), 1.0) + 1.0) * PI * 0.25;
+	pansLeft[slot] = cos(angle);
+	pansRight[slot] = sin(angle);
+
+	switch (stages[slot])
+	{
+	case Stage::Attack:
+		targets[slot] = ATTACK_OVERSHOOT;
+		rates[slot] = ampEnvelope.attack;
+		break;
+	case Stage::Decay:
+		targets[slot] = ampEnvelope.sustain;
+		rates[slot] = ampEnvelope.decay;
+		break;
+	case Stage::Release:
+		targets[slot] = RELEASE_FLOOR;
+		rates[slot] = ampEnvelope.release;
+		break;
+	}
+	switch (modStages[slot])
+	{
+	case Stage::Attack:
+		modTargets[slot] = ATTACK_OVERSHOOT;
+		modRates[slot] = modEnvelope.attack;
+		break;
+	case Stage::Decay:
+		modTargets[slot] = modEnvelope.sustain;
+		modRates[slot] = modEnvelope.decay;
+		break;
+	case Stage::Release:
+		modTargets[slot] = RELEASE_FLOOR;
+		modRates[slot] = modEnvelope.release;
+		break;
+	}
+}
+
+void maxiSynth::control()
+{
+	for (LFO& lfo : lfos)
+	{
+		lfo.phase += lfo.frequency * CONTROL_PERIOD / Settings::SAMPLE_RATE;
+		const bool wrapped = lfo.phase >= 1.0;
+		lfo.phase -= floor(lfo.phase);
+		switch (lfo.waveform)
+		{
+		case Waveform::Sine:
+			lfo.value = sin(TWOPI * lfo.phase);
+			break;
+		case Waveform::Triangle:
+			lfo.value = 1.0 - 4.0 * fabs(lfo.phase - 0.5);
+			break;
+		case Waveform::Saw:
+			lfo.value = 2.0 * lfo.phase - 1.0;
+			break;
+		case Waveform::Pulse:
+			lfo.value = lfo.phase < pulseWidth ? 1.0 : -1.0;
+			break;
+		case Waveform::Noise:
+			if (wrapped)
+			{
+				noiseSeed = noiseSeed * 1664525u + 1013904223u;
+				lfo.value = double(std::int32_t(noiseSeed)) / 2147483648.0;
+			}
+			break;
+		}
+	}
+
+	//from the end, so a retiring voice only moves one that is already done
+	const std::vector <std::size_t>& active = allocator.getActive();
+	for (std::size_t slot = active.size(); slot-- > 0;)
+	{
+		const std::size_t voice = active[slot];
+		const bool stolen = allocator.getState(voice) == VoiceAllocator::State::Stolen;
+		if (stolen && fades[slot] <= 0)
+		{
+			start(slot, pendingNotes[slot], pendingVelocities[slot]);
+			if (allocator.start(voice) == VoiceAllocator::State::Releasing)
+			{
+				stages[slot] = Stage::Release;
+				modStages[slot] = Stage::Release;
+			}
+		}
+		else if (!stolen && stages[slot] == Stage::Release && levels[slot] <= 0)
+		{
+			const std::size_t last = active.size() - 1;
+			allocator.retire(voice);
+			if (slot != last)
+			{
+				move(last, slot);
+			}
+			continue;
+		}
+
+		if (stages[slot] == Stage::Attack && levels[slot] >= 1.0)
+		{
+			stages[slot] = Stage::Decay;
+		}
+		if (modStages[slot] == Stage::Attack && modLevels[slot] >= 1.0)
+		{
+			modStages[slot] = Stage::Decay;
+		}
+		allocator.setLevel(voice, levels[slot]);
+		control(slot);
+	}
+}
+
+void maxiSynth::renderOscillator(Waveform waveform, std::vector <double>& phases,
+		const std::vector <double>& increments, std::vector <double>& output, std::size_t count)
+{
+	double* __restrict phase = phases.data();
+	const double* __restrict increment = increments.data();
+	double* __restrict out = output.data();
+	const double* __restrict width = widths.data();
+
+	switch (waveform)
+	{
+	case Waveform::Sine:
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			out[s] = sin(TWOPI * phase[s]);
+		}
+		break;
+	case Waveform::Triangle:
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			out[s] = 1.0 - 4.0 * fabs(phase[s] - 0.5);
+		}
+		break;
+	case Waveform::Saw:
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			out[s] = 2.0 * phase[s] - 1.0 - polyBlep(phase[s], increment[s]);
+		}
+		break;
+	case Waveform::Pulse:
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			const double t = phase[s];
+			double falling = t - width[s];
+			falling += falling < 0.0 ? 1.0 : 0.0;
+			out[s] = (t < width[s] ? 1.0 : -1.0) + polyBlep(t, increment[s]) - polyBlep(falling, increment[s]);
+		}
+		break;
+	case Waveform::Noise:
+	{
+		std::uint32_t* __restrict seed = seeds.data();
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			seed[s] = seed[s] * 1664525u + 1013904223u;
+			out[s] = double(std::int32_t(seed[s])) * (1.0 / 2147483648.0);
+		}
+		break;
+	}
+	}
+
+	for (std::size_t s = 0; s < count; ++s)
+	{
+		const double next = phase[s] + increment[s];
+		phase[s] = next >= 1.0 ? next - 1.0 : next;
+	}
+}
+
+void maxiSynth::render(double* left, double* right, std::size_t frames)
+{
+	const std::size_t count = allocator.getNumActive();
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		renderOscillator(waveforms[0], phases0, increments0, oscillator0, count);
+		renderOscillator(waveforms[1], phases1, increments1, oscillator1, count);
+
+		const double* __restrict o0 = oscillator0.data();
+		const double* __restrict o1 = oscillator1.data();
+		double* __restrict f1 = filter1.data();
+		double* __restrict f2 = filter2.data();
+		const double* __restrict c1 = a1.data();
+		const double* __restrict c2 = a2.data();
+		const double* __restrict c3 = a3.data();
+		double* __restrict level = levels.data();
+		const double* __restrict target = targets.data();
+		const double* __restrict rate = rates.data();
+		double* __restrict modLevel = modLevels.data();
+		const double* __restrict modTarget = modTargets.data();
+		const double* __restrict modRate = modRates.data();
+		double* __restrict fade = fades.data();
+		const double* __restrict fadeStep = fadeSteps.data();
+		const double* __restrict voiceGain = gains.data();
+		double* __restrict y = voiceOutput.data();
+
+		//every stage of every voice, one lane per voice
+		for (std::size_t s = 0; s < count; ++s)
+		{
+			const double x = o0[s] + mix * (o1[s] - o0[s]);
+
+			const double v3 = x - f2[s];
+			const double v1 = c1[s] * f1[s] + c2[s] * v3;
+			const double v2 = f2[s] + c2[s] * f1[s] + c3[s] * v3;
+			f1[s] = 2.0 * v1 - f1[s];
+			f2[s] = 2.0 * v2 - f2[s];
+
+			double a = target[s] + (level[s] - target[s]) * rate[s];
+			a = a < 0.0 ? 0.0 : a;
+			a = a > 1.0 ? 1.0 : a;
+			level[s] = a;
+
+			double m = modTarget[s] + (modLevel[s] - modTarget[s]) * modRate[s];
+			m = m < 0.0 ? 0.0 : m;
+			m = m > 1.0 ? 1.0 : m;
+			modLevel[s] = m;
+
+			double f = fade[s] - fadeStep[s];
+			f = f < 0.0 ? 0.0 : f;
+			fade[s] = f;
+
+			y[s] = v2 * a * voiceGain[s] * f;
+		}
+
+		if (right == nullptr)
+		{
+			double sum = 0;
+			for (std::size_t s = 0; s < count; ++s)
+			{
+				sum += y[s];
+			}
+			left[n] = sum * gain;
+		}
+		else
+		{
+			double sumLeft = 0;
+			double sumRight = 0;
+			for (std::size_t s = 0; s < count; ++s)
+			{
+				sumLeft += y[s] * pansLeft[s];
+				sumRight += y[s] * pansRight[s];
+			}
+			left[n] = sumLeft * gain;
+			right[n] = sumRight * gain;
+		}
+	}
+}
+
+double maxiSynth::play()
+{
+	double output;
+	play(&output, 1);
+	return output;
+}
+
+void maxiSynth::play(double* output, std::size_t frames)
+{
+	play(output, nullptr, frames);
+}
+
+void maxiSynth::play(double* left, double* right, std::size_t frames)
+{
+	while (frames > 0)
+	{
+		if (countdown == 0)
+		{
+			control();
+			countdown = CONTROL_PERIOD;
+		}
+		const std::size_t chunk = std::min(frames, countdown);
+		render(left, right, chunk);
+		left += chunk;
+		if (right != nullptr)
+		{
+			right += chunk;
+		}
+		frames -= chunk;
+		countdown -= chunk;
+	}
+}
+
+std::size_t maxiSynth::getNumActive() const
+{
+	return allocator.getNumActive();
+}
+
+std::size_t maxiSynth::getNumVoices() const
+{
+	return allocator.getCapacity();
+}
+
+void maxiSynth::setWaveform(std::size_t oscillator, Waveform waveform)
+{
+	waveforms[std::min <std::size_t>(oscillator, 1)] = waveform;
+}
+
+void maxiSynth::setDetune(double semitones)
+{
+	detune = semitones;
+}
+
+void maxiSynth::setOscillatorMix(double _mix)
+{
+	mix = std::min(std::max(_mix, 0.0), 1.0);
+}
+
+void maxiSynth::setPulseWidth(double width)
+{
+	pulseWidth = width;
+}
+
+void maxiSynth::setCutoff(double frequency)
+{
+	cutoff = frequency;
+}
+
+void maxiSynth::setResonance(double q)
+{
+	resonance = q;
+}
+
+void maxiSynth::setAmpEnvelope(double attack, double decay, double sustain, double release)
+{
+	ampEnvelope.attack = envelopeRate(attack, (ATTACK_OVERSHOOT - 1.0) / ATTACK_OVERSHOOT);
+	ampEnvelope.decay = envelopeRate(decay, 0.01);
+	ampEnvelope.sustain = std::min(std::max(sustain, 0.0), 1.0);
+	ampEnvelope.release = envelopeRate(release, 0.01);
+}
+
+void maxiSynth::setModEnvelope(double attack, double decay, double sustain, double release)
+{
+	modEnvelope.attack = envelopeRate(attack, (ATTACK_OVERSHOOT - 1.0) / ATTACK_OVERSHOOT);
+	modEnvelope.decay = envelopeRate(decay, 0.01);
+	modEnvelope.sustain = std::min(std::max(sustain, 0.0), 1.0);
+	modEnvelope.release = envelopeRate(release, 0.01);
+}
+
+void maxiSynth::setLFO(std::size_t lfo, double frequency, Waveform waveform)
+{
+	LFO& chosen = lfos[std::min <std::size_t>(lfo, 1)];
+	chosen.frequency = frequency;
+	chosen.waveform = waveform;
+}
+
+void maxiSynth::setModulation(Source source, Target target, double amount)
+{
+	modulation[size_t(source)][size_t(target)] = amount;
+}
+
+void maxiSynth::setModWheel(double value)
+{
+	modWheel = value;
+}
+
+void maxiSynth::setPitchBend(double semitones)
+{
+	pitchBend = semitones;
+}
+
+void maxiSynth::setPan(double _pan)
+{
+	pan = _pan;
+}
+
+void maxiSynth::setGain(double _gain)
+{
+	gain = _gain;
+}
+
+void maxiSynth::setStealing(VoiceAllocator::Stealing stealing)
+{
+	allocator.setStealing(stealing);
+}
+
+granularSynth::granularSynth(std::size_t grains)
+{
+	setup(grains);
+}
+
+granularSynth::granularSynth(const Clip& clip, std::size_t grains) : granularSynth(grains)
+{
+	setSample(clip);
+}
+
+void granularSynth::setup(std::size_t grains)
+{
+	const std::size_t capacity = std::min(std::max <std::size_t>(grains, 1), MAXIMUM_GRAINS);
+	for (std::vector <double>* lane : { &positions, &increments, &phases, &phaseIncrements, &gains, &gainsLeft,
+										&gainsRight })
+	{
+		lane->assign(capacity, 0.0);
+	}
+	remaining.assign(capacity, 0);
+	delays.assign(capacity, 0);
+	windows.assign(capacity, window(shape));
+	active = 0;
+	untilNext = 0;
+}
+
+void granularSynth::setSample(const Clip& clip)
+{
+	setSample(clip.getSampleData());
+	setReadChannel(std::size_t(clip.getReadChannel()));
+}
+
+void granularSynth::setSample(std::shared_ptr <const SampleData> data)
+{
+	sample = std::move(data);
+	active = 0;
+	readChannel = std::min(readChannel, sample ? std::max <std::size_t>(sample->buffer.getNumChannels(), 1) - 1 : 0);
+}
+
+const double* granularSynth::window(Shape shape)
+{
+	static const auto tables = []()
+	{
+		std::array <std::vector <double>, 4> result;
+		for (std::vector <double>& table : result)
+		{
+			table.assign(WINDOW_SIZE + 1, 0.0);
+		}
+
+		Window::fill(Window::Type::Hann, result[size_t(Shape::Hann)].data(), WINDOW_SIZE);
+
+		//narrow enough that the ends are nearly silent, then lowered so they are exactly
+		const double width = 0.35;
+		const double edge = exp(-0.5 / (width * width));
+		for (std::size_t n = 0; n <= WINDOW_SIZE; ++n)
+		{
+			const double x = double(n) / WINDOW_SIZE;
+			const double centred = (x - 0.5) * 2.0 / width;
+			result[size_t(Shape::Gaussian)][n] = (exp(-0.5 * centred * centred) - edge) / (1.0 - edge);
+
+			const double taper = std::min(x, 1.0 - x) / 0.25;
+			result[size_t(Shape::Tukey)][n] = taper < 1.0 ? 0.5 * (1.0 - cos(PI * taper)) : 1.0;
+
+			result[size_t(Shape::Triangle)][n] = 1.0 - fabs(2.0 * x - 1.0);
+		}
+		return result;
+	}();
+	return tables[size_t(shape)].data();
+}
+
+double granularSynth::random()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return double(std::int32_t(seed)) * (1.0 / 2147483648.0);
+}
+
+void granularSynth::start(std::size_t delay, double _position, double _duration, double _pitch, double _pan,
+		double _gain)
+{
+	if (!sample || sample->buffer.getNumFrames() < 2)
+	{
+		return;
+	}
+	if (active == remaining.size())
+	{
+		++dropped;
+		return;
+	}
+
+	//grains read between the first and the last but one frame, so interpolation never reads past the end
+	const double last = double(sample->buffer.getNumFrames() - 2);
+	const double increment = pow(2.0, _pitch / 12.0) * sample->sampleRate / Settings::SAMPLE_RATE;
+	double length = std::max(1.0, floor(_duration * 0.001 * Settings::SAMPLE_RATE));
+	length = std::min(length, floor(last / increment) + 1.0);
+	const double span = (length - 1.0) * increment;
+	const double from = std::min(std::min(std::max(_position, 0.0), 1.0) * last, last - span);
+
+	const double angle = (std::min(std::max(_pan, -1.0), 1.0) + 1.0) * PI * 0.25;
+	const std::size_t g = active++;
+	positions[g] = from;
+	increments[g] = increment;
+	phases[g] = 0;
+	phaseIncrements[g] = WINDOW_SIZE / length;
+	remaining[g] = std::size_t(length);
+	delays[g] = delay;
+	windows[g] = window(shape);
+	gains[g] = _gain * gain;
+	gainsLeft[g] = gains[g] * cos(angle);
+	gainsRight[g] = gains[g] * sin(angle);
+}
+
+void granularSynth::start(std::size_t delay)
+{
+	start(delay, position + positionSpread * random(), duration * (1.0 + durationSpread * random()),
+			pitch + pitchSpread * random(), pan + panSpread * random(), 1.0);
+}
+
+void granularSynth::trigger(double _position, double _duration, double _pitch, double _pan, double _gain)
+{
+	start(0, _position, _duration, _pitch, _pan, _gain);
+}
+
+void granularSynth::stop()
+{
+	active = 0;
+	density = 0;
+	untilNext = 0;
+}
+
+void granularSynth::render(double* left, double* right, std::size_t frames)
+{
+	//the cloud's onsets in this block, each on its own sample
+	if (density > 0)
+	{
+		const double interval = Settings::SAMPLE_RATE / density;
+		while (untilNext < double(frames))
+		{
+			start(std::size_t(untilNext));
+			untilNext += interval * (1.0 + scatter * random());
+		}
+		untilNext -= double(frames);
+	}
+
+	if (!sample)
+	{
+		return;
+	}
+
+	//backwards, so a grain that ends can take the last one's place
+	for (std::size_t g = active; g-- > 0;)
+	{
+		const std::size_t begin = delays[g];
+		const std::size_t count = std::min(remaining[g], frames - begin);
+		const double position0 = positions[g];
+		const double increment = increments[g];
+		const double phase0 = phases[g];
+		const double phaseIncrement = phaseIncrements[g];
+		const double* __restrict table = windows[g];
+
+		//each sample's indices come from the grain's start, not from the sample before, so the loop has no
+		//dependency between iterations
+		sample->buffer.visit(readChannel, [&](const auto* __restrict samples, const double scale)
+		{
+			if (right == nullptr)
+			{
+				const double weight = gains[g] * scale;
+				double* __restrict out = left + begin;
+				for (std::size_t n = 0; n < count; ++n)
+				{
+					const double p = position0 + double(n) * increment;
+					const auto i = std::size_t(p);
+					const double a = samples[i];
+					const double w = phase0 + double(n) * phaseIncrement;
+					const auto k = std::size_t(w);
+					const double envelope = table[k] + (w - double(k)) * (table[k + 1] - table[k]);
+					out[n] += (a + (p - double(i)) * (double(samples[i + 1]) - a)) * envelope * weight;
+				}
+				return;
+			}
+
+			const double weightLeft = gainsLeft[g] * scale;
+			const double weightRight = gainsRight[g] * scale;
+			double* __restrict outLeft = left + begin;
+			double* __restrict outRight = right + begin;
+			for (std::size_t n = 0; n < count; ++n)
+			{
+				const double p = position0 + double(n) * increment;
+				const auto i = std::size_t(p);
+				const double a = samples[i];
+				const double w = phase0 + double(n) * phaseIncrement;
+				const auto k = std::size_t(w);
+				const double envelope = table[k] + (w - double(k)) * (table[k + 1] - table[k]);
+				const double value = (a + (p - double(i)) * (double(samples[i + 1]) - a)) * envelope;
+				outLeft[n] += value * weightLeft;
+				outRight[n] += value * weightRight;
+			}
+		});
+
+		remaining[g] -= count;
+		if (remaining[g] > 0)
+		{
+			positions[g] = position0 + double(count) * increment;
+			phases[g] = phase0 + double(count) * phaseIncrement;
+			delays[g] = 0;
+			continue;
+		}
+
+		const std::size_t moved = --active;
+		positions[g] = positions[moved];
+		increments[g] = increments[moved];
+		phases[g] = phases[moved];
+		phaseIncrements[g] = phaseIncrements[moved];
+		gains[g] = gains[moved];
+		gainsLeft[g] = gainsLeft[moved];
+		gainsRight[g] = gainsRight[moved];
+		remaining[g] = remaining[moved];
+		delays[g] = delays[moved];
+		windows[g] = windows[moved];
+	}
+}
+
+double granularSynth::play()
+{
+	double output = 0;
+	render(&output, nullptr, 1);
+	return output;
+}
+
+void granularSynth::play(double* output, std::size_t frames)
+{
+	std::fill(output, output + frames, 0.0);
+	render(output, nullptr, frames);
+}
+
+void granularSynth::play(double* left, double* right, std::size_t frames)
+{
+	std::fill(left, left + frames, 0.0);
+	std::fill(right, right + frames, 0.0);
+	render(left, right, frames);
+}
+
+std::size_t granularSynth::getNumGrains() const
+{
+	return active;
+}
+
+std::size_t granularSynth::getCapacity() const
+{
+	return remaining.size();
+}
+
+std::uint64_t granularSynth::getDroppedGrains() const
+{
+	return dropped;
+}
+
+void granularSynth::setDensity(double grainsPerSecond)
+{
+	density = std::max(grainsPerSecond, 0.0);
+}
+
+void granularSynth::setScatter(double _scatter)
+{
+	scatter = std::min(std::max(_scatter, 0.0), 1.0);
+}
+
+void granularSynth::setPosition(double _position)
+{
+	position = _position;
+}
+
+void granularSynth::setPositionSpread(double spread)
+{
+	positionSpread = spread;
+}
+
+void granularSynth::setDuration(double _duration)
+{
+	duration = _duration;
+}
+
+void granularSynth::setDurationSpread(double spread)
+{
+	durationSpread = std::min(std::max(spread, 0.0), 1.0);
+}
+
+void granularSynth::setPitch(double semitones)
+{
+	pitch = semitones;
+}
+
+void granularSynth::setPitchSpread(double semitones)
+{
+	pitchSpread = semitones;
+}
+
+void granularSynth::setPan(double _pan)
+{
+	pan = _pan;
+}
+
+void granularSynth::setPanSpread(double spread)
+{
+	panSpread = spread;
+}
+
+void granularSynth::setShape(Shape _shape)
+{
+	shape = _shape;
+}
+
+void granularSynth::setGain(double _gain)
+{
+	gain = _gain;
+}
+
+void granularSynth::setReadChannel(std::size_t channel)
+{
+	const std::size_t channels = sample ? sample->buffer.getNumChannels() : 1;
+	readChannel = std::min(channel, std::max <std::size_t>(channels, 1) - 1);
+}
+
 Maximilian::maxiSampler::maxiSampler()
 {
 
 	Maximilian::maxiSampler::voices = 32;
 	Maximilian::maxiSampler::currentVoice = 0;
+	Maximilian::maxiSampler::allocator.setup(32);
 
 
 	for (int i = 0; i < voices; i++)
@@ -2614,8 +3983,12 @@ Maximilian::maxiSampler::maxiSampler()
 		Maximilian::maxiSampler::envelopes[i].holdtime = 1;
 		Maximilian::maxiSampler::envelopes[i].trigger = 0;
 		Maximilian::maxiSampler::envOut[i] = 0;
+		Maximilian::maxiSampler::envOutGain[i] = 1;
 		Maximilian::maxiSampler::pitch[i] = 0;
 		Maximilian::maxiSampler::outputs[i] = 0;
+		Maximilian::maxiSampler::pendingPitch[i] = 0;
+		Maximilian::maxiSampler::pendingGain[i] = 1;
+		Maximilian::maxiSampler::fades[i] = 1;
 
 
 	}
@@ -2624,7 +3997,78 @@ Maximilian::maxiSampler::maxiSampler()
 void maxiSampler::setNumVoices(int numVoices)
 {
 
-	voices = numVoices;
+	voices = std::min(std::max(numVoices, 1), 32);
+	allocator.setLimit(voices);
+
+}
+
+void maxiSampler::setStealing(VoiceAllocator::Stealing stealing)
+{
+
+	allocator.setStealing(stealing);
+
+}
+
+void maxiSampler::start(int voice, double note, double velocityGain)
+{
+
+	pitch[voice] = note;
+	envOutGain[voice] = velocityGain;
+	fades[voice] = 1;
+
+	//from silence, whatever the voice played before
+	Env& envelope = envelopes[voice];
+	envelope.amplitude = 0;
+	envelope.holdcount = 0;
+	envelope.attackphase = envelope.decayphase = envelope.sustainphase = envelope.holdphase = envelope.releasephase = 0;
+	envelope.trigger = 1;
+
+	samples[voice].trigger();
+
+}
+
+double maxiSampler::next(int voice)
+{
+
+	Env& envelope = envelopes[voice];
+	envOut[voice] = envelope.adsr(envOutGain[voice], envelope.trigger);
+
+	outputs[voice] = samples[voice].play(
+			pitchRatios[(int)pitch[voice] + originalPitch] *
+			((1. / samples[voice].length) * Settings::SAMPLE_RATE),
+			0, samples[voice].length) * envOut[voice];
+
+	const VoiceAllocator::State state = allocator.getState(voice);
+	if (envelope.trigger == 1 && !sustain)
+	{
+		envelope.trigger = 0;
+		if (state == VoiceAllocator::State::Playing)
+		{
+			allocator.release(voice);
+		}
+	}
+
+	if (state == VoiceAllocator::State::Stolen)
+	{
+		//fading out, then on to the note it was stolen for
+		outputs[voice] *= fades[voice];
+		fades[voice] -= 1. / (STEAL_FADE_MS * 0.001 * Settings::SAMPLE_RATE);
+		if (fades[voice] <= 0)
+		{
+			start(voice, pendingPitch[voice], pendingGain[voice]);
+			if (allocator.start(voice) == VoiceAllocator::State::Releasing)
+			{
+				envelope.trigger = 0;
+			}
+		}
+	}
+	else if (envelope.releasephase == 1 && envelope.amplitude < SILENCE)
+	{
+		allocator.retire(voice);
+	}
+
+	allocator.setLevel(voice, envelope.amplitude);
+	return outputs[voice];
 
 }
 
@@ -2633,29 +4077,43 @@ double maxiSampler::play()
 
 	output = 0;
 
-	for (int i = 0; i < voices; i++)
+	//backwards, so a voice retiring on the way doesn't skip another
+	const std::vector <std::size_t>& active = allocator.getActive();
+	for (std::size_t i = active.size(); i-- > 0;)
 	{
 
-		envOut[i] = envelopes[i].adsr(envOutGain[i], envelopes[i].trigger);
+		output += next(int(active[i])) / voices;
+
+	}
+	return output;
 
-		if (envOut[i] > 0.)
+}
+
+void maxiSampler::play(double* buffer, std::size_t frames)
+{
+
+	std::fill(buffer, buffer + frames, 0.0);
+
+	//one voice at a time through the whole block
+	const std::vector <std::size_t>& active = allocator.getActive();
+	for (std::size_t i = active.size(); i-- > 0;)
+	{
+
+		const int voice = int(active[i]);
+		for (std::size_t n = 0; n < frames; n++)
 		{
-			outputs[i] = samples[i].play(
-					pitchRatios[(int)pitch[i] + originalPitch] *
-					((1. / samples[i].length) * Settings::SAMPLE_RATE),
-					0, samples[i].length) * envOut[i];
-			output += outputs[i] / voices;
 
-			if (envelopes[i].trigger == 1 && !sustain)
+			buffer[n] += next(voice) / voices;
+			if (allocator.getState(voice) == VoiceAllocator::State::Free)
 			{
-				envelopes[i].trigger = 0;
-
+				break;
 			}
 
 		}
 
 	}
-	return output;
+
+	output = frames > 0 ? buffer[frames - 1] : 0;
 
 }
 
@@ -2664,10 +4122,17 @@ void maxiSampler::load(string inFile, bool setall)
 
 	if (setall)
 	{
+		//read once, every voice plays the same copy, stored as the voices are set to store it
+		Clip loaded;
+		loaded.setStorage(samples[currentVoice].getStorage());
+		if (!loaded.load(inFile))
+		{
+			return;
+		}
 		for (int i = 0; i < voices; i++)
 		{
 
-			samples[i].load(inFile);
+			samples[i].setSampleData(loaded.getSampleData());
 
 		}
 
@@ -2682,6 +4147,18 @@ void maxiSampler::load(string inFile, bool setall)
 
 }
 
+void maxiSampler::swapSample(std::shared_ptr <const SampleData> data)
+{
+
+	for (int i = 0; i < voices; i++)
+	{
+
+		samples[i].swapSampleData(data);
+
+	}
+
+}
+
 void maxiSampler::setPitch(double pitchIn, bool setall)
 {
 
@@ -2698,7 +4175,7 @@ void maxiSampler::setPitch(double pitchIn, bool setall)
 	else
 	{
 
-		pitch[currentVoice] = pitchIn;
+		nextPitch = pitchIn;
 
 	}
 
@@ -2720,8 +4197,9 @@ void maxiSampler::midiNoteOn(double pitchIn, double velocity, bool setall)
 	else
 	{
 
-		pitch[currentVoice] = pitchIn;
-		envOutGain[currentVoice] = velocity / 128;
+		//played by the next trigger()
+		nextPitch = pitchIn;
+		nextGain = velocity / 128;
 
 	}
 
@@ -2730,18 +4208,11 @@ void maxiSampler::midiNoteOn(double pitchIn, double velocity, bool setall)
 void maxiSampler::midiNoteOff(double pitchIn, double velocity, bool setall)
 {
 
-
-	for (int i = 0; i < voices; i++)
+	allocator.noteOff(pitchIn, [this](std::size_t voice)
 	{
+		envelopes[voice].trigger = 0;
+	});
 
-		if (pitch[i] == pitchIn)
-		{
-
-			envelopes[i].trigger = 0;
-
-		}
-
-	}
 }
 
 
@@ -2873,10 +4344,22 @@ void maxiSampler::setPosition(double positionD, bool setall)
 void maxiSampler::trigger()
 {
 
-	envelopes[currentVoice].trigger = 1;
-	samples[currentVoice].trigger();
-	currentVoice++;
-	currentVoice = currentVoice % voices;
+	const std::size_t voice = allocator.noteOn(nextPitch);
+	if (voice == VoiceAllocator::NONE)
+	{
+		return;
+	}
+
+	if (allocator.getState(voice) == VoiceAllocator::State::Stolen)
+	{
+		pendingPitch[voice] = nextPitch;
+		pendingGain[voice] = nextGain;
+	}
+	else
+	{
+		start(int(voice), nextPitch, nextGain);
+	}
+	currentVoice = int(voice);
 
 }
 